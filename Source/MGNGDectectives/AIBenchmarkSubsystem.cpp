@@ -0,0 +1,335 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AIBenchmarkSubsystem.h"
+
+#include "EnemyAIController.h"
+#include "EnemyAIManagerSubsystem.h"
+#include "FixedStepSimulation.h"
+#include "MGNGDectectives.h"
+#include "AIController.h"
+#include "EngineUtils.h"
+#include "BehaviorTree/BehaviorTree.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerStart.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace AIBenchmark
+{
+	const TCHAR* CsvHeader = TEXT("time_s,frames,avg_frame_ms,avg_game_thread_ms,max_game_thread_ms,enemies,avg_ai_manager_ms,max_ai_manager_ms,perception_updates_per_s,paths_started_per_s,paths_queued,used_physical_mb");
+
+	void Start(const TArray<FString>& Args, UWorld* World)
+	{
+		UAIBenchmarkSubsystem* Benchmark = World ? World->GetSubsystem<UAIBenchmarkSubsystem>() : nullptr;
+		if (Benchmark == nullptr)
+		{
+			return;
+		}
+
+		const int32 Enemies = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 0;
+		const bool bNative = Args.Num() < 2 || !Args[1].Equals(TEXT("Blueprint"), ESearchCase::IgnoreCase);
+		const float Seconds = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 0.0f;
+		Benchmark->StartBenchmark(Enemies, bNative, Seconds);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs AIBenchmarkStartCommand(
+	TEXT("mgng.AIBenchmark.Start"),
+	TEXT("Spawns enemies and records AI performance to Saved/Benchmarks. Args: [Enemies] [Native|Blueprint] [Seconds]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&AIBenchmark::Start)
+);
+
+static FAutoConsoleCommandWithWorld AIBenchmarkStopCommand(
+	TEXT("mgng.AIBenchmark.Stop"),
+	TEXT("Stops the running AI benchmark and writes what was recorded so far."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UAIBenchmarkSubsystem* Benchmark = World ? World->GetSubsystem<UAIBenchmarkSubsystem>() : nullptr)
+		{
+			Benchmark->StopBenchmark();
+		}
+	})
+);
+
+bool UAIBenchmarkSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UAIBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAIBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+void UAIBenchmarkSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	int32 CommandLineEnemies = 0;
+	const bool bHasCount = FParse::Value(FCommandLine::Get(), TEXT("MGNGAIBenchmark="), CommandLineEnemies);
+	if (bHasCount || FParse::Param(FCommandLine::Get(), TEXT("MGNGAIBenchmark")))
+	{
+		FString Mode;
+		FParse::Value(FCommandLine::Get(), TEXT("MGNGAIBenchmarkMode="), Mode);
+		float CommandLineDuration = 0.0f;
+		FParse::Value(FCommandLine::Get(), TEXT("MGNGAIBenchmarkDuration="), CommandLineDuration);
+		StartBenchmark(CommandLineEnemies, !Mode.Equals(TEXT("Blueprint"), ESearchCase::IgnoreCase), CommandLineDuration);
+	}
+}
+
+void UAIBenchmarkSubsystem::Deinitialize()
+{
+	if (bRunning)
+	{
+		StopBenchmark();
+	}
+
+	Super::Deinitialize();
+}
+
+void UAIBenchmarkSubsystem::StartBenchmark(int32 InNumEnemies, bool bInNative, float InDuration)
+{
+	if (bRunning)
+	{
+		return;
+	}
+
+	UWorld* World = GetWorld();
+	NumEnemies = InNumEnemies > 0 ? InNumEnemies : DefaultNumEnemies;
+	bNative = bInNative;
+	if (InDuration > 0.0f)
+	{
+		Duration = InDuration;
+	}
+
+	ResolvedEnemyClass = EnemyClass.LoadSynchronous();
+	if (bNative)
+	{
+		ResolvedControllerClass = AEnemyAIController::StaticClass();
+		ResolvedBehaviorTree = NativeBehaviorTree.LoadSynchronous();
+	}
+	else
+	{
+		ResolvedControllerClass = BlueprintControllerClass.LoadSynchronous();
+		ResolvedBehaviorTree = nullptr;
+	}
+	if (bNative && ResolvedBehaviorTree == nullptr)
+	{
+		// AEnemyAIController and the AI manager still run, only the tasks are the Blueprint ones
+		UE_LOG(LogMGNGDectectives, Warning, TEXT("AI benchmark: %s doesn't exist yet, the native controller falls back to BT_Enemy. Duplicate BT_Enemy there and replace its Blueprint tasks with Enemy Move Random Location, Enemy Move To Shooting and Enemy Shooting to measure the native tasks too"),
+			*NativeBehaviorTree.ToString());
+	}
+	if (ResolvedEnemyClass == nullptr || ResolvedControllerClass == nullptr)
+	{
+		UE_LOG(LogMGNGDectectives, Error, TEXT("AI benchmark can't start, check EnemyClass and BlueprintControllerClass"));
+		return;
+	}
+
+	// Same seed every run so both modes get the same spawn points
+	Random.Initialize(FFixedStepSimulation::GetSeed());
+
+	Center = FVector::ZeroVector;
+	for (TActorIterator<APlayerStart> It(World); It; ++It)
+	{
+		Center = It->GetActorLocation();
+		break;
+	}
+
+	bRunning = true;
+	bRecording = false;
+	Elapsed = 0.0f;
+	RunGameThreadMs = RunGameThreadMsSquared = RunMaxGameThreadMs = 0.0;
+	RunFrames = 0;
+	Rows.Reset();
+	Rows.Add(AIBenchmark::CsvHeader);
+
+	Enemies.Reset(NumEnemies);
+	for (int32 Index = 0; Index < NumEnemies; ++Index)
+	{
+		SpawnEnemy();
+	}
+
+	UE_LOG(LogMGNGDectectives, Display, TEXT("AI benchmark started on %s: %d enemies of %s controlled by %s, %.0f s warmup, %.0f s recorded"),
+		*World->GetMapName(), Enemies.Num(), *ResolvedEnemyClass->GetName(), *ResolvedControllerClass->GetName(), WarmupTime, Duration);
+}
+
+void UAIBenchmarkSubsystem::StopBenchmark()
+{
+	if (!bRunning)
+	{
+		return;
+	}
+
+	bRunning = false;
+	if (bRecording && WindowFrames > 0)
+	{
+		WriteSample();
+	}
+	bRecording = false;
+
+	SaveCsv();
+
+	if (RunFrames > 0)
+	{
+		const double Mean = RunGameThreadMs / RunFrames;
+		const double Deviation = FMath::Sqrt(FMath::Max(RunGameThreadMsSquared / RunFrames - Mean * Mean, 0.0));
+		UE_LOG(LogMGNGDectectives, Display, TEXT("AI benchmark %s, %d enemies: game thread %.3f ms mean, %.3f ms deviation, %.3f ms worst over %d frames"),
+			bNative ? TEXT("native") : TEXT("Blueprint"), NumEnemies, Mean, Deviation, RunMaxGameThreadMs, RunFrames);
+	}
+
+	if (FFixedStepSimulation::IsEnabled())
+	{
+		FFixedStepSimulation::LogStats();
+	}
+
+	if (FApp::IsUnattended())
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UAIBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	// Whatever got killed is replaced, the load stays the same all run
+	Enemies.RemoveAllSwap([](const APawn* Enemy) { return !IsValid(Enemy); });
+	while (Enemies.Num() < NumEnemies)
+	{
+		const int32 Before = Enemies.Num();
+		SpawnEnemy();
+		if (Enemies.Num() == Before)
+		{
+			break;
+		}
+	}
+
+	Elapsed += DeltaTime;
+	if (!bRecording)
+	{
+		if (Elapsed >= WarmupTime)
+		{
+			bRecording = true;
+			Elapsed = 0.0f;
+			WindowTime = 0.0f;
+			WindowFrames = WindowPerceptionUpdates = WindowPathsStarted = 0;
+			WindowGameThreadMs = WindowMaxGameThreadMs = WindowManagerMs = WindowMaxManagerMs = 0.0;
+		}
+		return;
+	}
+
+	// Frame time minus the time the game thread spent waiting for the frame rate limit or other threads
+	const double GameThreadMs = FMath::Max(FApp::GetDeltaTime() - FApp::GetIdleTime(), 0.0) * 1000.0;
+	WindowTime += DeltaTime;
+	++WindowFrames;
+	WindowGameThreadMs += GameThreadMs;
+	WindowMaxGameThreadMs = FMath::Max(WindowMaxGameThreadMs, GameThreadMs);
+
+	++RunFrames;
+	RunGameThreadMs += GameThreadMs;
+	RunGameThreadMsSquared += GameThreadMs * GameThreadMs;
+	RunMaxGameThreadMs = FMath::Max(RunMaxGameThreadMs, GameThreadMs);
+
+	// The manager is another tickable, this is its last completed frame
+	if (const UEnemyAIManagerSubsystem* Manager = GetWorld()->GetSubsystem<UEnemyAIManagerSubsystem>())
+	{
+		WindowManagerMs += Manager->GetLastUpdateMs();
+		WindowMaxManagerMs = FMath::Max(WindowMaxManagerMs, Manager->GetLastUpdateMs());
+		WindowPerceptionUpdates += Manager->GetLastPerceptionUpdates();
+		WindowPathsStarted += Manager->GetLastPathsStarted();
+	}
+
+	if (WindowTime >= 1.0f)
+	{
+		WriteSample();
+	}
+
+	if (Elapsed >= Duration)
+	{
+		StopBenchmark();
+	}
+}
+
+void UAIBenchmarkSubsystem::SpawnEnemy()
+{
+	UWorld* World = GetWorld();
+	const FTransform SpawnTransform(FRotator(0.0f, Random.FRandRange(0.0f, 360.0f), 0.0f), RandomSpawnLocation());
+
+	// Possessed by hand below, whatever controller the pawn asks for itself would be replaced anyway
+	APawn* Enemy = World->SpawnActorDeferred<APawn>(ResolvedEnemyClass, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+	if (Enemy == nullptr)
+	{
+		return;
+	}
+	Enemy->AutoPossessAI = EAutoPossessAI::Disabled;
+	Enemy->FinishSpawning(SpawnTransform);
+
+	FActorSpawnParameters ControllerParams;
+	ControllerParams.Instigator = Enemy;
+	ControllerParams.OverrideLevel = Enemy->GetLevel();
+	ControllerParams.ObjectFlags |= RF_Transient;
+	AAIController* Controller = World->SpawnActor<AAIController>(ResolvedControllerClass, SpawnTransform.GetLocation(), SpawnTransform.Rotator(), ControllerParams);
+	if (Controller == nullptr)
+	{
+		Enemy->Destroy();
+		return;
+	}
+
+	if (AEnemyAIController* EnemyController = Cast<AEnemyAIController>(Controller))
+	{
+		EnemyController->SetBehaviorTree(ResolvedBehaviorTree);
+	}
+	Controller->Possess(Enemy);
+	Enemies.Add(Enemy);
+}
+
+FVector UAIBenchmarkSubsystem::RandomSpawnLocation()
+{
+	const float Angle = Random.FRandRange(0.0f, 2.0f * PI);
+	const float Distance = SpawnRadius * FMath::Sqrt(Random.FRand());
+	return Center + FVector(FMath::Cos(Angle) * Distance, FMath::Sin(Angle) * Distance, 0.0f);
+}
+
+void UAIBenchmarkSubsystem::WriteSample()
+{
+	const UEnemyAIManagerSubsystem* Manager = GetWorld()->GetSubsystem<UEnemyAIManagerSubsystem>();
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	const int32 Frames = FMath::Max(WindowFrames, 1);
+	const float Seconds = FMath::Max(WindowTime, KINDA_SMALL_NUMBER);
+
+	Rows.Add(FString::Printf(TEXT("%.2f,%d,%.3f,%.3f,%.3f,%d,%.3f,%.3f,%.1f,%.1f,%d,%.1f"),
+		Elapsed,
+		WindowFrames,
+		WindowTime * 1000.0f / Frames,
+		WindowGameThreadMs / Frames,
+		WindowMaxGameThreadMs,
+		Enemies.Num(),
+		WindowManagerMs / Frames,
+		WindowMaxManagerMs,
+		WindowPerceptionUpdates / Seconds,
+		WindowPathsStarted / Seconds,
+		Manager != nullptr ? Manager->GetNumQueuedPaths() : 0,
+		MemoryStats.UsedPhysical / (1024.0 * 1024.0)));
+
+	WindowTime = 0.0f;
+	WindowFrames = WindowPerceptionUpdates = WindowPathsStarted = 0;
+	WindowGameThreadMs = WindowMaxGameThreadMs = WindowManagerMs = WindowMaxManagerMs = 0.0;
+}
+
+void UAIBenchmarkSubsystem::SaveCsv() const
+{
+	const FString FileName = FString::Printf(TEXT("AIBenchmark_%s_%s_%denemies_%s.csv"),
+		*GetWorld()->GetMapName(), bNative ? TEXT("Native") : TEXT("Blueprint"), NumEnemies, *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S")));
+	const FString Path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), FileName);
+
+	if (FFileHelper::SaveStringArrayToFile(Rows, *Path))
+	{
+		UE_LOG(LogMGNGDectectives, Display, TEXT("AI benchmark wrote %d samples to %s"), Rows.Num() - 1, *Path);
+	}
+	else
+	{
+		UE_LOG(LogMGNGDectectives, Error, TEXT("AI benchmark could not write %s"), *Path);
+	}
+}
@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "AIBenchmarkSubsystem.generated.h"
+
+class AAIController;
+class UBehaviorTree;
+
+/**
+ * Headless enemy AI benchmark. Spawns EnemyClass pawns possessed either by BlueprintControllerClass (AI_Enemy with the
+ * Blueprint tasks) or by an AEnemyAIController running NativeBehaviorTree, then writes one CSV row per second with
+ * game thread time and the AI manager's work to Saved/Benchmarks and logs the mean, deviation and worst frame.
+ * Starts on map load with -MGNGAIBenchmark[=Enemies] [-MGNGAIBenchmarkMode=Native|Blueprint] or with mgng.AIBenchmark.Start.
+ * Until NativeBehaviorTree is authored from BT_Enemy in the editor, native mode runs the controller's fallback tree.
+ * Meant to run both ways and compare: MGNGDectectives /Game/AI/Scenes/AI_Test -game -nullrhi -unattended -MGNGAIBenchmark=100
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API UAIBenchmarkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override { return bRunning; }
+
+	void StartBenchmark(int32 InNumEnemies, bool bInNative, float InDuration);
+	void StopBenchmark();
+
+	FORCEINLINE bool IsRunning() const { return bRunning; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Enemies spawned when -MGNGAIBenchmark has no count */
+	UPROPERTY(Config)
+	int32 DefaultNumEnemies = 100;
+
+	/** Seconds recorded after the warmup */
+	UPROPERTY(Config)
+	float Duration = 60.0f;
+
+	/** Seconds before recording starts, lets the trees start and the first paths come back */
+	UPROPERTY(Config)
+	float WarmupTime = 5.0f;
+
+	/** Radius of the circle the enemies are spread over */
+	UPROPERTY(Config)
+	float SpawnRadius = 3000.0f;
+
+	/** BP_Enemy */
+	UPROPERTY(Config)
+	TSoftClassPtr<APawn> EnemyClass;
+
+	/** AI_Enemy, running BT_Enemy with the Blueprint tasks */
+	UPROPERTY(Config)
+	TSoftClassPtr<AAIController> BlueprintControllerClass;
+
+	/** BT_Enemy with the native UBTTask_Enemy* tasks in place of the Blueprint ones */
+	UPROPERTY(Config)
+	TSoftObjectPtr<UBehaviorTree> NativeBehaviorTree;
+
+private:
+	void SpawnEnemy();
+	FVector RandomSpawnLocation();
+
+	/** Closes the current one second window and appends it to Rows */
+	void WriteSample();
+	void SaveCsv() const;
+
+	UPROPERTY()
+	TArray<APawn*> Enemies;
+
+	UClass* ResolvedEnemyClass = nullptr;
+	UClass* ResolvedControllerClass = nullptr;
+
+	UPROPERTY()
+	UBehaviorTree* ResolvedBehaviorTree = nullptr;
+
+	FRandomStream Random;
+	FVector Center = FVector::ZeroVector;
+	bool bRunning = false;
+	bool bRecording = false;
+	bool bNative = true;
+	int32 NumEnemies = 0;
+	float Elapsed = 0.0f;
+
+	// Current sample window
+	float WindowTime = 0.0f;
+	int32 WindowFrames = 0;
+	double WindowGameThreadMs = 0.0;
+	double WindowMaxGameThreadMs = 0.0;
+	double WindowManagerMs = 0.0;
+	double WindowMaxManagerMs = 0.0;
+	int32 WindowPerceptionUpdates = 0;
+	int32 WindowPathsStarted = 0;
+
+	// Whole run, for the summary
+	double RunGameThreadMs = 0.0;
+	double RunGameThreadMsSquared = 0.0;
+	double RunMaxGameThreadMs = 0.0;
+	int32 RunFrames = 0;
+
+	TArray<FString> Rows;
+};
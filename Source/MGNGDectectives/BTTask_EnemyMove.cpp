@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_EnemyMove.h"
+
+#include "EnemyAIManagerSubsystem.h"
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "NavigationPath.h"
+
+UBTTask_EnemyMove::UBTTask_EnemyMove()
+{
+	NodeName = TEXT("Enemy Move");
+
+	// OnTaskFinished clears the request ids a finished or aborted move leaves in the memory
+	bNotifyTaskFinished = true;
+}
+
+uint16 UBTTask_EnemyMove::GetInstanceMemorySize() const
+{
+	return sizeof(FBTEnemyMoveMemory);
+}
+
+EBTNodeResult::Type UBTTask_EnemyMove::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FBTEnemyMoveMemory* Memory = CastInstanceNodeMemory<FBTEnemyMoveMemory>(NodeMemory);
+	Memory->PathRequestId = 0;
+	Memory->MoveRequestId = FAIRequestID::InvalidRequest;
+
+	AAIController* Controller = OwnerComp.GetAIOwner();
+	UEnemyAIManagerSubsystem* Manager = Controller ? Controller->GetWorld()->GetSubsystem<UEnemyAIManagerSubsystem>() : nullptr;
+	if (Manager == nullptr || Controller->GetPawn() == nullptr)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	FVector Goal = FVector::ZeroVector;
+	float RandomRadius = 0.0f;
+	const EBTNodeResult::Type GoalResult = GetGoal(OwnerComp, Goal, RandomRadius);
+	if (GoalResult != EBTNodeResult::InProgress)
+	{
+		return GoalResult;
+	}
+
+	Memory->PathRequestId = Manager->RequestPath(Controller, Goal, RandomRadius,
+		FOnEnemyPathFound::CreateUObject(this, &ThisClass::OnPathFound, TWeakObjectPtr<UBehaviorTreeComponent>(&OwnerComp)));
+	return Memory->PathRequestId != 0 ? EBTNodeResult::InProgress : EBTNodeResult::Failed;
+}
+
+void UBTTask_EnemyMove::OnPathFound(uint32 RequestId, FNavPathSharedPtr Path, TWeakObjectPtr<UBehaviorTreeComponent> WeakOwnerComp)
+{
+	UBehaviorTreeComponent* OwnerComp = WeakOwnerComp.Get();
+	if (OwnerComp == nullptr || OwnerComp->GetTaskStatus(this) != EBTTaskStatus::Active)
+	{
+		return;
+	}
+
+	// One template serves every enemy running the tree, the request id tells whose answer this is
+	FBTEnemyMoveMemory* Memory = CastInstanceNodeMemory<FBTEnemyMoveMemory>(OwnerComp->GetNodeMemory(this, OwnerComp->FindInstanceContainingNode(this)));
+	if (Memory == nullptr || Memory->PathRequestId != RequestId)
+	{
+		return;
+	}
+	Memory->PathRequestId = 0;
+
+	AAIController* Controller = OwnerComp->GetAIOwner();
+	if (Controller == nullptr || !Path.IsValid() || (Path->IsPartial() && !bAllowPartialPath))
+	{
+		FinishLatentTask(*OwnerComp, EBTNodeResult::Failed);
+		return;
+	}
+
+	FAIMoveRequest MoveRequest(Path->GetEndLocation());
+	MoveRequest.SetAcceptanceRadius(AcceptanceRadius);
+	MoveRequest.SetAllowPartialPath(bAllowPartialPath);
+
+	const FAIRequestID MoveRequestId = Controller->RequestMove(MoveRequest, Path);
+	if (!MoveRequestId.IsValid())
+	{
+		FinishLatentTask(*OwnerComp, EBTNodeResult::Failed);
+		return;
+	}
+
+	// The default OnMessage finishes the task with the move's result
+	Memory->MoveRequestId = MoveRequestId;
+	WaitForMessage(*OwnerComp, UBrainComponent::AIMessage_MoveFinished, static_cast<int32>(MoveRequestId.GetID()));
+}
+
+EBTNodeResult::Type UBTTask_EnemyMove::AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FBTEnemyMoveMemory* Memory = CastInstanceNodeMemory<FBTEnemyMoveMemory>(NodeMemory);
+	AAIController* Controller = OwnerComp.GetAIOwner();
+
+	if (Memory->PathRequestId != 0 && Controller != nullptr)
+	{
+		if (UEnemyAIManagerSubsystem* Manager = Controller->GetWorld()->GetSubsystem<UEnemyAIManagerSubsystem>())
+		{
+			Manager->CancelPath(Memory->PathRequestId);
+		}
+	}
+
+	UPathFollowingComponent* PathFollowing = Controller ? Controller->GetPathFollowingComponent() : nullptr;
+	if (Memory->MoveRequestId.IsValid() && PathFollowing != nullptr)
+	{
+		PathFollowing->AbortMove(*this, FPathFollowingResultFlags::OwnerFinished, Memory->MoveRequestId);
+	}
+
+	Memory->PathRequestId = 0;
+	Memory->MoveRequestId = FAIRequestID::InvalidRequest;
+	return EBTNodeResult::Aborted;
+}
+
+void UBTTask_EnemyMove::OnTaskFinished(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTNodeResult::Type TaskResult)
+{
+	FBTEnemyMoveMemory* Memory = CastInstanceNodeMemory<FBTEnemyMoveMemory>(NodeMemory);
+	Memory->PathRequestId = 0;
+	Memory->MoveRequestId = FAIRequestID::InvalidRequest;
+
+	Super::OnTaskFinished(OwnerComp, NodeMemory, TaskResult);
+}
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AITypes.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "BehaviorTree/BTTaskNode.h"
+#include "BTTask_EnemyMove.generated.h"
+
+struct FBTEnemyMoveMemory
+{
+	/** Path request waiting in UEnemyAIManagerSubsystem, 0 once it came back */
+	uint32 PathRequestId;
+	FAIRequestID MoveRequestId;
+};
+
+/**
+ * Moves the pawn along a path UEnemyAIManagerSubsystem found asynchronously. Nothing ticks while it runs:
+ * the task waits for the path, hands it to the path following component and finishes on its move finished message.
+ */
+UCLASS(Abstract)
+class MGNGDECTECTIVES_API UBTTask_EnemyMove : public UBTTaskNode
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_EnemyMove();
+
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual EBTNodeResult::Type AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual void OnTaskFinished(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTNodeResult::Type TaskResult) override;
+	virtual uint16 GetInstanceMemorySize() const override;
+
+protected:
+	/**
+	 * Where to go. InProgress moves there, anything else finishes the task with that result right away.
+	 * A RandomRadius above 0 goes to a random navigable point around the goal instead.
+	 */
+	virtual EBTNodeResult::Type GetGoal(UBehaviorTreeComponent& OwnerComp, FVector& OutGoal, float& OutRandomRadius) const PURE_VIRTUAL(UBTTask_EnemyMove::GetGoal, return EBTNodeResult::Failed;);
+
+	UPROPERTY(EditAnywhere, Category=Node, meta=(ClampMin="0"))
+	float AcceptanceRadius = 50.0f;
+
+	/** Walks as far as it can when the goal can't be reached instead of failing */
+	UPROPERTY(EditAnywhere, Category=Node)
+	bool bAllowPartialPath = false;
+
+private:
+	void OnPathFound(uint32 RequestId, FNavPathSharedPtr Path, TWeakObjectPtr<UBehaviorTreeComponent> WeakOwnerComp);
+};
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_EnemyMoveRandomLocation.h"
+
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+
+UBTTask_EnemyMoveRandomLocation::UBTTask_EnemyMoveRandomLocation()
+{
+	NodeName = TEXT("Enemy Move Random Location");
+}
+
+EBTNodeResult::Type UBTTask_EnemyMoveRandomLocation::GetGoal(UBehaviorTreeComponent& OwnerComp, FVector& OutGoal, float& OutRandomRadius) const
+{
+	AAIController* Controller = OwnerComp.GetAIOwner();
+
+	// Wandering, not looking at whatever was shot at last
+	Controller->ClearFocus(EAIFocusPriority::Gameplay);
+
+	OutGoal = Controller->GetPawn()->GetActorLocation();
+	OutRandomRadius = Radius;
+	return EBTNodeResult::InProgress;
+}
+
+FString UBTTask_EnemyMoveRandomLocation::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: within %.0f"), *Super::GetStaticDescription(), Radius);
+}
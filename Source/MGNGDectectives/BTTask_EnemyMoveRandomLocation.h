@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BTTask_EnemyMove.h"
+#include "BTTask_EnemyMoveRandomLocation.generated.h"
+
+/** Native BTTask_MoveRandomLocation: wanders to a reachable random point around the pawn */
+UCLASS()
+class MGNGDECTECTIVES_API UBTTask_EnemyMoveRandomLocation : public UBTTask_EnemyMove
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_EnemyMoveRandomLocation();
+
+	virtual FString GetStaticDescription() const override;
+
+protected:
+	virtual EBTNodeResult::Type GetGoal(UBehaviorTreeComponent& OwnerComp, FVector& OutGoal, float& OutRandomRadius) const override;
+
+	UPROPERTY(EditAnywhere, Category=Node, meta=(ClampMin="1"))
+	float Radius = 1500.0f;
+};
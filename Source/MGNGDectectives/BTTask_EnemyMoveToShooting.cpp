@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_EnemyMoveToShooting.h"
+
+#include "EnemyAIManagerSubsystem.h"
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTree.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "BehaviorTree/BlackboardComponent.h"
+
+UBTTask_EnemyMoveToShooting::UBTTask_EnemyMoveToShooting()
+{
+	NodeName = TEXT("Enemy Move To Shooting");
+	AcceptanceRadius = 800.0f;
+	bAllowPartialPath = true;
+
+	TargetKey.SelectedKeyName = TEXT("TargetActor");
+	TargetKey.AddObjectFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_EnemyMoveToShooting, TargetKey), AActor::StaticClass());
+}
+
+void UBTTask_EnemyMoveToShooting::InitializeFromAsset(UBehaviorTree& Asset)
+{
+	Super::InitializeFromAsset(Asset);
+
+	if (const UBlackboardData* BlackboardAsset = GetBlackboardAsset())
+	{
+		TargetKey.ResolveSelectedKey(*BlackboardAsset);
+	}
+}
+
+EBTNodeResult::Type UBTTask_EnemyMoveToShooting::GetGoal(UBehaviorTreeComponent& OwnerComp, FVector& OutGoal, float& OutRandomRadius) const
+{
+	const AAIController* Controller = OwnerComp.GetAIOwner();
+	const UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent();
+	const AActor* Target = Blackboard ? Cast<AActor>(Blackboard->GetValueAsObject(TargetKey.SelectedKeyName)) : nullptr;
+	if (Target == nullptr)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	const UEnemyAIManagerSubsystem* Manager = Controller->GetWorld()->GetSubsystem<UEnemyAIManagerSubsystem>();
+	const FEnemyPerception* Perception = Manager ? Manager->GetPerception(Controller) : nullptr;
+	const bool bInSight = Perception != nullptr && Perception->bHasLineOfSight && Perception->Target == Target;
+
+	OutGoal = bInSight || Perception == nullptr ? Target->GetActorLocation() : Perception->LastSeenLocation;
+	OutRandomRadius = 0.0f;
+
+	if (bInSight && FVector::DistSquared(Controller->GetPawn()->GetActorLocation(), OutGoal) <= FMath::Square(ShootingRange))
+	{
+		return EBTNodeResult::Succeeded;
+	}
+	return EBTNodeResult::InProgress;
+}
+
+FString UBTTask_EnemyMoveToShooting::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: %s within %.0f"), *Super::GetStaticDescription(), *TargetKey.SelectedKeyName.ToString(), ShootingRange);
+}
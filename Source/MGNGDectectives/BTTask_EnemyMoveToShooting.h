@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BTTask_EnemyMove.h"
+#include "BehaviorTree/BehaviorTreeTypes.h"
+#include "BTTask_EnemyMoveToShooting.generated.h"
+
+/**
+ * Native BTTask_MoveToShooting: closes in on the target until it is within shooting range and in sight.
+ * Heads for where the manager last saw the target when it is out of sight.
+ */
+UCLASS()
+class MGNGDECTECTIVES_API UBTTask_EnemyMoveToShooting : public UBTTask_EnemyMove
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_EnemyMoveToShooting();
+
+	virtual void InitializeFromAsset(UBehaviorTree& Asset) override;
+	virtual FString GetStaticDescription() const override;
+
+protected:
+	virtual EBTNodeResult::Type GetGoal(UBehaviorTreeComponent& OwnerComp, FVector& OutGoal, float& OutRandomRadius) const override;
+
+	/** Actor to shoot at, written by UEnemyAIManagerSubsystem */
+	UPROPERTY(EditAnywhere, Category=Blackboard)
+	FBlackboardKeySelector TargetKey;
+
+	/** Already close enough under this distance with the target in sight, keep AcceptanceRadius below it */
+	UPROPERTY(EditAnywhere, Category=Node, meta=(ClampMin="0"))
+	float ShootingRange = 1000.0f;
+};
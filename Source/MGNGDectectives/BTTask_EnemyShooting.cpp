@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_EnemyShooting.h"
+
+#include "EnemyAIManagerSubsystem.h"
+#include "MGNGDectectives.h"
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTree.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy Shooting"), STAT_EnemyShooting, STATGROUP_MGNGDectectives);
+
+UBTTask_EnemyShooting::UBTTask_EnemyShooting()
+{
+	NodeName = TEXT("Enemy Shooting");
+
+	TargetKey.SelectedKeyName = TEXT("TargetActor");
+	TargetKey.AddObjectFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_EnemyShooting, TargetKey), AActor::StaticClass());
+}
+
+void UBTTask_EnemyShooting::InitializeFromAsset(UBehaviorTree& Asset)
+{
+	Super::InitializeFromAsset(Asset);
+
+	if (const UBlackboardData* BlackboardAsset = GetBlackboardAsset())
+	{
+		TargetKey.ResolveSelectedKey(*BlackboardAsset);
+	}
+}
+
+EBTNodeResult::Type UBTTask_EnemyShooting::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_EnemyShooting);
+
+	AAIController* Controller = OwnerComp.GetAIOwner();
+	APawn* Pawn = Controller ? Controller->GetPawn() : nullptr;
+	const UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent();
+	AActor* Target = Blackboard ? Cast<AActor>(Blackboard->GetValueAsObject(TargetKey.SelectedKeyName)) : nullptr;
+	if (Pawn == nullptr || Target == nullptr || ProjectileClass == nullptr)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	UEnemyAIManagerSubsystem* Manager = Controller->GetWorld()->GetSubsystem<UEnemyAIManagerSubsystem>();
+	const FEnemyPerception* Perception = Manager ? Manager->GetPerception(Controller) : nullptr;
+	if (Perception == nullptr || !Perception->bHasLineOfSight || Perception->Target != Target)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	const FVector TargetLocation = Target->GetActorLocation();
+	if (FVector::DistSquared(Pawn->GetActorLocation(), TargetLocation) > FMath::Square(ShootingRange))
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	Controller->SetFocus(Target);
+
+	const FVector Muzzle = Pawn->GetActorTransform().TransformPosition(MuzzleOffset);
+	const FVector Direction = Manager->GetRandom().VRandCone((TargetLocation - Muzzle).GetSafeNormal(), FMath::DegreesToRadians(Spread));
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = Pawn;
+	SpawnParams.Instigator = Pawn;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	INC_DWORD_STAT(STAT_MGNGActorSpawns);
+	return Controller->GetWorld()->SpawnActor<AActor>(ProjectileClass, Muzzle, Direction.Rotation(), SpawnParams) != nullptr
+		? EBTNodeResult::Succeeded
+		: EBTNodeResult::Failed;
+}
+
+FString UBTTask_EnemyShooting::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: %s at %s within %.0f"), *Super::GetStaticDescription(),
+		*GetNameSafe(ProjectileClass), *TargetKey.SelectedKeyName.ToString(), ShootingRange);
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTTaskNode.h"
+#include "BehaviorTree/BehaviorTreeTypes.h"
+#include "BTTask_EnemyShooting.generated.h"
+
+/**
+ * Native BTTask_Shooting: turns to the target and fires one ProjectileClass at it. Line of sight comes from
+ * UEnemyAIManagerSubsystem rather than a trace of its own; fails when the target is out of sight or range.
+ * Finishes right away, pace it with a Cooldown decorator or a Wait.
+ */
+UCLASS()
+class MGNGDECTECTIVES_API UBTTask_EnemyShooting : public UBTTaskNode
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_EnemyShooting();
+
+	virtual void InitializeFromAsset(UBehaviorTree& Asset) override;
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual FString GetStaticDescription() const override;
+
+protected:
+	UPROPERTY(EditAnywhere, Category=Blackboard)
+	FBlackboardKeySelector TargetKey;
+
+	/** BP_Bullet */
+	UPROPERTY(EditAnywhere, Category=Node)
+	TSubclassOf<AActor> ProjectileClass;
+
+	/** Where the projectile spawns, relative to the pawn */
+	UPROPERTY(EditAnywhere, Category=Node)
+	FVector MuzzleOffset = FVector(100.0f, 0.0f, 50.0f);
+
+	UPROPERTY(EditAnywhere, Category=Node, meta=(ClampMin="0"))
+	float ShootingRange = 1200.0f;
+
+	/** Half angle in degrees of the cone shots are spread over */
+	UPROPERTY(EditAnywhere, Category=Node, meta=(ClampMin="0"))
+	float Spread = 2.0f;
+};
@@ -0,0 +1,262 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CharacterSignificanceSubsystem.h"
+
+#include "MGNGDectectives.h"
+#include "MGNGDectectivesCharacter.h"
+#include "RagdollStateComponent.h"
+#include "SignificanceManager.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Character Significance"), STAT_CharacterSignificance, STATGROUP_MGNGDectectives);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Character Tick Time Saved (ms)"), STAT_CharacterTickTimeSaved, STATGROUP_MGNGDectectives);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Character Anim Updates Skipped"), STAT_CharacterAnimUpdatesSkipped, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Character Ticks"), STAT_CharacterTicks, STATGROUP_MGNGDectectives);
+
+static TAutoConsoleVariable<int32> CVarSignificanceEnable(
+	TEXT("mgng.Significance.Enable"),
+	1,
+	TEXT("0 ticks and animates every character at full rate, 1 lowers the rate of far and offscreen characters."),
+	ECVF_Default
+);
+
+static FAutoConsoleCommandWithWorld SignificanceStatsCommand(
+	TEXT("mgng.Significance.Stats"),
+	TEXT("Logs how many characters are in each significance bucket and the time saved last frame."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UCharacterSignificanceSubsystem* Significance = World ? World->GetSubsystem<UCharacterSignificanceSubsystem>() : nullptr)
+		{
+			Significance->LogStats();
+		}
+	})
+);
+
+namespace CharacterSignificance
+{
+	const FName Tag(TEXT("MGNGCharacter"));
+}
+
+bool UCharacterSignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UCharacterSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCharacterSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+void UCharacterSignificanceSubsystem::Deinitialize()
+{
+	Characters.Empty();
+	Viewpoints.Empty();
+
+	Super::Deinitialize();
+}
+
+void UCharacterSignificanceSubsystem::Register(AMGNGDectectivesCharacter* Character)
+{
+	USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(GetWorld());
+	if (SignificanceManager == nullptr || Characters.Contains(Character))
+	{
+		return;
+	}
+	Characters.Add(Character);
+
+	// Scored on worker threads, so the score only reads; the result is applied on the game thread
+	SignificanceManager->RegisterObject(Character, CharacterSignificance::Tag,
+		[this](USignificanceManager::FManagedObjectInfo* Info, const FTransform& Viewpoint)
+		{
+			return CalculateSignificance(CastChecked<AMGNGDectectivesCharacter>(Info->GetObject()), Viewpoint);
+		},
+		USignificanceManager::EPostSignificanceType::Sequential,
+		[this](USignificanceManager::FManagedObjectInfo* Info, float OldSignificance, float Significance, bool bFinal)
+		{
+			if (bFinal || OldSignificance != Significance)
+			{
+				ApplySignificance(CastChecked<AMGNGDectectivesCharacter>(Info->GetObject()), bFinal ? MAX_flt : Significance);
+			}
+		});
+}
+
+void UCharacterSignificanceSubsystem::Unregister(AMGNGDectectivesCharacter* Character)
+{
+	if (Characters.RemoveSwap(Character) == 0)
+	{
+		return;
+	}
+
+	if (USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(GetWorld()))
+	{
+		SignificanceManager->UnregisterObject(Character);
+	}
+}
+
+float UCharacterSignificanceSubsystem::CalculateSignificance(const AMGNGDectectivesCharacter* Character, const FTransform& Viewpoint) const
+{
+	const float Top = static_cast<float>(FMath::Max(Buckets.Num(), 1));
+	if (Character->IsPlayerControlled() && Character->IsLocallyControlled())
+	{
+		return Top;
+	}
+
+	// A dedicated server renders nothing, distance is all it has
+	if (Character->GetNetMode() != NM_DedicatedServer && !Character->GetMesh()->WasRecentlyRendered(RecentlyRenderedTime))
+	{
+		return 0.0f;
+	}
+
+	const float DistanceSquared = FVector::DistSquared(Character->GetActorLocation(), Viewpoint.GetLocation());
+	for (int32 Index = 0; Index < Buckets.Num(); ++Index)
+	{
+		const float MaxDistance = Buckets[Index].MaxDistance;
+		if (MaxDistance <= 0.0f || DistanceSquared <= FMath::Square(MaxDistance))
+		{
+			return Top - Index;
+		}
+	}
+	return 1.0f;
+}
+
+void UCharacterSignificanceSubsystem::ApplySignificance(AMGNGDectectivesCharacter* Character, float Significance)
+{
+	if (Buckets.Num() == 0 || !bEnabled || Significance == MAX_flt)
+	{
+		ApplyBucket(Character, FCharacterSignificanceBucket(), false);
+	}
+	else if (Significance <= 0.0f)
+	{
+		ApplyBucket(Character, OffscreenBucket, true);
+	}
+	else
+	{
+		const int32 Index = FMath::Clamp(Buckets.Num() - FMath::RoundToInt(Significance), 0, Buckets.Num() - 1);
+		ApplyBucket(Character, Buckets[Index], false);
+	}
+}
+
+void UCharacterSignificanceSubsystem::ApplyBucket(AMGNGDectectivesCharacter* Character, const FCharacterSignificanceBucket& Bucket, bool bOffscreen)
+{
+	Character->SetActorTickInterval(Bucket.TickInterval);
+
+	// Wherever there is authority ULagCompensationSubsystem records hitboxes from the bones every frame
+	if (Character->GetNetMode() == NM_Client)
+	{
+		Character->GetMesh()->SetComponentTickInterval(Bucket.AnimTickInterval);
+	}
+	Character->GetRagdollState()->SetFrozen(bOffscreen);
+}
+
+void UCharacterSignificanceSubsystem::GatherViewpoints()
+{
+	Viewpoints.Reset();
+
+	// Locally controlled views where something is rendered, every player's view on a dedicated server
+	const bool bDedicatedServer = GetWorld()->GetNetMode() == NM_DedicatedServer;
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		if (PlayerController == nullptr || (!bDedicatedServer && !PlayerController->IsLocalController()))
+		{
+			continue;
+		}
+
+		FVector Location;
+		FRotator Rotation;
+		PlayerController->GetPlayerViewPoint(Location, Rotation);
+		Viewpoints.Emplace(Rotation, Location);
+	}
+}
+
+void UCharacterSignificanceSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharacterSignificance);
+
+	// Tickables run after the actors, so this frame's character Ticks are all in
+	if (FrameTicks > 0)
+	{
+		const double FrameAverage = FrameTickSeconds / FrameTicks;
+		AverageTickSeconds = AverageTickSeconds > 0.0 ? FMath::Lerp(AverageTickSeconds, FrameAverage, 0.1) : FrameAverage;
+	}
+	const int32 SkippedTicks = FMath::Max(Characters.Num() - FrameTicks, 0);
+	LastSavedMs = SkippedTicks * AverageTickSeconds * 1000.0;
+
+	LastSkippedAnimUpdates = 0.0f;
+	for (const AMGNGDectectivesCharacter* Character : Characters)
+	{
+		const float AnimTickInterval = Character->GetMesh()->GetComponentTickInterval();
+		if (AnimTickInterval > DeltaTime)
+		{
+			LastSkippedAnimUpdates += 1.0f - DeltaTime / AnimTickInterval;
+		}
+	}
+
+	SET_FLOAT_STAT(STAT_CharacterTickTimeSaved, LastSavedMs);
+	SET_FLOAT_STAT(STAT_CharacterAnimUpdatesSkipped, LastSkippedAnimUpdates);
+	SET_DWORD_STAT(STAT_CharacterTicks, FrameTicks);
+	FrameTickSeconds = 0.0;
+	FrameTicks = 0;
+
+	USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(GetWorld());
+	const bool bWasEnabled = bEnabled;
+	bEnabled = CVarSignificanceEnable.GetValueOnGameThread() != 0;
+	if (!bEnabled)
+	{
+		if (bWasEnabled)
+		{
+			for (AMGNGDectectivesCharacter* Character : Characters)
+			{
+				ApplyBucket(Character, FCharacterSignificanceBucket(), false);
+			}
+		}
+		return;
+	}
+
+	if (SignificanceManager == nullptr)
+	{
+		return;
+	}
+
+	if (!bWasEnabled)
+	{
+		// The post significance callback only fires on changes, put back what was last scored
+		for (AMGNGDectectivesCharacter* Character : Characters)
+		{
+			ApplySignificance(Character, SignificanceManager->GetSignificance(Character));
+		}
+	}
+
+	GatherViewpoints();
+	if (Viewpoints.Num() > 0)
+	{
+		SignificanceManager->Update(Viewpoints);
+	}
+}
+
+void UCharacterSignificanceSubsystem::LogStats() const
+{
+	TArray<int32> PerBucket;
+	PerBucket.SetNumZeroed(Buckets.Num() + 1);
+	if (const USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(GetWorld()))
+	{
+		for (const AMGNGDectectivesCharacter* Character : Characters)
+		{
+			const float Significance = SignificanceManager->GetSignificance(Character);
+			const int32 Index = Significance <= 0.0f ? Buckets.Num() : FMath::Clamp(Buckets.Num() - FMath::RoundToInt(Significance), 0, Buckets.Num() - 1);
+			++PerBucket[Index];
+		}
+	}
+
+	FString Counts;
+	for (int32 Index = 0; Index < Buckets.Num(); ++Index)
+	{
+		Counts += FString::Printf(TEXT("%d "), PerBucket[Index]);
+	}
+	UE_LOG(LogMGNGDectectives, Display, TEXT("Character significance: %d characters, per bucket [ %s] offscreen %d, saved %.3f ms last frame, %.1f anim updates skipped, %.3f ms per Tick"),
+		Characters.Num(), *Counts, PerBucket[Buckets.Num()], LastSavedMs, LastSkippedAnimUpdates, AverageTickSeconds * 1000.0);
+}
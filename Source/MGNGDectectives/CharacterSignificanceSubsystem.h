@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CharacterSignificanceSubsystem.generated.h"
+
+class AMGNGDectectivesCharacter;
+class USignificanceManager;
+
+/** How often a character in one significance bucket ticks */
+USTRUCT()
+struct FCharacterSignificanceBucket
+{
+	GENERATED_BODY()
+
+	/** Characters up to this far from the closest viewer, 0 takes everything further than the previous bucket */
+	UPROPERTY()
+	float MaxDistance = 0.0f;
+
+	/** Seconds between two character Ticks, 0 every frame */
+	UPROPERTY()
+	float TickInterval = 0.0f;
+
+	/** Seconds between two animation updates of the mesh, 0 every frame */
+	UPROPERTY()
+	float AnimTickInterval = 0.0f;
+};
+
+/**
+ * Scores every AMGNGDectectivesCharacter through the engine's USignificanceManager by its distance to the
+ * closest viewer and, on machines that render, by whether it was on screen. The score picks one of Buckets,
+ * or OffscreenBucket, which sets the character's tick interval and its mesh's animation tick interval.
+ * Offscreen ragdolls on remote machines are frozen until they are seen again.
+ * Locally controlled players always stay in the first bucket. Only clients throttle the mesh, on a listen or
+ * dedicated server lag compensated hitboxes read its bones every frame and only the character Tick is throttled.
+ *
+ * "stat MGNGDectectives" shows the time saved per frame, estimated from the skipped Ticks and the
+ * measured cost of the ones that ran. mgng.Significance.Enable 0 puts every character back to full rate.
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API UCharacterSignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override { return Characters.Num() > 0; }
+
+	void Register(AMGNGDectectivesCharacter* Character);
+	void Unregister(AMGNGDectectivesCharacter* Character);
+
+	/** Called at the end of every character Tick with what it cost */
+	FORCEINLINE void AddTickTime(double Seconds) { FrameTickSeconds += Seconds; ++FrameTicks; }
+
+	/** Estimated game thread time the budget saved last frame */
+	FORCEINLINE double GetLastSavedMs() const { return LastSavedMs; }
+
+	void LogStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Nearest first, a character falls in the first bucket it is close enough for */
+	UPROPERTY(Config)
+	TArray<FCharacterSignificanceBucket> Buckets;
+
+	/** Used on rendering machines for characters that weren't on screen for RecentlyRenderedTime */
+	UPROPERTY(Config)
+	FCharacterSignificanceBucket OffscreenBucket;
+
+	UPROPERTY(Config)
+	float RecentlyRenderedTime = 0.25f;
+
+private:
+	float CalculateSignificance(const AMGNGDectectivesCharacter* Character, const FTransform& Viewpoint) const;
+	void ApplySignificance(AMGNGDectectivesCharacter* Character, float Significance);
+
+	/** Sets the tick intervals of Bucket and freezes or thaws an offscreen ragdoll */
+	void ApplyBucket(AMGNGDectectivesCharacter* Character, const FCharacterSignificanceBucket& Bucket, bool bOffscreen);
+
+	void GatherViewpoints();
+
+	UPROPERTY()
+	TArray<AMGNGDectectivesCharacter*> Characters;
+
+	TArray<FTransform> Viewpoints;
+
+	bool bEnabled = true;
+
+	// Per frame measurement, reset every Tick
+	double FrameTickSeconds = 0.0;
+	int32 FrameTicks = 0;
+
+	/** Running average cost of one character Tick */
+	double AverageTickSeconds = 0.0;
+	double LastSavedMs = 0.0;
+	float LastSkippedAnimUpdates = 0.0f;
+};
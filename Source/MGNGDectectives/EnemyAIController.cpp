@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyAIController.h"
+
+#include "EnemyAIManagerSubsystem.h"
+#include "MGNGDectectives.h"
+#include "BehaviorTree/BehaviorTree.h"
+#include "Engine/World.h"
+
+void AEnemyAIController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	if (UEnemyAIManagerSubsystem* Manager = GetWorld()->GetSubsystem<UEnemyAIManagerSubsystem>())
+	{
+		Manager->Register(this);
+	}
+
+	UBehaviorTree* Tree = BehaviorTree != nullptr ? BehaviorTree : FallbackBehaviorTree.LoadSynchronous();
+	if (Tree != nullptr)
+	{
+		RunBehaviorTree(Tree);
+	}
+	else
+	{
+		UE_LOG(LogMGNGDectectives, Warning, TEXT("%s has no behavior tree to run"), *GetName());
+	}
+}
+
+void AEnemyAIController::OnUnPossess()
+{
+	if (UEnemyAIManagerSubsystem* Manager = GetWorld()->GetSubsystem<UEnemyAIManagerSubsystem>())
+	{
+		Manager->Unregister(this);
+	}
+
+	Super::OnUnPossess();
+}
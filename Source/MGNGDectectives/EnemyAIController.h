@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "EnemyAIController.generated.h"
+
+class UBehaviorTree;
+
+/**
+ * Controller of the enemies. Runs BehaviorTree on possess and registers with UEnemyAIManagerSubsystem, which looks
+ * for targets and finds paths for it inside the manager's frame budget. Meant as the parent of AI_Enemy, with a
+ * tree built from the native UBTTask_Enemy* tasks, so nothing of the enemy runs every frame on its own.
+ * Without a BehaviorTree it runs FallbackBehaviorTree, BT_Enemy with the Blueprint tasks.
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API AEnemyAIController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	/** Takes effect on the next possess, which is when the tree starts */
+	void SetBehaviorTree(UBehaviorTree* InBehaviorTree) { BehaviorTree = InBehaviorTree; }
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+	virtual void OnUnPossess() override;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=AI)
+	UBehaviorTree* BehaviorTree;
+
+	/** Run when BehaviorTree isn't set, until a tree with the native tasks has been authored */
+	UPROPERTY(Config)
+	TSoftObjectPtr<UBehaviorTree> FallbackBehaviorTree;
+};
@@ -0,0 +1,416 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyAIManagerSubsystem.h"
+
+#include "FixedStepSimulation.h"
+#include "MGNGDectectives.h"
+#include "MGNGDectectivesCharacter.h"
+#include "AIController.h"
+#include "NavigationData.h"
+#include "NavigationSystem.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "NavFilters/NavigationQueryFilter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy AI Manager"), STAT_EnemyAIManager, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Enemy AI Perception"), STAT_EnemyAIPerception, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Enemy AI Path Start"), STAT_EnemyAIPathStart, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy AI Perception Updates"), STAT_EnemyAIPerceptionUpdates, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy AI Paths Started"), STAT_EnemyAIPathsStarted, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Enemy AI Agents"), STAT_EnemyAIAgents, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Enemy AI Paths Queued"), STAT_EnemyAIPathsQueued, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Enemy AI Paths In Flight"), STAT_EnemyAIPathsInFlight, STATGROUP_MGNGDectectives);
+
+static FAutoConsoleCommandWithWorld EnemyAIStatsCommand(
+	TEXT("mgng.AI.Stats"),
+	TEXT("Logs the registered enemies, the queued and running path requests and the last frame's AI manager time."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UEnemyAIManagerSubsystem* Manager = World ? World->GetSubsystem<UEnemyAIManagerSubsystem>() : nullptr)
+		{
+			Manager->LogStats();
+		}
+	})
+);
+
+bool UEnemyAIManagerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UEnemyAIManagerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEnemyAIManagerSubsystem, STATGROUP_Tickables);
+}
+
+void UEnemyAIManagerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	Random = FFixedStepSimulation::MakeRandomStream(TEXT("EnemyAI"));
+}
+
+void UEnemyAIManagerSubsystem::Deinitialize()
+{
+	if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
+	{
+		for (const TPair<uint32, FPathRequest>& Running : RunningPaths)
+		{
+			NavSys->AbortAsyncFindPathRequest(Running.Key);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_EnemyAIAgents, 0);
+	SET_DWORD_STAT(STAT_EnemyAIPathsQueued, 0);
+	SET_DWORD_STAT(STAT_EnemyAIPathsInFlight, 0);
+	Agents.Empty();
+	Targets.Empty();
+	QueuedPaths.Empty();
+	RunningPaths.Empty();
+
+	Super::Deinitialize();
+}
+
+void UEnemyAIManagerSubsystem::Register(AAIController* Controller)
+{
+	if (Controller == nullptr || FindAgent(Controller) != nullptr)
+	{
+		return;
+	}
+
+	// Spread the first looks over one interval rather than having every enemy spawned this frame look at once
+	FAgent& Agent = Agents.AddDefaulted_GetRef();
+	Agent.Controller = Controller;
+	Agent.NextPerceptionTime = GetWorld()->GetTimeSeconds() + Random.FRand() * PerceptionInterval;
+	SET_DWORD_STAT(STAT_EnemyAIAgents, Agents.Num());
+}
+
+void UEnemyAIManagerSubsystem::Unregister(AAIController* Controller)
+{
+	const int32 Index = Agents.IndexOfByPredicate([Controller](const FAgent& Agent) { return Agent.Controller == Controller; });
+	if (Index != INDEX_NONE)
+	{
+		Agents.RemoveAtSwap(Index);
+		SET_DWORD_STAT(STAT_EnemyAIAgents, Agents.Num());
+	}
+
+	QueuedPaths.RemoveAll([Controller](const FPathRequest& Request) { return Request.Controller == Controller; });
+	SET_DWORD_STAT(STAT_EnemyAIPathsQueued, QueuedPaths.Num());
+}
+
+UEnemyAIManagerSubsystem::FAgent* UEnemyAIManagerSubsystem::FindAgent(const AAIController* Controller)
+{
+	return Agents.FindByPredicate([Controller](const FAgent& Agent) { return Agent.Controller.Get() == Controller; });
+}
+
+const FEnemyPerception* UEnemyAIManagerSubsystem::GetPerception(const AAIController* Controller) const
+{
+	const FAgent* Agent = Agents.FindByPredicate([Controller](const FAgent& Candidate) { return Candidate.Controller.Get() == Controller; });
+	return Agent ? &Agent->Perception : nullptr;
+}
+
+uint32 UEnemyAIManagerSubsystem::RequestPath(AAIController* Controller, const FVector& Goal, float RandomRadius, FOnEnemyPathFound OnFound)
+{
+	if (Controller == nullptr || Controller->GetPawn() == nullptr)
+	{
+		return 0;
+	}
+
+	FPathRequest& Request = QueuedPaths.AddDefaulted_GetRef();
+	Request.Id = NextRequestId++;
+	Request.Controller = Controller;
+	Request.Goal = Goal;
+	Request.RandomRadius = RandomRadius;
+	Request.OnFound = MoveTemp(OnFound);
+	if (NextRequestId == 0)
+	{
+		NextRequestId = 1;
+	}
+
+	SET_DWORD_STAT(STAT_EnemyAIPathsQueued, QueuedPaths.Num());
+	return Request.Id;
+}
+
+void UEnemyAIManagerSubsystem::CancelPath(uint32 RequestId)
+{
+	if (RequestId == 0)
+	{
+		return;
+	}
+
+	if (QueuedPaths.RemoveAll([RequestId](const FPathRequest& Request) { return Request.Id == RequestId; }) > 0)
+	{
+		SET_DWORD_STAT(STAT_EnemyAIPathsQueued, QueuedPaths.Num());
+		return;
+	}
+
+	for (auto It = RunningPaths.CreateIterator(); It; ++It)
+	{
+		if (It->Value.Id == RequestId)
+		{
+			if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
+			{
+				NavSys->AbortAsyncFindPathRequest(It->Key);
+			}
+			It.RemoveCurrent();
+			SET_DWORD_STAT(STAT_EnemyAIPathsInFlight, RunningPaths.Num());
+			return;
+		}
+	}
+}
+
+void UEnemyAIManagerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyAIManager);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Deadline = StartTime + FrameBudgetMs / 1000.0;
+	LastPerceptionUpdates = 0;
+	LastPathsStarted = 0;
+
+	// A fixed step run can't let the wall clock decide how much gets done, there every due look happens and
+	// MaxPathsInFlight paths are searched a frame
+	const bool bFixedStep = FFixedStepSimulation::IsEnabled();
+	auto IsOverBudget = [bFixedStep, Deadline]() { return !bFixedStep && FPlatformTime::Seconds() >= Deadline; };
+
+	// Starting a query only copies it over, the search runs on the navigation system's worker
+	while (QueuedPaths.Num() > 0 && RunningPaths.Num() + (bFixedStep ? LastPathsStarted : 0) < MaxPathsInFlight && !IsOverBudget())
+	{
+		FPathRequest Request = MoveTemp(QueuedPaths[0]);
+		QueuedPaths.RemoveAt(0, 1, false);
+		if (!StartPath(Request))
+		{
+			Request.OnFound.ExecuteIfBound(Request.Id, FNavPathSharedPtr());
+		}
+	}
+
+	if (Agents.Num() > 0)
+	{
+		GatherTargets();
+
+		const float Now = GetWorld()->GetTimeSeconds();
+		for (int32 Visited = 0; Visited < Agents.Num(); ++Visited)
+		{
+			if (LastPerceptionUpdates > 0 && IsOverBudget())
+			{
+				break;
+			}
+
+			NextAgent = NextAgent < Agents.Num() ? NextAgent : 0;
+			FAgent& Agent = Agents[NextAgent++];
+			if (Agent.NextPerceptionTime <= Now)
+			{
+				Agent.NextPerceptionTime = Now + PerceptionInterval;
+				UpdatePerception(Agent);
+				++LastPerceptionUpdates;
+			}
+		}
+	}
+
+	LastUpdateMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	INC_DWORD_STAT_BY(STAT_EnemyAIPerceptionUpdates, LastPerceptionUpdates);
+	INC_DWORD_STAT_BY(STAT_EnemyAIPathsStarted, LastPathsStarted);
+	SET_DWORD_STAT(STAT_EnemyAIPathsQueued, QueuedPaths.Num());
+	SET_DWORD_STAT(STAT_EnemyAIPathsInFlight, RunningPaths.Num());
+}
+
+void UEnemyAIManagerSubsystem::GatherTargets()
+{
+	Targets.Reset();
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		APawn* Pawn = Iterator->Get() ? Iterator->Get()->GetPawn() : nullptr;
+		if (Pawn == nullptr)
+		{
+			continue;
+		}
+
+		const AMGNGDectectivesCharacter* Character = Cast<AMGNGDectectivesCharacter>(Pawn);
+		if (Character == nullptr || !Character->isRagdoll)
+		{
+			Targets.Add(Pawn);
+		}
+	}
+}
+
+void UEnemyAIManagerSubsystem::UpdatePerception(FAgent& Agent)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyAIPerception);
+
+	AAIController* Controller = Agent.Controller.Get();
+	const APawn* Pawn = Controller ? Controller->GetPawn() : nullptr;
+	if (Pawn == nullptr)
+	{
+		return;
+	}
+
+	const FVector Eyes = Pawn->GetPawnViewLocation();
+	const FVector Forward = Pawn->GetActorForwardVector();
+	const float MinDot = FMath::Cos(FMath::DegreesToRadians(SightHalfAngle));
+
+	// Closest targets first, inside the radius and the cone
+	TArray<TPair<float, AActor*>, TInlineAllocator<8>> Candidates;
+	for (const TWeakObjectPtr<APawn>& WeakTarget : Targets)
+	{
+		APawn* Target = WeakTarget.Get();
+		if (Target == nullptr)
+		{
+			continue;
+		}
+
+		const FVector ToTarget = Target->GetActorLocation() - Eyes;
+		const float DistanceSquared = ToTarget.SizeSquared();
+		if (DistanceSquared > FMath::Square(SightRadius))
+		{
+			continue;
+		}
+		if (SightHalfAngle < 180.0f && FVector::DotProduct(Forward, ToTarget.GetSafeNormal()) < MinDot)
+		{
+			continue;
+		}
+		Candidates.Emplace(DistanceSquared, Target);
+	}
+	Candidates.Sort([](const TPair<float, AActor*>& A, const TPair<float, AActor*>& B) { return A.Key < B.Key; });
+
+	// The current target is kept while it stays in sight, so enemies don't flip between two players
+	AActor* NewTarget = nullptr;
+	AActor* CurrentTarget = Agent.Perception.Target.Get();
+	const bool bCurrentIsCandidate = CurrentTarget != nullptr && Candidates.ContainsByPredicate([CurrentTarget](const TPair<float, AActor*>& Candidate) { return Candidate.Value == CurrentTarget; });
+	if (bCurrentIsCandidate && HasLineOfSight(Pawn, Eyes, CurrentTarget))
+	{
+		NewTarget = CurrentTarget;
+	}
+	else
+	{
+		int32 Traces = 0;
+		for (const TPair<float, AActor*>& Candidate : Candidates)
+		{
+			if (Candidate.Value == CurrentTarget)
+			{
+				continue;
+			}
+			if (Traces++ >= MaxSightTraces)
+			{
+				break;
+			}
+			if (HasLineOfSight(Pawn, Eyes, Candidate.Value))
+			{
+				NewTarget = Candidate.Value;
+				break;
+			}
+		}
+	}
+
+	FEnemyPerception& Perception = Agent.Perception;
+	const bool bHadLineOfSight = Perception.bHasLineOfSight;
+	const AActor* OldTarget = Perception.Target.Get();
+	Perception.bHasLineOfSight = NewTarget != nullptr;
+	if (NewTarget != nullptr)
+	{
+		Perception.Target = NewTarget;
+		Perception.LastSeenLocation = NewTarget->GetActorLocation();
+	}
+
+	// Out of sight the target is remembered, the tree goes after the last seen location
+	UBlackboardComponent* Blackboard = Controller->GetBlackboardComponent();
+	if (Blackboard == nullptr)
+	{
+		return;
+	}
+	if (Perception.Target.Get() != OldTarget)
+	{
+		Blackboard->SetValueAsObject(TargetKeyName, Perception.Target.Get());
+	}
+	if (Perception.bHasLineOfSight != bHadLineOfSight)
+	{
+		Blackboard->SetValueAsBool(LineOfSightKeyName, Perception.bHasLineOfSight);
+	}
+}
+
+bool UEnemyAIManagerSubsystem::HasLineOfSight(const APawn* Pawn, const FVector& Eyes, const AActor* Target) const
+{
+	INC_DWORD_STAT(STAT_MGNGSceneQueries);
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(EnemySight), false, Pawn);
+	FHitResult Hit;
+	const bool bBlocked = GetWorld()->LineTraceSingleByChannel(Hit, Eyes, Target->GetActorLocation(), ECC_Visibility, Params);
+	return !bBlocked || Hit.GetActor() == Target;
+}
+
+bool UEnemyAIManagerSubsystem::StartPath(FPathRequest& Request)
+{
+	SCOPE_CYCLE_COUNTER(STAT_EnemyAIPathStart);
+
+	AAIController* Controller = Request.Controller.Get();
+	const APawn* Pawn = Controller ? Controller->GetPawn() : nullptr;
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (Pawn == nullptr || NavSys == nullptr)
+	{
+		return false;
+	}
+
+	const FNavAgentProperties& AgentProperties = Controller->GetNavAgentPropertiesRef();
+	const ANavigationData* NavData = NavSys->GetNavDataForProps(AgentProperties, Pawn->GetNavAgentLocation());
+	if (NavData == nullptr)
+	{
+		return false;
+	}
+	FSharedConstNavQueryFilter Filter = UNavigationQueryFilter::GetQueryFilter(*NavData, Controller, Controller->GetDefaultNavigationFilterClass());
+
+	FVector Goal = Request.Goal;
+	if (Request.RandomRadius > 0.0f)
+	{
+		// Reachability is left to the path itself, which is partial when the point can't be reached
+		FNavLocation RandomPoint;
+		if (!NavSys->GetRandomPointInNavigableRadius(Request.Goal, Request.RandomRadius, RandomPoint, NavData, Filter))
+		{
+			return false;
+		}
+		Goal = RandomPoint.Location;
+	}
+
+	FPathFindingQuery Query(Controller, *NavData, Pawn->GetNavAgentLocation(), Goal, Filter);
+	Query.SetAllowPartialPaths(true);
+
+	if (FFixedStepSimulation::IsEnabled())
+	{
+		// Async results land on whichever frame the worker gets to them, a fixed step run searches in queue order
+		const FPathFindingResult Result = NavSys->FindPathSync(AgentProperties, Query, EPathFindingMode::Regular);
+		++LastPathsStarted;
+		Request.OnFound.ExecuteIfBound(Request.Id, Result.IsSuccessful() && Result.Path.IsValid() ? Result.Path : FNavPathSharedPtr());
+		return true;
+	}
+
+	const uint32 QueryId = NavSys->FindPathAsync(AgentProperties, Query, FNavPathQueryDelegate::CreateUObject(this, &ThisClass::OnPathQueryFinished), EPathFindingMode::Regular);
+	if (QueryId == INVALID_NAVQUERYID)
+	{
+		return false;
+	}
+
+	RunningPaths.Add(QueryId, MoveTemp(Request));
+	++LastPathsStarted;
+	return true;
+}
+
+void UEnemyAIManagerSubsystem::OnPathQueryFinished(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path)
+{
+	FPathRequest Request;
+	if (!RunningPaths.RemoveAndCopyValue(QueryId, Request))
+	{
+		// Cancelled while it was running
+		return;
+	}
+	SET_DWORD_STAT(STAT_EnemyAIPathsInFlight, RunningPaths.Num());
+
+	const bool bFound = Result == ENavigationQueryResult::Success && Path.IsValid() && Request.Controller.IsValid();
+	Request.OnFound.ExecuteIfBound(Request.Id, bFound ? Path : FNavPathSharedPtr());
+}
+
+void UEnemyAIManagerSubsystem::LogStats() const
+{
+	UE_LOG(LogMGNGDectectives, Display, TEXT("Enemy AI: %d agents, %d targets, %d paths queued, %d running, last frame %.3f ms of %.3f ms budget, %d looks, %d paths started"),
+		Agents.Num(), Targets.Num(), QueuedPaths.Num(), RunningPaths.Num(), LastUpdateMs, FrameBudgetMs, LastPerceptionUpdates, LastPathsStarted);
+}
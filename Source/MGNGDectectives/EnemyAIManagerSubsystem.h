@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnemyAIManagerSubsystem.generated.h"
+
+class AAIController;
+
+/** Path found for a RequestPath call, null when there is none. Partial paths are passed on, the caller decides */
+DECLARE_DELEGATE_TwoParams(FOnEnemyPathFound, uint32 /*RequestId*/, FNavPathSharedPtr /*Path*/);
+
+/** What the manager last saw for one enemy */
+struct FEnemyPerception
+{
+	TWeakObjectPtr<AActor> Target;
+	FVector LastSeenLocation = FVector::ZeroVector;
+	bool bHasLineOfSight = false;
+};
+
+/**
+ * Runs the expensive half of the enemy AI for every AEnemyAIController in the world, inside FrameBudgetMs a frame.
+ * Perception goes round robin, each enemy looking for the closest player pawn at most every PerceptionInterval and
+ * writing what it found into its blackboard. Path requests are queued and handed to the navigation system's async
+ * pathfinding at most MaxPathsInFlight at a time, the result coming back to the task that asked on the game thread.
+ * Whatever doesn't fit in a frame waits for the next, so the cost stays flat as enemies are added and only the
+ * time between two looks of the same enemy grows. mgng.AI.Stats logs the queues.
+ * Under FFixedStepSimulation the budget is a count instead and paths are searched synchronously in queue order.
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API UEnemyAIManagerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void Register(AAIController* Controller);
+	void Unregister(AAIController* Controller);
+
+	/** Null for a controller that isn't registered */
+	const FEnemyPerception* GetPerception(const AAIController* Controller) const;
+
+	/**
+	 * Queues a path from the controller's pawn to Goal, or to a random navigable point within RandomRadius of it.
+	 * Returns the id OnFound is called with, 0 if it can't be queued.
+	 */
+	uint32 RequestPath(AAIController* Controller, const FVector& Goal, float RandomRadius, FOnEnemyPathFound OnFound);
+
+	/** Drops a queued or running request, its delegate won't be called */
+	void CancelPath(uint32 RequestId);
+
+	/** Seeded from the run seed, for the enemies' own random choices */
+	FORCEINLINE FRandomStream& GetRandom() { return Random; }
+
+	FORCEINLINE int32 GetNumAgents() const { return Agents.Num(); }
+	FORCEINLINE int32 GetNumQueuedPaths() const { return QueuedPaths.Num(); }
+	FORCEINLINE double GetLastUpdateMs() const { return LastUpdateMs; }
+
+	/** Perception updates and path requests handed out last frame */
+	FORCEINLINE int32 GetLastPerceptionUpdates() const { return LastPerceptionUpdates; }
+	FORCEINLINE int32 GetLastPathsStarted() const { return LastPathsStarted; }
+
+	void LogStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Game thread time the manager may spend a frame, at least one perception update happens regardless */
+	UPROPERTY(Config)
+	float FrameBudgetMs = 0.5f;
+
+	/** Seconds between two looks of the same enemy when the budget allows */
+	UPROPERTY(Config)
+	float PerceptionInterval = 0.2f;
+
+	UPROPERTY(Config)
+	float SightRadius = 3000.0f;
+
+	/** Half angle of the sight cone in degrees, 180 to see all around */
+	UPROPERTY(Config)
+	float SightHalfAngle = 70.0f;
+
+	/** Line of sight traces one look may spend on targets other than the current one */
+	UPROPERTY(Config)
+	int32 MaxSightTraces = 2;
+
+	/** Async path queries running at once, the rest wait in the queue */
+	UPROPERTY(Config)
+	int32 MaxPathsInFlight = 8;
+
+	/** Blackboard keys the perception is written to, skipped if BB_Enemy doesn't have them */
+	UPROPERTY(Config)
+	FName TargetKeyName = TEXT("TargetActor");
+
+	UPROPERTY(Config)
+	FName LineOfSightKeyName = TEXT("HasLineOfSight");
+
+private:
+	struct FAgent
+	{
+		TWeakObjectPtr<AAIController> Controller;
+		FEnemyPerception Perception;
+		float NextPerceptionTime = 0.0f;
+	};
+
+	struct FPathRequest
+	{
+		uint32 Id = 0;
+		TWeakObjectPtr<AAIController> Controller;
+		FVector Goal = FVector::ZeroVector;
+		float RandomRadius = 0.0f;
+		FOnEnemyPathFound OnFound;
+	};
+
+	void GatherTargets();
+	void UpdatePerception(FAgent& Agent);
+	bool HasLineOfSight(const APawn* Pawn, const FVector& Eyes, const AActor* Target) const;
+
+	/** Hands a queued request to the navigation system, false if it failed right away. Searches it right away under a fixed step */
+	bool StartPath(FPathRequest& Request);
+	void OnPathQueryFinished(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path);
+
+	FAgent* FindAgent(const AAIController* Controller);
+
+	TArray<FAgent> Agents;
+	int32 NextAgent = 0;
+
+	/** Player pawns that can be targeted, gathered once a frame */
+	TArray<TWeakObjectPtr<APawn>> Targets;
+
+	TArray<FPathRequest> QueuedPaths;
+
+	/** Requests running on the navigation system by query id */
+	TMap<uint32, FPathRequest> RunningPaths;
+	uint32 NextRequestId = 1;
+
+	FRandomStream Random;
+
+	double LastUpdateMs = 0.0;
+	int32 LastPerceptionUpdates = 0;
+	int32 LastPathsStarted = 0;
+};
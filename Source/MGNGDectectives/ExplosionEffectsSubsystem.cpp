@@ -0,0 +1,291 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ExplosionEffectsSubsystem.h"
+
+#include "MGNGDectectives.h"
+#include "Components/AudioComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Sound/SoundAttenuation.h"
+#include "Sound/SoundBase.h"
+
+DECLARE_CYCLE_STAT(TEXT("Explosion Effects"), STAT_ExplosionEffects, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Explosion Effects Played"), STAT_ExplosionEffectsPlayed, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Explosion Effects Culled"), STAT_ExplosionEffectsCulled, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Explosion Effects Reused"), STAT_ExplosionEffectsReused, STATGROUP_MGNGDectectives);
+
+static FAutoConsoleCommandWithWorldAndArgs ExplosionEffectsStatsCommand(
+	TEXT("mgng.Effects.Stats"),
+	TEXT("Logs how many explosion effects were played, culled and reused. Args: [reset]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UExplosionEffectsSubsystem* Effects = World ? World->GetSubsystem<UExplosionEffectsSubsystem>() : nullptr)
+		{
+			Effects->LogStats();
+			if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+			{
+				Effects->ResetCounters();
+			}
+		}
+	})
+);
+
+bool UExplosionEffectsSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Nobody listens or looks on a dedicated server
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UExplosionEffectsSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UExplosionEffectsSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Loaded with the map, never in the middle of a match
+	LoadedAttenuation = Attenuation.LoadSynchronous();
+}
+
+void UExplosionEffectsSubsystem::Deinitialize()
+{
+	AudioPool.Empty();
+	ParticlePool.Empty();
+	RecentExplosions.Empty();
+	Host = nullptr;
+	LoadedAttenuation = nullptr;
+
+	Super::Deinitialize();
+}
+
+AActor* UExplosionEffectsSubsystem::GetHost()
+{
+	if (Host == nullptr)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Host = GetWorld()->SpawnActor<AActor>(SpawnParams);
+
+		USceneComponent* Root = NewObject<USceneComponent>(Host, TEXT("Root"));
+		Host->SetRootComponent(Root);
+		Root->RegisterComponent();
+	}
+	return Host;
+}
+
+float UExplosionEffectsSubsystem::GetListenerDistanceSquared(const FVector& Location) const
+{
+	float ClosestSquared = MAX_flt;
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		if (PlayerController == nullptr || !PlayerController->IsLocalController())
+		{
+			continue;
+		}
+
+		FVector ListenerLocation;
+		FVector FrontDir;
+		FVector RightDir;
+		PlayerController->GetAudioListenerPosition(ListenerLocation, FrontDir, RightDir);
+		ClosestSquared = FMath::Min(ClosestSquared, static_cast<float>(FVector::DistSquared(ListenerLocation, Location)));
+	}
+	return ClosestSquared;
+}
+
+bool UExplosionEffectsSubsystem::IsAreaSaturated(const FVector& Location, float Now)
+{
+	RecentExplosions.RemoveAllSwap([this, Now](const FRecentExplosion& Recent) { return Now - Recent.Time > AreaWindow; }, false);
+
+	const float RadiusSquared = FMath::Square(AreaRadius);
+	int32 NumNearby = 0;
+	for (const FRecentExplosion& Recent : RecentExplosions)
+	{
+		if (FVector::DistSquared(Recent.Location, Location) <= RadiusSquared && ++NumNearby >= MaxPerArea)
+		{
+			return true;
+		}
+	}
+
+	RecentExplosions.Add({ Location, Now });
+	return false;
+}
+
+UAudioComponent* UExplosionEffectsSubsystem::AcquireAudio()
+{
+	for (UAudioComponent* Audio : AudioPool)
+	{
+		if (!Audio->IsPlaying())
+		{
+			++NumReused;
+			INC_DWORD_STAT(STAT_ExplosionEffectsReused);
+			return Audio;
+		}
+	}
+
+	if (AudioPool.Num() < MaxPooledComponents)
+	{
+		LLM_SCOPE_BYTAG(MGNG_Effects);
+		AActor* Owner = GetHost();
+		UAudioComponent* Audio = NewObject<UAudioComponent>(Owner);
+		Audio->bAutoActivate = false;
+		Audio->bAutoDestroy = false;
+		Audio->bAllowSpatialization = true;
+		if (LoadedAttenuation != nullptr)
+		{
+			Audio->AttenuationSettings = LoadedAttenuation;
+		}
+		else
+		{
+			Audio->bOverrideAttenuation = true;
+			Audio->AttenuationOverrides.bAttenuate = true;
+			Audio->AttenuationOverrides.bSpatialize = true;
+			Audio->AttenuationOverrides.AttenuationShape = EAttenuationShape::Sphere;
+			Audio->AttenuationOverrides.AttenuationShapeExtents = FVector(AreaRadius, 0.0f, 0.0f);
+			Audio->AttenuationOverrides.FalloffDistance = FMath::Max(MaxAudibleDistance - AreaRadius, 1.0f);
+		}
+		Audio->SetupAttachment(Owner->GetRootComponent());
+		Audio->RegisterComponent();
+		AudioPool.Add(Audio);
+		++NumCreated;
+		return Audio;
+	}
+
+	if (AudioPool.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	UAudioComponent* Audio = AudioPool[NextAudioToSteal];
+	NextAudioToSteal = (NextAudioToSteal + 1) % AudioPool.Num();
+	Audio->Stop();
+	++NumReused;
+	INC_DWORD_STAT(STAT_ExplosionEffectsReused);
+	return Audio;
+}
+
+UParticleSystemComponent* UExplosionEffectsSubsystem::AcquireParticles()
+{
+	for (UParticleSystemComponent* Particles : ParticlePool)
+	{
+		if (!Particles->IsActive() || Particles->HasCompleted())
+		{
+			++NumReused;
+			INC_DWORD_STAT(STAT_ExplosionEffectsReused);
+			return Particles;
+		}
+	}
+
+	if (ParticlePool.Num() < MaxPooledComponents)
+	{
+		LLM_SCOPE_BYTAG(MGNG_Effects);
+		AActor* Owner = GetHost();
+		UParticleSystemComponent* Particles = NewObject<UParticleSystemComponent>(Owner);
+		Particles->bAutoActivate = false;
+		Particles->bAutoDestroy = false;
+		Particles->SetupAttachment(Owner->GetRootComponent());
+		Particles->RegisterComponent();
+		ParticlePool.Add(Particles);
+		++NumCreated;
+		return Particles;
+	}
+
+	if (ParticlePool.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	UParticleSystemComponent* Particles = ParticlePool[NextParticlesToSteal];
+	NextParticlesToSteal = (NextParticlesToSteal + 1) % ParticlePool.Num();
+	++NumReused;
+	INC_DWORD_STAT(STAT_ExplosionEffectsReused);
+	return Particles;
+}
+
+void UExplosionEffectsSubsystem::PlayExplosion(USoundBase* Sound, UParticleSystem* Particles, const FVector& Location)
+{
+	UWorld* World = GetWorld();
+	if ((Sound == nullptr && Particles == nullptr) || World->GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ExplosionEffects);
+
+	if (BudgetFrame != GFrameCounter)
+	{
+		BudgetFrame = GFrameCounter;
+		PlayedThisFrame = 0;
+	}
+	if (PlayedThisFrame >= MaxPerFrame)
+	{
+		++NumCulledFrame;
+		INC_DWORD_STAT(STAT_ExplosionEffectsCulled);
+		return;
+	}
+
+	const float DistanceSquared = GetListenerDistanceSquared(Location);
+	const bool bAudible = Sound != nullptr && DistanceSquared <= FMath::Square(MaxAudibleDistance);
+	const bool bVisible = Particles != nullptr && DistanceSquared <= FMath::Square(MaxVisibleDistance);
+	if (!bAudible && !bVisible)
+	{
+		++NumCulledDistance;
+		INC_DWORD_STAT(STAT_ExplosionEffectsCulled);
+		return;
+	}
+
+	// Checked last, an explosion that was culled anyway doesn't use up the area
+	if (IsAreaSaturated(Location, World->GetTimeSeconds()))
+	{
+		++NumCulledArea;
+		INC_DWORD_STAT(STAT_ExplosionEffectsCulled);
+		return;
+	}
+
+	++PlayedThisFrame;
+	++NumPlayed;
+	INC_DWORD_STAT(STAT_ExplosionEffectsPlayed);
+
+	if (bAudible)
+	{
+		if (UAudioComponent* Audio = AcquireAudio())
+		{
+			Audio->SetSound(Sound);
+			Audio->SetWorldLocation(Location);
+			Audio->Play();
+		}
+	}
+
+	if (bVisible)
+	{
+		if (UParticleSystemComponent* Emitter = AcquireParticles())
+		{
+			Emitter->SetTemplate(Particles);
+			Emitter->SetWorldLocation(Location);
+			Emitter->ActivateSystem(true);
+		}
+	}
+}
+
+void UExplosionEffectsSubsystem::ResetCounters()
+{
+	NumPlayed = 0;
+	NumCulledFrame = 0;
+	NumCulledArea = 0;
+	NumCulledDistance = 0;
+	NumReused = 0;
+	NumCreated = 0;
+}
+
+void UExplosionEffectsSubsystem::LogStats() const
+{
+	UE_LOG(LogMGNGDectectives, Display, TEXT("Explosion effects: %d played, culled %d by frame budget, %d by area budget, %d by distance, %d components reused, %d created (%d audio, %d particles pooled)"),
+		NumPlayed, NumCulledFrame, NumCulledArea, NumCulledDistance, NumReused, NumCreated, AudioPool.Num(), ParticlePool.Num());
+}
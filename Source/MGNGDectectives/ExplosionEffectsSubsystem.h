@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ExplosionEffectsSubsystem.generated.h"
+
+class UAudioComponent;
+class UParticleSystem;
+class UParticleSystemComponent;
+class USoundAttenuation;
+class USoundBase;
+
+/**
+ * Plays explosion sounds and particles from pooled components instead of spawning a component per blast.
+ * Each explosion has to fit a per-frame budget and a per-area budget, and is culled by its distance
+ * to the closest local listener; sounds are spatialized and fade out with that same distance.
+ * Not created on a dedicated server. mgng.Effects.Stats logs how many were played, culled and reused.
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API UExplosionEffectsSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Plays Sound and Particles at Location if the budgets allow it, either may be null */
+	void PlayExplosion(USoundBase* Sound, UParticleSystem* Particles, const FVector& Location);
+
+	FORCEINLINE int32 GetNumPlayed() const { return NumPlayed; }
+	FORCEINLINE int32 GetNumReused() const { return NumReused; }
+	FORCEINLINE int32 GetNumCulled() const { return NumCulledFrame + NumCulledArea + NumCulledDistance; }
+	FORCEINLINE int32 GetNumPooled() const { return AudioPool.Num() + ParticlePool.Num(); }
+
+	/** Owner of every pooled component, null until the first explosion played */
+	FORCEINLINE const AActor* GetPoolHost() const { return Host; }
+
+	void ResetCounters();
+	void LogStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Explosions played in one frame, the rest are dropped */
+	UPROPERTY(Config)
+	int32 MaxPerFrame = 4;
+
+	/** Explosions played within AreaRadius of each other during AreaWindow seconds */
+	UPROPERTY(Config)
+	int32 MaxPerArea = 2;
+
+	UPROPERTY(Config)
+	float AreaRadius = 600.0f;
+
+	UPROPERTY(Config)
+	float AreaWindow = 0.5f;
+
+	/** Beyond this no sound is played, also where the attenuation reaches silence */
+	UPROPERTY(Config)
+	float MaxAudibleDistance = 6000.0f;
+
+	/** Beyond this no particles are spawned */
+	UPROPERTY(Config)
+	float MaxVisibleDistance = 10000.0f;
+
+	/** Components kept per kind, once all are busy they are restarted in turn */
+	UPROPERTY(Config)
+	int32 MaxPooledComponents = 16;
+
+	/** Used for every explosion sound, spherical falloff to MaxAudibleDistance when unset */
+	UPROPERTY(Config)
+	TSoftObjectPtr<USoundAttenuation> Attenuation;
+
+private:
+	/** Squared distance from Location to the closest local player's listener, MAX_flt without one */
+	float GetListenerDistanceSquared(const FVector& Location) const;
+
+	/** True when another explosion nearby used up the area's budget */
+	bool IsAreaSaturated(const FVector& Location, float Now);
+
+	UAudioComponent* AcquireAudio();
+	UParticleSystemComponent* AcquireParticles();
+
+	/** Owns the pooled components, spawned on first use */
+	AActor* GetHost();
+
+	UPROPERTY()
+	AActor* Host = nullptr;
+
+	UPROPERTY()
+	USoundAttenuation* LoadedAttenuation = nullptr;
+
+	UPROPERTY()
+	TArray<UAudioComponent*> AudioPool;
+
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> ParticlePool;
+
+	/** Round robin index of the component to restart when a pool is full and busy */
+	int32 NextAudioToSteal = 0;
+	int32 NextParticlesToSteal = 0;
+
+	struct FRecentExplosion
+	{
+		FVector Location;
+		float Time;
+	};
+	TArray<FRecentExplosion> RecentExplosions;
+
+	uint64 BudgetFrame = 0;
+	int32 PlayedThisFrame = 0;
+
+	int32 NumPlayed = 0;
+	int32 NumCulledFrame = 0;
+	int32 NumCulledArea = 0;
+	int32 NumCulledDistance = 0;
+	int32 NumReused = 0;
+	int32 NumCreated = 0;
+};
@@ -0,0 +1,330 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ExplosionResolverSubsystem.h"
+
+#include "MGNGDectectives.h"
+#include "Engine/DamageEvents.h"
+#include "Engine/World.h"
+#include "GameFramework/DamageType.h"
+#include "GameFramework/MovementComponent.h"
+#include "Kismet/GameplayStatics.h"
+
+DECLARE_CYCLE_STAT(TEXT("Resolve Explosions"), STAT_ResolveExplosions, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Explosions Resolved"), STAT_ExplosionsResolved, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Explosion Overlap Queries"), STAT_ExplosionOverlapQueries, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Explosion Damage Events"), STAT_ExplosionDamageEvents, STATGROUP_MGNGDectectives);
+
+static TAutoConsoleVariable<int32> CVarBatchExplosions(
+	TEXT("mgng.Explosions.Batch"),
+	1,
+	TEXT("1 resolves every explosion queued in a frame together, one overlap query per cluster of nearby explosions, 0 resolves each explosion as it is queued."),
+	ECVF_Default
+);
+
+namespace ExplosionResolver
+{
+	/** Explosions share a box query while it covers at most this many times the volume of their own boxes */
+	constexpr double MaxClusterVolumeRatio = 2.0;
+
+	/** Explosions close enough to share one overlap query */
+	struct FCluster
+	{
+		FBox Bounds = FBox(ForceInit);
+		double SumVolume = 0.0;
+		int32 Num = 0;
+		int32 First = INDEX_NONE;
+	};
+
+	bool IsIgnored(const FQueuedExplosion& Explosion, const AActor* Actor)
+	{
+		return Explosion.IgnoreActors.Contains(Actor);
+	}
+
+	bool IsInRange(const FQueuedExplosion& Explosion, const FBox& ComponentBox, float& OutDistance)
+	{
+		const float DistanceSquared = ComponentBox.ComputeSquaredDistanceToPoint(Explosion.Origin);
+		if (DistanceSquared > FMath::Square(Explosion.Radius))
+		{
+			return false;
+		}
+		OutDistance = FMath::Sqrt(DistanceSquared);
+		return true;
+	}
+
+	/** What URadialForceComponent::FireImpulse does per component, a character's capsule only moves through its movement component */
+	void AddRadialImpulse(const FQueuedExplosion& Explosion, UPrimitiveComponent* Component)
+	{
+		Component->AddRadialImpulse(Explosion.Origin, Explosion.Radius, Explosion.ImpulseStrength, Explosion.Falloff, Explosion.bImpulseVelChange);
+
+		if (const AActor* Owner = Component->GetOwner())
+		{
+			TInlineComponentArray<UMovementComponent*> MovementComponents;
+			Owner->GetComponents(MovementComponents);
+			for (UMovementComponent* MovementComponent : MovementComponents)
+			{
+				if (MovementComponent->UpdatedComponent == Component)
+				{
+					MovementComponent->AddRadialImpulse(Explosion.Origin, Explosion.Radius, Explosion.ImpulseStrength, Explosion.Falloff, Explosion.bImpulseVelChange);
+					break;
+				}
+			}
+		}
+	}
+
+	void GatherIgnoredActors(const FQueuedExplosion& Explosion, TArray<AActor*>& OutActors)
+	{
+		for (const TWeakObjectPtr<AActor>& Actor : Explosion.IgnoreActors)
+		{
+			if (Actor.IsValid())
+			{
+				OutActors.Add(Actor.Get());
+			}
+		}
+	}
+}
+
+bool UExplosionResolverSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UExplosionResolverSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UExplosionResolverSubsystem, STATGROUP_Tickables);
+}
+
+void UExplosionResolverSubsystem::QueueExplosion(FQueuedExplosion&& Explosion)
+{
+	if (CVarBatchExplosions.GetValueOnGameThread() == 0)
+	{
+		ResolveSingle(Explosion);
+		return;
+	}
+
+	PendingExplosions.Add(MoveTemp(Explosion));
+}
+
+void UExplosionResolverSubsystem::Tick(float DeltaTime)
+{
+	if (PendingExplosions.Num() > 0)
+	{
+		ResolveBatch();
+	}
+}
+
+void UExplosionResolverSubsystem::ResolveBatch()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ResolveExplosions);
+
+	// Anything queued by damage callbacks below waits for the next frame
+	const TArray<FQueuedExplosion> Explosions = MoveTemp(PendingExplosions);
+	PendingExplosions.Reset();
+
+	// A box around explosions at opposite ends of the map would query most of it, only nearby ones are merged
+	TArray<ExplosionResolver::FCluster, TInlineAllocator<8>> Clusters;
+	for (int32 Index = 0; Index < Explosions.Num(); ++Index)
+	{
+		const FBox Box = FBox::BuildAABB(Explosions[Index].Origin, FVector(Explosions[Index].Radius));
+		const double Volume = Box.GetVolume();
+		ExplosionResolver::FCluster* Cluster = Clusters.FindByPredicate([&Box, Volume](const ExplosionResolver::FCluster& Candidate)
+		{
+			return (Candidate.Bounds + Box).GetVolume() <= ExplosionResolver::MaxClusterVolumeRatio * (Candidate.SumVolume + Volume);
+		});
+		if (Cluster == nullptr)
+		{
+			Cluster = &Clusters.AddDefaulted_GetRef();
+			Cluster->First = Index;
+		}
+		Cluster->Bounds += Box;
+		Cluster->SumVolume += Volume;
+		++Cluster->Num;
+	}
+
+	UWorld* World = GetWorld();
+	TArray<FOverlapResult> Overlaps;
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ExplosionBatch), false);
+	const FCollisionObjectQueryParams ObjectParams(FCollisionObjectQueryParams::InitType::AllDynamicObjects);
+
+	// Skeletal meshes report one overlap per body, only the component matters here
+	TArray<UPrimitiveComponent*> Components;
+	TSet<UPrimitiveComponent*> SeenComponents;
+	for (const ExplosionResolver::FCluster& Cluster : Clusters)
+	{
+		// A lone explosion gets the sphere it would have had on its own
+		const FCollisionShape Shape = Cluster.Num == 1
+			? FCollisionShape::MakeSphere(Explosions[Cluster.First].Radius)
+			: FCollisionShape::MakeBox(Cluster.Bounds.GetExtent());
+		Overlaps.Reset();
+		World->OverlapMultiByObjectType(Overlaps, Cluster.Bounds.GetCenter(), FQuat::Identity, ObjectParams, Shape, QueryParams);
+
+		for (const FOverlapResult& Overlap : Overlaps)
+		{
+			UPrimitiveComponent* Component = Overlap.GetComponent();
+			if (Component != nullptr && Component->GetOwner() != nullptr && !SeenComponents.Contains(Component))
+			{
+				SeenComponents.Add(Component);
+				Components.Add(Component);
+			}
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_ExplosionsResolved, Explosions.Num());
+	INC_DWORD_STAT_BY(STAT_ExplosionOverlapQueries, Clusters.Num());
+	INC_DWORD_STAT_BY(STAT_MGNGSceneQueries, Clusters.Num());
+
+	struct FVictimDamage
+	{
+		// Closest damage scale per explosion, like ApplyRadialDamage takes the closest component of an actor
+		TArray<float, TInlineAllocator<4>> Scales;
+		TArray<FHitResult> ComponentHits;
+	};
+
+	TMap<AActor*, FVictimDamage> Victims;
+	for (UPrimitiveComponent* Component : Components)
+	{
+		AActor* Victim = Component->GetOwner();
+		const FBox ComponentBox = Component->Bounds.GetBox();
+
+		for (int32 Index = 0; Index < Explosions.Num(); ++Index)
+		{
+			const FQueuedExplosion& Explosion = Explosions[Index];
+			float Distance = 0.0f;
+			if (ExplosionResolver::IsIgnored(Explosion, Victim) || !ExplosionResolver::IsInRange(Explosion, ComponentBox, Distance))
+			{
+				continue;
+			}
+			if (IsDamageBlocked(Explosion, Component))
+			{
+				continue;
+			}
+
+			FVictimDamage& Damage = Victims.FindOrAdd(Victim);
+			if (Damage.Scales.Num() == 0)
+			{
+				Damage.Scales.Init(-1.0f, Explosions.Num());
+			}
+			const float Scale = 1.0f - FMath::Clamp(Distance / Explosion.Radius, 0.0f, 1.0f);
+			Damage.Scales[Index] = FMath::Max(Damage.Scales[Index], Scale);
+
+			FHitResult& Hit = Damage.ComponentHits.AddDefaulted_GetRef();
+			Hit.bBlockingHit = true;
+			Hit.Component = Component;
+			Hit.HitObjectHandle = FActorInstanceHandle(Victim);
+			Hit.ImpactPoint = ComponentBox.GetClosestPointTo(Explosion.Origin);
+			Hit.Location = Hit.ImpactPoint;
+			Hit.ImpactNormal = (Hit.ImpactPoint - Explosion.Origin).GetSafeNormal();
+			Hit.Normal = Hit.ImpactNormal;
+			Hit.TraceStart = Explosion.Origin;
+			Hit.TraceEnd = Hit.ImpactPoint;
+		}
+	}
+
+	// One TakeDamage per victim carrying the summed damage of every explosion that reached it
+	for (TPair<AActor*, FVictimDamage>& Pair : Victims)
+	{
+		AActor* Victim = Pair.Key;
+		if (!IsValid(Victim))
+		{
+			continue;
+		}
+
+		float TotalDamage = 0.0f;
+		int32 Strongest = INDEX_NONE;
+		float StrongestDamage = -1.0f;
+		for (int32 Index = 0; Index < Explosions.Num(); ++Index)
+		{
+			const float Scale = Pair.Value.Scales[Index];
+			if (Scale < 0.0f)
+			{
+				continue;
+			}
+			const float Damage = Explosions[Index].BaseDamage * Scale;
+			TotalDamage += Damage;
+			if (Damage > StrongestDamage)
+			{
+				StrongestDamage = Damage;
+				Strongest = Index;
+			}
+		}
+
+		const FQueuedExplosion& Explosion = Explosions[Strongest];
+		FRadialDamageEvent DamageEvent;
+		DamageEvent.DamageTypeClass = UDamageType::StaticClass();
+		DamageEvent.Origin = Explosion.Origin;
+		// Falloff is already applied, AActor::InternalTakeRadialDamage gets back TotalDamage whatever the distance
+		DamageEvent.Params = FRadialDamageParams(TotalDamage, TotalDamage, 0.0f, Explosion.Radius, 1.0f);
+		DamageEvent.ComponentHits = MoveTemp(Pair.Value.ComponentHits);
+
+		Victim->TakeDamage(TotalDamage, DamageEvent, Explosion.InstigatedBy.Get(), Explosion.DamageCauser.Get());
+		INC_DWORD_STAT(STAT_ExplosionDamageEvents);
+	}
+
+	// Impulses go last so bodies that damage just switched to ragdoll get pushed too, as with FireImpulse
+	for (UPrimitiveComponent* Component : Components)
+	{
+		if (!IsValid(Component))
+		{
+			continue;
+		}
+
+		AActor* Victim = Component->GetOwner();
+		const FBox ComponentBox = Component->Bounds.GetBox();
+		for (const FQueuedExplosion& Explosion : Explosions)
+		{
+			float Distance = 0.0f;
+			if (!ExplosionResolver::IsIgnored(Explosion, Victim) && ExplosionResolver::IsInRange(Explosion, ComponentBox, Distance))
+			{
+				ExplosionResolver::AddRadialImpulse(Explosion, Component);
+			}
+		}
+	}
+}
+
+void UExplosionResolverSubsystem::ResolveSingle(const FQueuedExplosion& Explosion)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ResolveExplosions);
+
+	UWorld* World = GetWorld();
+	TArray<AActor*> IgnoreActors;
+	ExplosionResolver::GatherIgnoredActors(Explosion, IgnoreActors);
+
+	UGameplayStatics::ApplyRadialDamage(World, Explosion.BaseDamage, Explosion.Origin, Explosion.Radius, UDamageType::StaticClass(),
+		IgnoreActors, Explosion.DamageCauser.Get(), Explosion.InstigatedBy.Get());
+
+	// Same query URadialForceComponent::FireImpulse runs
+	TArray<FOverlapResult> Overlaps;
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ExplosionImpulse), false);
+	QueryParams.AddIgnoredActors(IgnoreActors);
+	World->OverlapMultiByObjectType(Overlaps, Explosion.Origin, FQuat::Identity,
+		FCollisionObjectQueryParams(FCollisionObjectQueryParams::InitType::AllDynamicObjects),
+		FCollisionShape::MakeSphere(Explosion.Radius), QueryParams);
+
+	INC_DWORD_STAT(STAT_ExplosionsResolved);
+	INC_DWORD_STAT_BY(STAT_ExplosionOverlapQueries, 2);
+	INC_DWORD_STAT_BY(STAT_MGNGSceneQueries, 2);
+
+	TSet<UPrimitiveComponent*> Impulsed;
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		UPrimitiveComponent* Component = Overlap.GetComponent();
+		if (Component != nullptr && !Impulsed.Contains(Component))
+		{
+			Impulsed.Add(Component);
+			ExplosionResolver::AddRadialImpulse(Explosion, Component);
+		}
+	}
+}
+
+bool UExplosionResolverSubsystem::IsDamageBlocked(const FQueuedExplosion& Explosion, UPrimitiveComponent* Component) const
+{
+	// Same visibility check ApplyRadialDamage does before damaging a component
+	FCollisionQueryParams LineParams(SCENE_QUERY_STAT(ExplosionDamagePrevention), true, Explosion.DamageCauser.Get());
+	TArray<AActor*> IgnoreActors;
+	ExplosionResolver::GatherIgnoredActors(Explosion, IgnoreActors);
+	LineParams.AddIgnoredActors(IgnoreActors);
+
+	FHitResult Hit;
+	const bool bHit = GetWorld()->LineTraceSingleByChannel(Hit, Explosion.Origin, Component->Bounds.Origin, ECC_Visibility, LineParams);
+	return bHit && Hit.GetComponent() != Component;
+}
@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PhysicsEngine/RadialForceComponent.h"
+#include "ExplosionResolverSubsystem.generated.h"
+
+/** One detonation waiting to be resolved at the end of the frame */
+struct FQueuedExplosion
+{
+	FVector Origin = FVector::ZeroVector;
+	float Radius = 0.0f;
+	float BaseDamage = 0.0f;
+	float ImpulseStrength = 0.0f;
+	ERadialImpulseFalloff Falloff = RIF_Constant;
+	bool bImpulseVelChange = false;
+
+	TWeakObjectPtr<AActor> DamageCauser;
+	TWeakObjectPtr<AController> InstigatedBy;
+	TArray<TWeakObjectPtr<AActor>> IgnoreActors;
+};
+
+/**
+ * Collects every explosion queued during a frame and resolves them together:
+ * one overlap query per cluster of nearby explosions, then one TakeDamage call and one impulse pass per victim.
+ * mgng.Explosions.Batch 0 resolves each explosion on its own for comparison under "stat MGNGDectectives".
+ */
+UCLASS()
+class MGNGDECTECTIVES_API UExplosionResolverSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void QueueExplosion(FQueuedExplosion&& Explosion);
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void ResolveBatch();
+	void ResolveSingle(const FQueuedExplosion& Explosion);
+	bool IsDamageBlocked(const FQueuedExplosion& Explosion, UPrimitiveComponent* Component) const;
+
+	TArray<FQueuedExplosion> PendingExplosions;
+};
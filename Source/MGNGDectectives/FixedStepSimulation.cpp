@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FixedStepSimulation.h"
+
+#include "MGNGDectectives.h"
+#include "GameplayEventRecorder.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Crc.h"
+
+namespace FixedStepSimulation
+{
+	/** Used when -MGNGSeed isn't given, the gameplay benchmark's old fixed seed */
+	constexpr int32 DefaultSeed = 0x4D474E47;
+	constexpr double DefaultStepRate = 60.0;
+
+	static bool bEnabled = false;
+	static double StepSeconds = 0.0;
+	static int32 Seed = DefaultSeed;
+	static uint64 StartFrame = 0;
+	static double StartTime = 0.0;
+
+	/** What the checksum covers of one record, everything that doesn't depend on the machine or the wall clock */
+	struct FChecksumRecord
+	{
+		uint32 Frame;
+		uint32 SubjectClass;
+		FIntVector Location;
+		float Value;
+		int32 IntValue;
+		uint8 Type;
+		ANSICHAR Text[sizeof(FGameplayEventRecord::Text)];
+	};
+}
+
+static FAutoConsoleCommand SimStatsCommand(
+	TEXT("mgng.Sim.Stats"),
+	TEXT("Logs the fixed step, the simulated and wall-clock time so far and the checksum of the recorded gameplay events."),
+	FConsoleCommandDelegate::CreateStatic(&FFixedStepSimulation::LogStats)
+);
+
+bool FFixedStepSimulation::IsEnabled()
+{
+	return FixedStepSimulation::bEnabled;
+}
+
+double FFixedStepSimulation::GetStepSeconds()
+{
+	return FixedStepSimulation::StepSeconds;
+}
+
+int32 FFixedStepSimulation::GetSeed()
+{
+	return FixedStepSimulation::Seed;
+}
+
+FRandomStream FFixedStepSimulation::MakeRandomStream(const TCHAR* Name)
+{
+	return FRandomStream(static_cast<int32>(HashCombine(static_cast<uint32>(FixedStepSimulation::Seed), FCrc::StrCrc32(Name))));
+}
+
+uint64 FFixedStepSimulation::GetNumSteps()
+{
+	return GFrameCounter - FixedStepSimulation::StartFrame;
+}
+
+uint32 FFixedStepSimulation::GetEventChecksum()
+{
+	using namespace FixedStepSimulation;
+
+	TArray<FGameplayEventRecord> Records;
+	FGameplayEventRecorder::Snapshot(Records);
+
+	const uint64 NumRecorded = FGameplayEventRecorder::GetNumRecorded();
+	uint32 Crc = FCrc::MemCrc32(&NumRecorded, sizeof(NumRecorded));
+	for (const FGameplayEventRecord& Record : Records)
+	{
+		// Frames count from the oldest record kept, loading may take a different number of frames
+		FChecksumRecord Entry;
+		FMemory::Memzero(Entry);
+		Entry.Frame = Record.Frame - Records[0].Frame;
+		Entry.SubjectClass = FCrc::StrCrc32(*Record.SubjectClass.ToString());
+		Entry.Location = FIntVector(FMath::RoundToInt(Record.Location.X), FMath::RoundToInt(Record.Location.Y), FMath::RoundToInt(Record.Location.Z));
+		Entry.Value = Record.Value;
+		Entry.IntValue = Record.IntValue;
+		Entry.Type = static_cast<uint8>(Record.Type);
+		FMemory::Memcpy(Entry.Text, Record.Text, sizeof(Entry.Text));
+		Crc = FCrc::MemCrc32(&Entry, sizeof(Entry), Crc);
+	}
+	return Crc;
+}
+
+void FFixedStepSimulation::LogStats()
+{
+	using namespace FixedStepSimulation;
+
+	if (!bEnabled)
+	{
+		UE_LOG(LogMGNGDectectives, Display, TEXT("Fixed step simulation is off, start with -MGNGFixedStep[=Hz] [-MGNGSeed=N]"));
+		return;
+	}
+
+	const double SimulatedSeconds = GetNumSteps() * StepSeconds;
+	const double WallSeconds = FPlatformTime::Seconds() - StartTime;
+	UE_LOG(LogMGNGDectectives, Display, TEXT("Fixed step simulation: seed %d, %.1f Hz, %llu steps, %.1f s simulated in %.1f s (%.1fx real time), %llu gameplay events, checksum %08x"),
+		Seed, 1.0 / StepSeconds, GetNumSteps(), SimulatedSeconds, WallSeconds, WallSeconds > 0.0 ? SimulatedSeconds / WallSeconds : 0.0,
+		FGameplayEventRecorder::GetNumRecorded(), GetEventChecksum());
+}
+
+void FFixedStepSimulation::Startup()
+{
+	using namespace FixedStepSimulation;
+
+	double StepRate = 0.0;
+	const bool bHasRate = FParse::Value(FCommandLine::Get(), TEXT("MGNGFixedStep="), StepRate);
+	FParse::Value(FCommandLine::Get(), TEXT("MGNGSeed="), Seed);
+	if (!bHasRate && !FParse::Param(FCommandLine::Get(), TEXT("MGNGFixedStep")))
+	{
+		return;
+	}
+
+	bEnabled = true;
+	StepSeconds = 1.0 / (StepRate > 0.0 ? StepRate : DefaultStepRate);
+	StartFrame = GFrameCounter;
+	StartTime = FPlatformTime::Seconds();
+
+	// With a fixed time step UEngine::UpdateTimeAndHandleMaxTickRate neither measures nor waits, smoothing and
+	// t.MaxFPS only apply to the variable step
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(StepSeconds);
+
+	// Engine and navigation randomness (FMath::FRand, random navigable points) draws from the global generators
+	FMath::RandInit(Seed);
+	FMath::SRandInit(Seed);
+
+	// Significance lowers tick rates by what was rendered, and a character whose Tick is spaced out reaches its
+	// throw on a later step
+	if (IConsoleVariable* Significance = IConsoleManager::Get().FindConsoleVariable(TEXT("mgng.Significance.Enable")))
+	{
+		Significance->Set(0, ECVF_SetByCommandline);
+	}
+
+	UE_LOG(LogMGNGDectectives, Display, TEXT("Fixed step simulation at %.1f Hz with seed %d"), 1.0 / StepSeconds, Seed);
+}
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Fixed-step, seeded simulation for headless soak and performance runs, started with -MGNGFixedStep[=Hz] and
+ * optionally -MGNGSeed=N. The engine then advances every frame by exactly one step instead of the wall-clock time
+ * and doesn't wait for the next frame, so the game runs as fast as the CPU allows and the world, physics, projectile
+ * and movement all see the same deltas on every run. Gameplay randomness comes from streams seeded with the run seed,
+ * the systems that budget by wall-clock time (enemy AI, character significance) switch to work that depends only on
+ * simulated time, and mgng.Sim.Stats logs the speedup and a checksum of the recorded gameplay events, which two
+ * runs with the same inputs and seed should share.
+ * Meant for standalone runs, remote clients keep real time: MGNGDectectives <Map> -game -nullrhi -unattended -MGNGFixedStep -MGNGBenchmark=64 -MGNGBenchmarkDuration=3600
+ */
+class MGNGDECTECTIVES_API FFixedStepSimulation
+{
+public:
+	static bool IsEnabled();
+
+	/** Seconds one frame simulates, 0 when not enabled */
+	static double GetStepSeconds();
+
+	/** Run seed, the same default when not enabled so seeded streams stay reproducible either way */
+	static int32 GetSeed();
+
+	/** Stream for one system, seeded from the run seed and Name so adding draws to one system doesn't shift another */
+	static FRandomStream MakeRandomStream(const TCHAR* Name);
+
+	/** Frames simulated since startup */
+	static uint64 GetNumSteps();
+
+	/** CRC of the gameplay events still in the recorder plus their total, leaves out wall-clock time and object ids */
+	static uint32 GetEventChecksum();
+
+	static void LogStats();
+
+	/** Called by the module, before the first world ticks */
+	static void Startup();
+};
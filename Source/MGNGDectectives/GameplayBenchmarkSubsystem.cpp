@@ -0,0 +1,540 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayBenchmarkSubsystem.h"
+
+#include "MGNGDectectives.h"
+#include "MGNGDectectivesCharacter.h"
+#include "CharacterSignificanceSubsystem.h"
+#include "ExplosionResolverSubsystem.h"
+#include "FixedStepSimulation.h"
+#include "Granade.h"
+#include "GranadePoolSubsystem.h"
+#include "ItemActor.h"
+#include "MemoryReportSubsystem.h"
+#include "MGNGReplicationGraph.h"
+#include "PickupInteractionSubsystem.h"
+#include "EngineUtils.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerStart.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectGlobals.h"
+
+namespace GameplayBenchmark
+{
+	const TCHAR* CsvHeader = TEXT("time_s,frames,avg_frame_ms,avg_game_thread_ms,max_game_thread_ms,ticking_actors,ticking_components,spawns_per_s,destroys_per_s,gc_count,gc_ms,used_physical_mb,bots,throws,pickups,explosions,pool_hits,pool_misses,connections,avg_net_replicate_ms,max_net_replicate_ms,avg_significance_saved_ms,feature_memory_kb,net_in_kb_per_s,net_out_kb_per_connection_s");
+
+	void Start(const TArray<FString>& Args, UWorld* World)
+	{
+		UGameplayBenchmarkSubsystem* Benchmark = World ? World->GetSubsystem<UGameplayBenchmarkSubsystem>() : nullptr;
+		if (Benchmark == nullptr)
+		{
+			return;
+		}
+
+		const int32 Bots = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 0;
+		const float Seconds = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 0.0f;
+		Benchmark->StartBenchmark(Bots, Seconds);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkStartCommand(
+	TEXT("mgng.Benchmark.Start"),
+	TEXT("Spawns benchmark bots and records gameplay performance to Saved/Benchmarks. Args: [Bots] [Seconds]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&GameplayBenchmark::Start)
+);
+
+static FAutoConsoleCommandWithWorld BenchmarkStopCommand(
+	TEXT("mgng.Benchmark.Stop"),
+	TEXT("Stops the running gameplay benchmark and writes what was recorded so far."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (UGameplayBenchmarkSubsystem* Benchmark = World ? World->GetSubsystem<UGameplayBenchmarkSubsystem>() : nullptr)
+		{
+			Benchmark->StopBenchmark();
+		}
+	})
+);
+
+bool UGameplayBenchmarkSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UGameplayBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGameplayBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+void UGameplayBenchmarkSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	int32 CommandLineBots = 0;
+	const bool bHasCount = FParse::Value(FCommandLine::Get(), TEXT("MGNGBenchmark="), CommandLineBots);
+	if (bHasCount || FParse::Param(FCommandLine::Get(), TEXT("MGNGBenchmark")))
+	{
+		float CommandLineDuration = 0.0f;
+		FParse::Value(FCommandLine::Get(), TEXT("MGNGBenchmarkDuration="), CommandLineDuration);
+		FParse::Value(FCommandLine::Get(), TEXT("MGNGBenchmarkClients="), RequiredClients);
+		StartBenchmark(CommandLineBots, CommandLineDuration);
+	}
+}
+
+void UGameplayBenchmarkSubsystem::Deinitialize()
+{
+	if (bRunning)
+	{
+		StopBenchmark();
+	}
+
+	Super::Deinitialize();
+}
+
+void UGameplayBenchmarkSubsystem::StartBenchmark(int32 InNumBots, float InDuration)
+{
+	if (bRunning)
+	{
+		return;
+	}
+
+	UWorld* World = GetWorld();
+	NumBots = InNumBots > 0 ? InNumBots : DefaultNumBots;
+	if (InDuration > 0.0f)
+	{
+		Duration = InDuration;
+	}
+
+	// Same seed every run so two builds see the same sequence of actions, -MGNGSeed picks another
+	Random.Initialize(FFixedStepSimulation::GetSeed());
+
+	ResolvedBotClass = BotClass.LoadSynchronous();
+	if (ResolvedBotClass == nullptr)
+	{
+		const AGameModeBase* GameMode = World->GetAuthGameMode();
+		const bool bPawnIsCharacter = GameMode != nullptr && GameMode->DefaultPawnClass && GameMode->DefaultPawnClass->IsChildOf<AMGNGDectectivesCharacter>();
+		ResolvedBotClass = bPawnIsCharacter ? GameMode->DefaultPawnClass.Get() : AMGNGDectectivesCharacter::StaticClass();
+	}
+	ResolvedPickupClass = PickupClass.LoadSynchronous();
+	if (ResolvedPickupClass == nullptr)
+	{
+		ResolvedPickupClass = AItemActor::StaticClass();
+	}
+
+	Center = FVector::ZeroVector;
+	for (TActorIterator<APlayerStart> It(World); It; ++It)
+	{
+		Center = It->GetActorLocation();
+		break;
+	}
+
+	ActorSpawnedHandle = World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &ThisClass::OnActorSpawned));
+	ActorDestroyedHandle = World->AddOnActorDestroyedHandler(FOnActorDestroyed::FDelegate::CreateUObject(this, &ThisClass::OnActorDestroyed));
+	PreGCHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &ThisClass::OnPreGarbageCollect);
+	PostGCHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this, &ThisClass::OnPostGarbageCollect);
+
+	if (UMemoryReportSubsystem* Memory = World->GetSubsystem<UMemoryReportSubsystem>())
+	{
+		Memory->ResetPeaks();
+		Memory->SetTracking(true);
+	}
+
+	bRunning = true;
+	bRecording = false;
+	Elapsed = 0.0f;
+	ExplosionAccumulator = 0.0f;
+	Rows.Reset();
+	Rows.Add(GameplayBenchmark::CsvHeader);
+
+	Bots.SetNum(NumBots);
+	for (int32 Index = 0; Index < NumBots; ++Index)
+	{
+		SpawnBot(Index);
+	}
+	for (int32 Index = 0; Index < NumPickups; ++Index)
+	{
+		SpawnPickup();
+	}
+
+	UE_LOG(LogMGNGDectectives, Display, TEXT("Benchmark started on %s: %d bots of %s, %.0f s warmup, %.0f s recorded"),
+		*World->GetMapName(), NumBots, *ResolvedBotClass->GetName(), WarmupTime, Duration);
+}
+
+void UGameplayBenchmarkSubsystem::StopBenchmark()
+{
+	if (!bRunning)
+	{
+		return;
+	}
+
+	bRunning = false;
+	if (bRecording && WindowFrames > 0)
+	{
+		WriteSample();
+	}
+	bRecording = false;
+
+	UWorld* World = GetWorld();
+	World->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	World->RemoveOnActorDestroyedHandler(ActorDestroyedHandle);
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGCHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGCHandle);
+
+	SaveCsv();
+
+	if (FFixedStepSimulation::IsEnabled())
+	{
+		FFixedStepSimulation::LogStats();
+	}
+
+	bool bWithinBudget = true;
+	if (UMemoryReportSubsystem* Memory = World->GetSubsystem<UMemoryReportSubsystem>())
+	{
+		Memory->Sample();
+		Memory->SetTracking(false);
+		Memory->LogReport();
+		bWithinBudget = Memory->CheckBudgets();
+	}
+
+	if (FApp::IsUnattended())
+	{
+		// A non zero exit code fails the automated run that started us
+		FPlatformMisc::RequestExitWithStatus(false, bWithinBudget ? 0 : 1);
+	}
+}
+
+int32 UGameplayBenchmarkSubsystem::GetNumClientConnections() const
+{
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	return NetDriver != nullptr ? NetDriver->ClientConnections.Num() : 0;
+}
+
+void UGameplayBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	if (!bRecording && GetNumClientConnections() < RequiredClients)
+	{
+		// Warmup starts once every simulated client has joined
+		Elapsed = 0.0f;
+		return;
+	}
+
+	Elapsed += DeltaTime;
+	if (!bRecording && Elapsed >= WarmupTime)
+	{
+		bRecording = true;
+		Elapsed = 0.0f;
+		WindowTime = 0.0f;
+		WindowFrames = 0;
+		WindowGameThreadMs = WindowMaxGameThreadMs = WindowGCMs = 0.0;
+		WindowNetReplicateMs = WindowMaxNetReplicateMs = WindowSignificanceSavedMs = 0.0;
+		WindowSpawns = WindowDestroys = WindowGCs = WindowThrows = WindowPickups = WindowExplosions = 0;
+	}
+
+	for (int32 Index = 0; Index < Bots.Num(); ++Index)
+	{
+		TickBot(Index);
+	}
+
+	ExplosionAccumulator += DeltaTime * ExplosionsPerSecond;
+	while (ExplosionAccumulator >= 1.0f)
+	{
+		ExplosionAccumulator -= 1.0f;
+		TriggerExplosion();
+	}
+
+	if (!bRecording)
+	{
+		return;
+	}
+
+	// Frame time minus the time the game thread spent waiting for the frame rate limit or other threads
+	const double GameThreadMs = FMath::Max(FApp::GetDeltaTime() - FApp::GetIdleTime(), 0.0) * 1000.0;
+	WindowTime += DeltaTime;
+	++WindowFrames;
+	WindowGameThreadMs += GameThreadMs;
+	WindowMaxGameThreadMs = FMath::Max(WindowMaxGameThreadMs, GameThreadMs);
+
+	// Replication of the previous frame, the net driver flushes after the world has ticked
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (const UMGNGReplicationGraph* Graph = NetDriver ? Cast<UMGNGReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr)
+	{
+		WindowNetReplicateMs += Graph->GetLastReplicateMs();
+		WindowMaxNetReplicateMs = FMath::Max(WindowMaxNetReplicateMs, Graph->GetLastReplicateMs());
+	}
+	if (const UCharacterSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UCharacterSignificanceSubsystem>())
+	{
+		WindowSignificanceSavedMs += Significance->GetLastSavedMs();
+	}
+
+	if (WindowTime >= 1.0f)
+	{
+		WriteSample();
+	}
+
+	if (Elapsed >= Duration)
+	{
+		StopBenchmark();
+	}
+}
+
+void UGameplayBenchmarkSubsystem::TickBot(int32 Index)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	FBenchmarkBot& Bot = Bots[Index];
+
+	AMGNGDectectivesCharacter* Character = Bot.Character;
+	if (!IsValid(Character))
+	{
+		SpawnBot(Index);
+		return;
+	}
+
+	if (Character->isRagdoll)
+	{
+		// Dead bots are swapped for fresh ones so the load stays the same all run
+		if (Bot.RagdollTime < 0.0f)
+		{
+			Bot.RagdollTime = Now;
+		}
+		else if (Now - Bot.RagdollTime >= RespawnDelay)
+		{
+			Character->Destroy();
+			SpawnBot(Index);
+		}
+		return;
+	}
+
+	if (Now < Bot.NextActionTime)
+	{
+		return;
+	}
+
+	if (Bot.bAiming)
+	{
+		Character->ThrowRelease();
+		Bot.bAiming = false;
+		Bot.NextActionTime = Now + Random.FRandRange(1.0f, 2.5f);
+		++WindowThrows;
+		return;
+	}
+
+	if (Random.FRand() < 0.6f)
+	{
+		if (AController* Controller = Character->GetController())
+		{
+			Controller->SetControlRotation(FRotator(Random.FRandRange(5.0f, 35.0f), Random.FRandRange(0.0f, 360.0f), 0.0f));
+		}
+		Character->ThrowStart();
+		Bot.bAiming = true;
+		Bot.NextActionTime = Now + Random.FRandRange(0.3f, 1.0f);
+		return;
+	}
+
+	// Walk over to a random pickup the quick way and grab it
+	for (int32 Attempt = 0; Attempt < 4 && Pickups.Num() > 0; ++Attempt)
+	{
+		const int32 PickupIndex = Random.RandHelper(Pickups.Num());
+		AItemActor* Item = Pickups[PickupIndex].Get();
+		if (Item == nullptr || !Item->IsAvailable())
+		{
+			Pickups.RemoveAtSwap(PickupIndex);
+			continue;
+		}
+
+		Character->SetActorLocation(Item->GetActorLocation() + FVector(0.0f, 0.0f, 100.0f), false, nullptr, ETeleportType::TeleportPhysics);
+		const int32 PiecesBefore = Character->Piece;
+		Character->PickUp();
+		if (Character->Piece != PiecesBefore)
+		{
+			++WindowPickups;
+			SpawnPickup();
+		}
+		break;
+	}
+	Bot.NextActionTime = Now + Random.FRandRange(0.5f, 1.5f);
+}
+
+void UGameplayBenchmarkSubsystem::SpawnBot(int32 Index)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	const FRotator Rotation(0.0f, Random.FRandRange(0.0f, 360.0f), 0.0f);
+	AMGNGDectectivesCharacter* Character = GetWorld()->SpawnActor<AMGNGDectectivesCharacter>(ResolvedBotClass, RandomSpawnLocation(), Rotation, SpawnParams);
+	if (Character != nullptr && Character->GetController() == nullptr)
+	{
+		Character->SpawnDefaultController();
+	}
+
+	FBenchmarkBot& Bot = Bots[Index];
+	Bot = FBenchmarkBot();
+	Bot.Character = Character;
+	Bot.NextActionTime = GetWorld()->GetTimeSeconds() + Random.FRandRange(0.0f, 1.0f);
+}
+
+void UGameplayBenchmarkSubsystem::SpawnPickup()
+{
+	UPickupInteractionSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupInteractionSubsystem>();
+	if (PickupSubsystem == nullptr)
+	{
+		return;
+	}
+
+	const FTransform SpawnTransform(RandomSpawnLocation());
+	if (AItemActor* Item = PickupSubsystem->SpawnItem(ResolvedPickupClass, SpawnTransform))
+	{
+		Pickups.Add(Item);
+	}
+}
+
+void UGameplayBenchmarkSubsystem::TriggerExplosion()
+{
+	if (Bots.Num() == 0)
+	{
+		return;
+	}
+
+	const AMGNGDectectivesCharacter* Target = Bots[Random.RandHelper(Bots.Num())].Character;
+	if (!IsValid(Target))
+	{
+		return;
+	}
+
+	// Same numbers as a grenade so the damage path does the same work
+	FQueuedExplosion Explosion;
+	GetDefault<AGranade>()->FillExplosion(Explosion);
+	Explosion.Origin = Target->GetActorLocation();
+	UWorld* World = GetWorld();
+	if (UExplosionResolverSubsystem* Resolver = World->GetSubsystem<UExplosionResolverSubsystem>())
+	{
+		Resolver->QueueExplosion(MoveTemp(Explosion));
+	}
+	else
+	{
+		UGameplayStatics::ApplyRadialDamage(World, Explosion.BaseDamage, Explosion.Origin, Explosion.Radius, nullptr, TArray<AActor*>());
+	}
+	++WindowExplosions;
+}
+
+FVector UGameplayBenchmarkSubsystem::RandomSpawnLocation()
+{
+	const float Angle = Random.FRandRange(0.0f, 2.0f * PI);
+	const float Distance = SpawnRadius * FMath::Sqrt(Random.FRand());
+	return Center + FVector(FMath::Cos(Angle) * Distance, FMath::Sin(Angle) * Distance, 0.0f);
+}
+
+void UGameplayBenchmarkSubsystem::OnActorSpawned(AActor* Actor)
+{
+	++WindowSpawns;
+}
+
+void UGameplayBenchmarkSubsystem::OnActorDestroyed(AActor* Actor)
+{
+	++WindowDestroys;
+}
+
+void UGameplayBenchmarkSubsystem::OnPreGarbageCollect()
+{
+	GCStartTime = FPlatformTime::Seconds();
+}
+
+void UGameplayBenchmarkSubsystem::OnPostGarbageCollect()
+{
+	++WindowGCs;
+	WindowGCMs += (FPlatformTime::Seconds() - GCStartTime) * 1000.0;
+}
+
+void UGameplayBenchmarkSubsystem::CountTicks(int32& OutTickingActors, int32& OutTickingComponents) const
+{
+	OutTickingActors = 0;
+	OutTickingComponents = 0;
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		if (It->PrimaryActorTick.IsTickFunctionRegistered() && It->PrimaryActorTick.IsTickFunctionEnabled())
+		{
+			++OutTickingActors;
+		}
+		for (const UActorComponent* Component : It->GetComponents())
+		{
+			if (Component != nullptr && Component->PrimaryComponentTick.IsTickFunctionRegistered() && Component->PrimaryComponentTick.IsTickFunctionEnabled())
+			{
+				++OutTickingComponents;
+			}
+		}
+	}
+}
+
+void UGameplayBenchmarkSubsystem::WriteSample()
+{
+	int32 TickingActors = 0;
+	int32 TickingComponents = 0;
+	CountTicks(TickingActors, TickingComponents);
+
+	const UGranadePoolSubsystem* Pool = GetWorld()->GetSubsystem<UGranadePoolSubsystem>();
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	const UMemoryReportSubsystem* Memory = GetWorld()->GetSubsystem<UMemoryReportSubsystem>();
+	const int32 Frames = FMath::Max(WindowFrames, 1);
+	const float Seconds = FMath::Max(WindowTime, KINDA_SMALL_NUMBER);
+
+	// The net driver's own per second totals, all connections together
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	const int32 Connections = GetNumClientConnections();
+	const double NetInKB = NetDriver != nullptr ? NetDriver->InBytesPerSecond / 1024.0 : 0.0;
+	const double NetOutKBPerConnection = NetDriver != nullptr && Connections > 0 ? NetDriver->OutBytesPerSecond / 1024.0 / Connections : 0.0;
+
+	Rows.Add(FString::Printf(TEXT("%.2f,%d,%.3f,%.3f,%.3f,%d,%d,%.1f,%.1f,%d,%.3f,%.1f,%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.1f,%.2f,%.2f"),
+		Elapsed,
+		WindowFrames,
+		WindowTime * 1000.0f / Frames,
+		WindowGameThreadMs / Frames,
+		WindowMaxGameThreadMs,
+		TickingActors,
+		TickingComponents,
+		WindowSpawns / Seconds,
+		WindowDestroys / Seconds,
+		WindowGCs,
+		WindowGCMs,
+		MemoryStats.UsedPhysical / (1024.0 * 1024.0),
+		Bots.Num(),
+		WindowThrows,
+		WindowPickups,
+		WindowExplosions,
+		Pool != nullptr ? Pool->GetHits() : 0,
+		Pool != nullptr ? Pool->GetMisses() : 0,
+		Connections,
+		WindowNetReplicateMs / Frames,
+		WindowMaxNetReplicateMs,
+		WindowSignificanceSavedMs / Frames,
+		Memory != nullptr ? Memory->GetTotalBytes() / 1024.0 : 0.0,
+		NetInKB,
+		NetOutKBPerConnection));
+
+	WindowTime = 0.0f;
+	WindowFrames = 0;
+	WindowGameThreadMs = WindowMaxGameThreadMs = WindowGCMs = 0.0;
+	WindowNetReplicateMs = WindowMaxNetReplicateMs = WindowSignificanceSavedMs = 0.0;
+	WindowSpawns = WindowDestroys = WindowGCs = WindowThrows = WindowPickups = WindowExplosions = 0;
+}
+
+void UGameplayBenchmarkSubsystem::SaveCsv() const
+{
+	const FString FileName = FString::Printf(TEXT("GameplayBenchmark_%s_%dbots_%dclients_%s.csv"),
+		*GetWorld()->GetMapName(), NumBots, RequiredClients, *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S")));
+	const FString Path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), FileName);
+
+	if (FFileHelper::SaveStringArrayToFile(Rows, *Path))
+	{
+		UE_LOG(LogMGNGDectectives, Display, TEXT("Benchmark wrote %d samples to %s"), Rows.Num() - 1, *Path);
+	}
+	else
+	{
+		UE_LOG(LogMGNGDectectives, Error, TEXT("Benchmark could not write %s"), *Path);
+	}
+}
@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GameplayBenchmarkSubsystem.generated.h"
+
+class AItemActor;
+class AMGNGDectectivesCharacter;
+
+/** What a benchmark bot does next */
+USTRUCT()
+struct FBenchmarkBot
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	AMGNGDectectivesCharacter* Character = nullptr;
+
+	float NextActionTime = 0.0f;
+	float RagdollTime = -1.0f;
+	bool bAiming = false;
+};
+
+/**
+ * Headless gameplay benchmark. Spawns bots that throw grenades, pick up clue pieces and get caught in explosions,
+ * then writes one CSV row per second with frame, tick, spawn, GC and memory numbers to Saved/Benchmarks.
+ * Per-feature memory is tracked by UMemoryReportSubsystem during the run and checked against its budgets at the end.
+ * Starts on map load with -MGNGBenchmark[=Bots] or with mgng.Benchmark.Start, and exits the game afterwards when -unattended.
+ * Meant to run as: MGNGDectectives <Map> -game -nullrhi -unattended -MGNGBenchmark=64
+ * For server replication cost, host with <Map>?listen -game -nullrhi -MGNGBenchmarkClients=N and start N clients with
+ * MGNGDectectives 127.0.0.1 -game -nullrhi -nosound; recording waits until all N are connected over the IpNetDriver.
+ * Bandwidth comes from the net driver, compare runs with mgng.Movement.CompactMoves and mgng.Movement.AdaptiveNetRate off.
+ * Standalone soak runs add -MGNGFixedStep to simulate the duration faster than real time and log an event checksum at the end.
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API UGameplayBenchmarkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override { return bRunning; }
+
+	void StartBenchmark(int32 InNumBots, float InDuration);
+	void StopBenchmark();
+
+	FORCEINLINE bool IsRunning() const { return bRunning; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Bots spawned when -MGNGBenchmark has no count */
+	UPROPERTY(Config)
+	int32 DefaultNumBots = 32;
+
+	/** Seconds recorded after the warmup */
+	UPROPERTY(Config)
+	float Duration = 60.0f;
+
+	/** Seconds before recording starts, lets the pools fill and the first GC pass */
+	UPROPERTY(Config)
+	float WarmupTime = 5.0f;
+
+	/** Radius of the circle the bots and pickups are spread over */
+	UPROPERTY(Config)
+	float SpawnRadius = 2000.0f;
+
+	/** Pickups kept in play, collected ones are put back somewhere else */
+	UPROPERTY(Config)
+	int32 NumPickups = 64;
+
+	/** Radial damage events per second, each one at a random bot */
+	UPROPERTY(Config)
+	float ExplosionsPerSecond = 2.0f;
+
+	/** Ragdolled bots are replaced after this many seconds */
+	UPROPERTY(Config)
+	float RespawnDelay = 3.0f;
+
+	UPROPERTY(Config)
+	TSoftClassPtr<AMGNGDectectivesCharacter> BotClass;
+
+	UPROPERTY(Config)
+	TSoftClassPtr<AItemActor> PickupClass;
+
+private:
+	void SpawnBot(int32 Index);
+	void SpawnPickup();
+	void TickBot(int32 Index);
+	void TriggerExplosion();
+	FVector RandomSpawnLocation();
+
+	void OnActorSpawned(AActor* Actor);
+	void OnActorDestroyed(AActor* Actor);
+	void OnPreGarbageCollect();
+	void OnPostGarbageCollect();
+
+	/** Closes the current one second window and appends it to Rows */
+	void WriteSample();
+	void CountTicks(int32& OutTickingActors, int32& OutTickingComponents) const;
+	int32 GetNumClientConnections() const;
+	void SaveCsv() const;
+
+	UPROPERTY()
+	TArray<FBenchmarkBot> Bots;
+
+	TArray<TWeakObjectPtr<AItemActor>> Pickups;
+
+	UClass* ResolvedBotClass = nullptr;
+	UClass* ResolvedPickupClass = nullptr;
+
+	FRandomStream Random;
+	FVector Center = FVector::ZeroVector;
+	bool bRunning = false;
+	bool bRecording = false;
+	int32 NumBots = 0;
+
+	/** Client connections to wait for before the warmup starts */
+	int32 RequiredClients = 0;
+	float Elapsed = 0.0f;
+	float ExplosionAccumulator = 0.0f;
+
+	FDelegateHandle ActorSpawnedHandle;
+	FDelegateHandle ActorDestroyedHandle;
+	FDelegateHandle PreGCHandle;
+	FDelegateHandle PostGCHandle;
+	double GCStartTime = 0.0;
+
+	// Current sample window
+	float WindowTime = 0.0f;
+	int32 WindowFrames = 0;
+	double WindowGameThreadMs = 0.0;
+	double WindowMaxGameThreadMs = 0.0;
+	int32 WindowSpawns = 0;
+	int32 WindowDestroys = 0;
+	int32 WindowGCs = 0;
+	double WindowGCMs = 0.0;
+	int32 WindowThrows = 0;
+	int32 WindowPickups = 0;
+	int32 WindowExplosions = 0;
+	double WindowNetReplicateMs = 0.0;
+	double WindowMaxNetReplicateMs = 0.0;
+	double WindowSignificanceSavedMs = 0.0;
+
+	TArray<FString> Rows;
+};
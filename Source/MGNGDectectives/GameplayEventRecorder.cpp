@@ -0,0 +1,242 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayEventRecorder.h"
+
+#include "MGNGDectectives.h"
+#include "Containers/Ticker.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include <atomic>
+
+namespace GameplayEventRecorder
+{
+	static_assert((FGameplayEventRecorder::Capacity & (FGameplayEventRecorder::Capacity - 1)) == 0, "The ring is indexed with a mask");
+
+	/** Sequence is the record's index plus one once it is complete, 0 while it is being written */
+	struct FSlot
+	{
+		std::atomic<uint64> Sequence{ 0 };
+		FGameplayEventRecord Record;
+	};
+
+	// Allocated with the module, never again
+	static FSlot Slots[FGameplayEventRecorder::Capacity];
+	static std::atomic<uint64> NextIndex{ 0 };
+
+	/** Built at startup, a crash is a bad moment to start asking for paths */
+	static FString CrashDumpPath;
+	static FDelegateHandle SystemErrorHandle;
+
+	FString MakeDumpPath()
+	{
+		return FPaths::Combine(FPaths::ProjectLogDir(), FString::Printf(TEXT("GameplayEvents-%s.log"), *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S"))));
+	}
+
+	void DumpOnCrash()
+	{
+		FGameplayEventRecorder::Dump(CrashDumpPath);
+	}
+
+#if !UE_BUILD_SHIPPING
+	static int32 OnScreenLines = 0;
+	static FAutoConsoleVariableRef CVarOnScreenLines(
+		TEXT("mgng.Events.OnScreen"),
+		OnScreenLines,
+		TEXT("Shows the newest N gameplay events on screen, 0 hides them."),
+		ECVF_Default
+	);
+
+	static FTSTicker::FDelegateHandle ViewerHandle;
+
+	FColor GetEventColor(EGameplayEvent Type)
+	{
+		switch (Type)
+		{
+		case EGameplayEvent::SessionCreateStarted:
+		case EGameplayEvent::SessionCreated:
+		case EGameplayEvent::MatchmakingStarted:
+		case EGameplayEvent::MatchmakingJoined:
+			return FColor::Cyan;
+		case EGameplayEvent::SessionCreateFailed:
+		case EGameplayEvent::MatchmakingFailed:
+		case EGameplayEvent::Debug:
+			return FColor::Red;
+		case EGameplayEvent::Damage:
+		case EGameplayEvent::Ragdoll:
+			return FColor::Orange;
+		default:
+			return FColor::White;
+		}
+	}
+
+	/** Only formats anything while mgng.Events.OnScreen is set */
+	bool TickViewer(float DeltaTime)
+	{
+		if (OnScreenLines <= 0 || GEngine == nullptr)
+		{
+			return true;
+		}
+
+		static TArray<FGameplayEventRecord> Records;
+		FGameplayEventRecorder::Snapshot(Records, FMath::Min(OnScreenLines, 64));
+
+		// Keyed lines are replaced every frame instead of piling up
+		constexpr int32 BaseKey = 0x4D470000;
+		for (int32 Index = 0; Index < Records.Num(); ++Index)
+		{
+			const FGameplayEventRecord& Record = Records[Records.Num() - 1 - Index];
+			GEngine->AddOnScreenDebugMessage(BaseKey + Index, DeltaTime * 2.0f, GetEventColor(Record.Type), FGameplayEventRecorder::FormatRecord(Record));
+		}
+		return true;
+	}
+#endif
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GameplayEventsDumpCommand(
+	TEXT("mgng.Events.Dump"),
+	TEXT("Writes the recorded gameplay events to Saved/Logs. Args: [FileName]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const FString Path = Args.Num() > 0 ? FPaths::Combine(FPaths::ProjectLogDir(), Args[0]) : GameplayEventRecorder::MakeDumpPath();
+		if (FGameplayEventRecorder::Dump(Path))
+		{
+			UE_LOG(LogMGNGDectectives, Display, TEXT("Gameplay events written to %s, %llu recorded so far"), *Path, FGameplayEventRecorder::GetNumRecorded());
+		}
+		else
+		{
+			UE_LOG(LogMGNGDectectives, Error, TEXT("Could not write gameplay events to %s"), *Path);
+		}
+	})
+);
+
+void FGameplayEventRecorder::Record(EGameplayEvent Type, const UObject* Subject, const FVector& Location, float Value, int32 IntValue, const TCHAR* Text)
+{
+	using namespace GameplayEventRecorder;
+
+	const uint64 Index = NextIndex.fetch_add(1, std::memory_order_relaxed);
+	FSlot& Slot = Slots[Index & (Capacity - 1)];
+
+	// Readers that see 0 here, or a different sequence after copying, drop the slot
+	Slot.Sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	FGameplayEventRecord& Record = Slot.Record;
+	Record.Time = FPlatformTime::Seconds();
+	Record.Frame = static_cast<uint32>(GFrameCounter);
+	Record.SubjectId = Subject ? Subject->GetUniqueID() : 0;
+	Record.SubjectClass = Subject ? Subject->GetClass()->GetFName() : NAME_None;
+	Record.Location = FVector3f(Location);
+	Record.Value = Value;
+	Record.IntValue = IntValue;
+	Record.Type = Type;
+
+	int32 Length = 0;
+	if (Text != nullptr)
+	{
+		for (; Length < static_cast<int32>(UE_ARRAY_COUNT(Record.Text)) - 1 && Text[Length] != 0; ++Length)
+		{
+			Record.Text[Length] = Text[Length] < 128 ? static_cast<ANSICHAR>(Text[Length]) : '?';
+		}
+	}
+	Record.Text[Length] = 0;
+
+	Slot.Sequence.store(Index + 1, std::memory_order_release);
+}
+
+void FGameplayEventRecorder::Snapshot(TArray<FGameplayEventRecord>& OutRecords, int32 MaxRecords)
+{
+	using namespace GameplayEventRecorder;
+
+	OutRecords.Reset();
+	const uint64 End = NextIndex.load(std::memory_order_acquire);
+	const uint64 Count = FMath::Min<uint64>(End, FMath::Clamp(MaxRecords, 0, Capacity));
+	for (uint64 Index = End - Count; Index < End; ++Index)
+	{
+		const FSlot& Slot = Slots[Index & (Capacity - 1)];
+		if (Slot.Sequence.load(std::memory_order_acquire) != Index + 1)
+		{
+			continue;
+		}
+
+		const FGameplayEventRecord Copy = Slot.Record;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (Slot.Sequence.load(std::memory_order_relaxed) == Index + 1)
+		{
+			OutRecords.Add(Copy);
+		}
+	}
+}
+
+uint64 FGameplayEventRecorder::GetNumRecorded()
+{
+	return GameplayEventRecorder::NextIndex.load(std::memory_order_relaxed);
+}
+
+const TCHAR* FGameplayEventRecorder::GetEventName(EGameplayEvent Type)
+{
+	switch (Type)
+	{
+	case EGameplayEvent::SessionCreateStarted:	return TEXT("SessionCreateStarted");
+	case EGameplayEvent::SessionCreated:		return TEXT("SessionCreated");
+	case EGameplayEvent::SessionCreateFailed:	return TEXT("SessionCreateFailed");
+	case EGameplayEvent::MatchmakingStarted:	return TEXT("MatchmakingStarted");
+	case EGameplayEvent::MatchmakingJoined:		return TEXT("MatchmakingJoined");
+	case EGameplayEvent::MatchmakingFailed:		return TEXT("MatchmakingFailed");
+	case EGameplayEvent::Throw:					return TEXT("Throw");
+	case EGameplayEvent::Detonation:			return TEXT("Detonation");
+	case EGameplayEvent::Damage:				return TEXT("Damage");
+	case EGameplayEvent::Pickup:				return TEXT("Pickup");
+	case EGameplayEvent::Ragdoll:				return TEXT("Ragdoll");
+	case EGameplayEvent::Debug:					return TEXT("Debug");
+	default:									return TEXT("Unknown");
+	}
+}
+
+FString FGameplayEventRecorder::FormatRecord(const FGameplayEventRecord& Record)
+{
+	return FString::Printf(TEXT("%.4f [%u] %-20s %s#%u at (%.0f %.0f %.0f) value %.2f int %d %s"),
+		Record.Time, Record.Frame, GetEventName(Record.Type), *Record.SubjectClass.ToString(), Record.SubjectId,
+		Record.Location.X, Record.Location.Y, Record.Location.Z, Record.Value, Record.IntValue, ANSI_TO_TCHAR(Record.Text));
+}
+
+bool FGameplayEventRecorder::Dump(const FString& Path)
+{
+	TArray<FGameplayEventRecord> Records;
+	Snapshot(Records);
+
+	TArray<FString> Lines;
+	Lines.Reserve(Records.Num() + 1);
+	Lines.Add(FString::Printf(TEXT("# %d of %llu gameplay events, time frame type subject location value int text"), Records.Num(), GetNumRecorded()));
+	for (const FGameplayEventRecord& Record : Records)
+	{
+		Lines.Add(FormatRecord(Record));
+	}
+	return FFileHelper::SaveStringArrayToFile(Lines, *Path);
+}
+
+void FGameplayEventRecorder::Startup()
+{
+	using namespace GameplayEventRecorder;
+
+	CrashDumpPath = MakeDumpPath();
+	SystemErrorHandle = FCoreDelegates::OnHandleSystemError.AddStatic(&DumpOnCrash);
+
+#if !UE_BUILD_SHIPPING
+	ViewerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&TickViewer));
+#endif
+}
+
+void FGameplayEventRecorder::Shutdown()
+{
+	using namespace GameplayEventRecorder;
+
+	FCoreDelegates::OnHandleSystemError.Remove(SystemErrorHandle);
+
+#if !UE_BUILD_SHIPPING
+	FTSTicker::GetCoreTicker().RemoveTicker(ViewerHandle);
+#endif
+}
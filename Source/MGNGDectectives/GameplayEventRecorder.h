@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EGameplayEvent : uint8
+{
+	SessionCreateStarted,
+	SessionCreated,
+	SessionCreateFailed,
+	MatchmakingStarted,
+	MatchmakingJoined,
+	MatchmakingFailed,
+	Throw,
+	Detonation,
+	Damage,
+	Pickup,
+	Ragdoll,
+	/** Free text from PrintOnDebug, IntValue is its full length so a line cut to fit the record shows as such */
+	Debug,
+	Num
+};
+
+/** One recorded event, fixed size so the ring never allocates, 128 bytes outside the editor */
+struct FGameplayEventRecord
+{
+	/** FPlatformTime::Seconds when it was recorded */
+	double Time = 0.0;
+	uint32 Frame = 0;
+
+	/** Unique id and class of the actor or object it is about, 0 and None without one */
+	uint32 SubjectId = 0;
+	FName SubjectClass;
+
+	FVector3f Location = FVector3f::ZeroVector;
+
+	/** Meaning depends on the type: damage amount, launch speed, piece id, ping */
+	float Value = 0.0f;
+	int32 IntValue = 0;
+
+	EGameplayEvent Type = EGameplayEvent::Debug;
+
+	/** Long enough for a debug line, ASCII only */
+	ANSICHAR Text[83] = {};
+};
+
+/**
+ * Fixed-capacity ring of the most recent gameplay events: session lifecycle, throws, detonations, damage and pickups.
+ * Record can be called from any thread; it claims a slot with one atomic increment and copies the record in,
+ * without locks or allocations, the oldest events being overwritten. Readers skip slots that are mid-write.
+ *
+ * mgng.Events.Dump writes the ring as text to Saved/Logs, which also happens when the game crashes.
+ * Outside Shipping mgng.Events.OnScreen N shows the newest N events on screen instead of the old debug messages.
+ */
+class MGNGDECTECTIVES_API FGameplayEventRecorder
+{
+public:
+	static constexpr int32 Capacity = 8192;
+
+	static void Record(EGameplayEvent Type, const UObject* Subject = nullptr, const FVector& Location = FVector::ZeroVector, float Value = 0.0f, int32 IntValue = 0, const TCHAR* Text = nullptr);
+
+	/** Copies up to MaxRecords of the newest complete records into OutRecords, oldest first */
+	static void Snapshot(TArray<FGameplayEventRecord>& OutRecords, int32 MaxRecords = Capacity);
+
+	/** Writes every record still in the ring as one text line each, returns false if the file couldn't be written */
+	static bool Dump(const FString& Path);
+
+	static FString FormatRecord(const FGameplayEventRecord& Record);
+	static const TCHAR* GetEventName(EGameplayEvent Type);
+
+	/** Total events recorded, including the ones already overwritten */
+	static uint64 GetNumRecorded();
+
+	/** Called by the module, hooks the crash dump and the on-screen viewer */
+	static void Startup();
+	static void Shutdown();
+};
@@ -3,76 +3,421 @@
 
 #include "Granade.h"
 
+#include "ExplosionEffectsSubsystem.h"
+#include "ExplosionResolverSubsystem.h"
+#include "GameplayEventRecorder.h"
+#include "GranadeAssetData.h"
+#include "GranadePoolSubsystem.h"
+#include "MGNGDectectives.h"
 #include "MGNGDectectivesCharacter.h"
 #include "Components/SphereComponent.h"
+#include "GameFramework/GameStateBase.h"
 #include "Kismet/GameplayStatics.h"
+#include "Engine/StaticMesh.h"
+#include "Net/UnrealNetwork.h"
+#include "UObject/ConstructorHelpers.h"
+
+DECLARE_CYCLE_STAT(TEXT("Granade Overlap"), STAT_GranadeOverlap, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Granade Net State"), STAT_GranadeNetState, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Granade Detonate"), STAT_GranadeDetonate, STATGROUP_MGNGDectectives);
 
 // Sets default values
 AGranade::AGranade()
 {
-	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
-	
-	GranadeMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("GranadeMesh"));
-	GranadeMesh->SetupAttachment(RootComponent);
+	// Everything that follows the mesh is attached to it, the fuse runs on a timer
+	PrimaryActorTick.bCanEverTick = false;
 
-	FString MeshPath = TEXT("/Game/StarterContent/Shapes/Shape_Cylinder.Shape_Cylinder");
-	UStaticMesh* GranadeMeshAsset = LoadObject<UStaticMesh>(nullptr, *MeshPath);
-	GranadeMesh->SetStaticMesh(GranadeMeshAsset);
+	// Clients simulate the arc from NetState, so movement itself is never replicated
+	bReplicates = true;
+	SetReplicateMovement(false);
+
+	// The mesh comes from AssetData once UGranadePoolSubsystem has streamed it in. The mesh carries the projectile
+	// collision, so an engine shape stands in until then rather than a grenade thrown early falling through the world
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> PlaceholderMesh(TEXT("/Engine/BasicShapes/Cylinder.Cylinder"));
+	GranadeMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("GranadeMesh"));
+	GranadeMesh->SetStaticMesh(PlaceholderMesh.Object);
+	SetRootComponent(GranadeMesh);
 
 	ProjectileMovement = CreateDefaultSubobject<UProjectileMovementComponent>(TEXT("ProjectileMovement"));
 	ProjectileMovement->InitialSpeed = Impulso;
-
-	FString SoundPath = TEXT("/Game/StarterContent/Audio/Explosion01.Explosion01");
-	ExplosionSound = LoadObject<USoundBase>(nullptr, *SoundPath);
+	// Fixed sub-steps keep the server copy, the proxies and the predicted proxy on the same arc
+	ProjectileMovement->bForceSubStepping = true;
+	ProjectileMovement->MaxSimulationTimeStep = 1.0f / 60.0f;
 
 	RadialForce = CreateDefaultSubobject<URadialForceComponent>(TEXT("RadialForce"));
-	RadialForce->SetupAttachment(RootComponent);
-	RadialForce->SetWorldLocation(GranadeMesh->GetComponentLocation());
+	RadialForce->SetupAttachment(GranadeMesh);
 	RadialForce->Radius = 500.0f;
 	RadialForce->ImpulseStrength = 200000.0f;
 
 	SphereCollision = CreateDefaultSubobject<USphereComponent>(TEXT("SphereComponent"));
 	SphereCollision->SetupAttachment(GranadeMesh);
 	SphereCollision->OnComponentBeginOverlap.AddDynamic(this, &ThisClass::OverlapBegin);
-	counter = 0;
+}
+
+void AGranade::PostLoad()
+{
+	Super::PostLoad();
+
+	if (ExplosionSound_DEPRECATED.IsNull() && ExplosionParticles_DEPRECATED.IsNull())
+	{
+		return;
+	}
+
+	// Only saved by Blueprints from before AssetData existed, which can't have one set yet
+	if (AssetData.IsNull())
+	{
+		// The rest keeps the StarterContent defaults; lives in the Blueprint's package and is saved with it
+		UGranadeAssetData* Migrated = NewObject<UGranadeAssetData>(this, MakeUniqueObjectName(this, UGranadeAssetData::StaticClass(), TEXT("MigratedAssetData")), RF_Public | RF_Transactional);
+		if (!ExplosionSound_DEPRECATED.IsNull())
+		{
+			Migrated->ExplosionSound = ExplosionSound_DEPRECATED;
+		}
+		if (!ExplosionParticles_DEPRECATED.IsNull())
+		{
+			Migrated->ExplosionParticles = ExplosionParticles_DEPRECATED;
+		}
+		AssetData = Migrated;
+		UE_LOG(LogMGNGDectectives, Log, TEXT("%s: moved its explosion effects into %s, resave it to keep them"), *GetPathName(), *Migrated->GetPathName());
+	}
+	else
+	{
+		UE_LOG(LogMGNGDectectives, Warning, TEXT("%s: has both AssetData and old explosion effects, the old ones are ignored"), *GetPathName());
+	}
+
+	ExplosionSound_DEPRECATED.Reset();
+	ExplosionParticles_DEPRECATED.Reset();
 }
 
 // Called when the game starts or when spawned
 void AGranade::BeginPlay()
 {
 	Super::BeginPlay();
+
+	ApplyLoadedAssets();
+
+	if (GetLocalRole() != ROLE_Authority)
+	{
+		// Copies owned by the server only ever move from NetState
+		if (NetState.bInFlight)
+		{
+			ApplyNetState();
+		}
+		else
+		{
+			StopSimulation();
+		}
+		return;
+	}
+
+	if (!bInPool)
+	{
+		StartFuse();
+	}
 }
 
-void AGranade::Tick(float DeltaSeconds)
+void AGranade::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
-	RadialForce->SetWorldLocation(GranadeMesh->GetComponentLocation());
-	SphereCollision->SetWorldLocation(GranadeMesh->GetComponentLocation());
-	/*counter += DeltaSeconds;
-	if(counter >= 3.0f)
-	{
-		UWorld* World = GetWorld();
-		UGameplayStatics::ApplyRadialDamage(World, RadialForce->ImpulseStrength, GetActorLocation(), RadialForce->Radius, nullptr, IgnoreActors);
-		RadialForce->FireImpulse();
-		UGameplayStatics::SpawnSound2D(World, ExplosionSound, 1.0f,1.0f,0.0f,nullptr,false,true);
-		UGameplayStatics::SpawnEmitterAtLocation(World, ExplosionParticles, GetActorLocation());
-		Destroy();
-	}*/
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AGranade, NetState);
 }
 
 void AGranade::OverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult & SweepResult)
 {
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_GranadeOverlap);
+
 	ACharacter* Character = Cast<ACharacter>(OtherActor);
 
 	if (Character != nullptr)
 	{
-		UWorld* World = GetWorld();
+		Detonate();
+	}
+}
+
+void AGranade::Launch(const FVector& Origin, const FVector& Direction, float Speed, float LaunchTime, uint8 ThrowId, bool bPredicted)
+{
+	bPredictedProxy = bPredicted;
+
+	NetState.Origin = Origin;
+	NetState.Direction = Direction.GetSafeNormal();
+	NetState.Speed = Speed;
+	NetState.LaunchTime = LaunchTime;
+	NetState.ThrowId = ThrowId;
+	NetState.bInFlight = true;
+
+	ApplyNetState();
+	StartFuse();
+
+	if (!bPredictedProxy)
+	{
+		ForceNetUpdate();
+	}
+}
+
+FVector AGranade::GetDefaultLaunchVelocity(TSubclassOf<AGranade> GranadeClass, const FQuat& Rotation)
+{
+	if (!GranadeClass)
+	{
+		return FVector::ZeroVector;
+	}
+
+	// Same launch velocity UProjectileMovementComponent::InitializeComponent gives a fresh spawn
+	const UProjectileMovementComponent* DefaultMovement = GranadeClass->GetDefaultObject<AGranade>()->ProjectileMovement;
+	FVector InitialVelocity = DefaultMovement->Velocity;
+	if (DefaultMovement->InitialSpeed > 0.f)
+	{
+		InitialVelocity = InitialVelocity.GetSafeNormal() * DefaultMovement->InitialSpeed;
+	}
+	if (DefaultMovement->bInitialVelocityInLocalSpace)
+	{
+		InitialVelocity = Rotation.RotateVector(InitialVelocity);
+	}
+	return InitialVelocity;
+}
+
+float AGranade::GetSyncedWorldTime(const UWorld* World)
+{
+	if (const AGameStateBase* GameState = World->GetGameState())
+	{
+		return static_cast<float>(GameState->GetServerWorldTimeSeconds());
+	}
+	return World->GetTimeSeconds();
+}
+
+void AGranade::OnRep_NetState(const FGranadeNetState& PreviousState)
+{
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_GranadeNetState);
+
+	if (NetState.bInFlight)
+	{
+		SetActorHiddenInGame(false);
+		SetActorEnableCollision(true);
+		ApplyNetState();
+
+		// The throwing client drops its predicted proxy now that the server copy is here
+		const bool bNewThrow = !PreviousState.bInFlight || PreviousState.ThrowId != NetState.ThrowId;
+		AMGNGDectectivesCharacter* Thrower = Cast<AMGNGDectectivesCharacter>(GetOwner());
+		if (bNewThrow && Thrower != nullptr && Thrower->IsLocallyControlled())
+		{
+			Thrower->ReconcilePredictedGranada(NetState.ThrowId);
+		}
+	}
+	else
+	{
+		StopSimulation();
+		if (PreviousState.bInFlight)
+		{
+			PlayExplosionEffects(NetState.DetonationLocation);
+		}
+	}
+}
+
+void AGranade::ApplyNetState()
+{
+	const float Elapsed = FMath::Clamp(GetSyncedWorldTime(GetWorld()) - NetState.LaunchTime, 0.0f, MaxLaunchFastForward);
+	const FVector Gravity(0.0f, 0.0f, ProjectileMovement->GetGravityZ());
+	const FVector LaunchVelocity = FVector(NetState.Direction) * NetState.Speed;
+	const FVector Location = FVector(NetState.Origin) + LaunchVelocity * Elapsed + Gravity * (0.5f * Elapsed * Elapsed);
+
+	SetActorLocationAndRotation(Location, FVector(NetState.Direction).Rotation(), false, nullptr, ETeleportType::ResetPhysics);
+
+	ProjectileMovement->SetUpdatedComponent(GetRootComponent());
+	ProjectileMovement->Velocity = LaunchVelocity + Gravity * Elapsed;
+	ProjectileMovement->Activate(true);
+	ProjectileMovement->UpdateComponentVelocity();
+}
+
+void AGranade::StopSimulation()
+{
+	SetActorEnableCollision(false);
+	SetActorHiddenInGame(true);
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->Deactivate();
+}
+
+void AGranade::PlayExplosionEffects(const FVector& Location)
+{
+	SpawnExplosionEffects(GetWorld(), AssetData, Location);
+}
+
+void AGranade::SpawnExplosionEffects(UWorld* World, const TSoftObjectPtr<UGranadeAssetData>& AssetData, const FVector& Location)
+{
+	if (World == nullptr || World->GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	// Whatever hasn't been streamed in yet is skipped rather than loaded on the spot
+	if (UExplosionEffectsSubsystem* Effects = World->GetSubsystem<UExplosionEffectsSubsystem>())
+	{
+		const UGranadeAssetData* Assets = UGranadeAssetData::Resolve(AssetData);
+		Effects->PlayExplosion(Assets->ExplosionSound.Get(), Assets->ExplosionParticles.Get(), Location);
+	}
+}
+
+void AGranade::FillExplosion(FQueuedExplosion& Explosion) const
+{
+	Explosion.Radius = RadialForce->Radius;
+	Explosion.BaseDamage = RadialForce->ImpulseStrength;
+	Explosion.ImpulseStrength = RadialForce->ImpulseStrength;
+	Explosion.Falloff = RadialForce->Falloff;
+	Explosion.bImpulseVelChange = RadialForce->bImpulseVelChange;
+	Explosion.IgnoreActors.Append(IgnoreActors);
+	// The class default object fills in batched projectiles, which have no actor of their own to leave out
+	if (RadialForce->bIgnoreOwningActor && !IsTemplate())
+	{
+		Explosion.IgnoreActors.Add(const_cast<AGranade*>(this));
+	}
+}
+
+float AGranade::GetCollisionRadius() const
+{
+	return SphereCollision->GetScaledSphereRadius();
+}
+
+void AGranade::StartFuse()
+{
+	if (bPredictedProxy)
+	{
+		// A proxy never explodes, it only has to disappear if the server copy doesn't take over
+		const float Lifetime = FuseTime > 0.0f ? FuseTime : PredictedProxyLifetime;
+		GetWorldTimerManager().SetTimer(FuseTimerHandle, this, &ThisClass::ReturnToPool, Lifetime);
+	}
+	else if (FuseTime > 0.0f)
+	{
+		GetWorldTimerManager().SetTimer(FuseTimerHandle, this, &ThisClass::Detonate, FuseTime);
+	}
+}
+
+void AGranade::Detonate()
+{
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_GranadeDetonate);
+
+	if (bInPool)
+	{
+		return;
+	}
+
+	if (bPredictedProxy)
+	{
+		// The blast comes from the server copy
+		ReturnToPool();
+		return;
+	}
+
+	if (GetLocalRole() != ROLE_Authority)
+	{
+		return;
+	}
+
+	GetWorldTimerManager().ClearTimer(FuseTimerHandle);
+	FGameplayEventRecorder::Record(EGameplayEvent::Detonation, this, GetActorLocation(), RadialForce->Radius);
+
+	UWorld* World = GetWorld();
+	if (UExplosionResolverSubsystem* Resolver = World->GetSubsystem<UExplosionResolverSubsystem>())
+	{
+		// Damage and impulse are resolved with every other explosion of this frame
+		FQueuedExplosion Explosion;
+		Explosion.Origin = GetActorLocation();
+		FillExplosion(Explosion);
+		Explosion.DamageCauser = this;
+		Explosion.InstigatedBy = GetInstigatorController();
+		Resolver->QueueExplosion(MoveTemp(Explosion));
+	}
+	else
+	{
 		UGameplayStatics::ApplyRadialDamage(World, RadialForce->ImpulseStrength, GetActorLocation(), RadialForce->Radius, nullptr, IgnoreActors);
 		RadialForce->FireImpulse();
-		UGameplayStatics::SpawnSound2D(World, ExplosionSound, 1.0f,1.0f,0.0f,nullptr,false,true);
-		UGameplayStatics::SpawnEmitterAtLocation(World, ExplosionParticles, GetActorLocation());
+	}
+
+	// Clients play the effects when they see the grenade land
+	NetState.DetonationLocation = GetActorLocation();
+	NetState.bInFlight = false;
+	PlayExplosionEffects(GetActorLocation());
+	ReturnToPool();
+}
+
+void AGranade::ActivateFromPool(const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator)
+{
+	bInPool = false;
+	bPredictedProxy = false;
+	if (GetIsReplicated() && GetNetMode() != NM_Client)
+	{
+		SetNetDormancy(DORM_Awake);
+	}
+
+	SetOwner(NewOwner);
+	SetInstigator(NewInstigator);
+	SetActorLocationAndRotation(SpawnTransform.GetLocation(), SpawnTransform.GetRotation(), false, nullptr, ETeleportType::ResetPhysics);
+
+	const AGranade* DefaultGranade = GetClass()->GetDefaultObject<AGranade>();
+	ApplyLoadedAssets();
+	ProjectileMovement->SetUpdatedComponent(GetRootComponent());
+	ProjectileMovement->Velocity = GetDefaultLaunchVelocity(GetClass(), SpawnTransform.GetRotation());
+	ProjectileMovement->Activate(true);
+	ProjectileMovement->UpdateComponentVelocity();
+
+	RadialForce->SetActive(DefaultGranade->RadialForce->bAutoActivate, true);
+
+	SetActorHiddenInGame(false);
+	StartFuse();
+	// Re-enabling collision refreshes the sphere's overlaps at the new location
+	SetActorEnableCollision(true);
+}
+
+void AGranade::DeactivateToPool()
+{
+	bInPool = true;
+	bPredictedProxy = false;
+	NetState.bInFlight = false;
+	StopSimulation();
+	GetWorldTimerManager().ClearTimer(FuseTimerHandle);
+	RadialForce->Deactivate();
+
+	if (GranadeMesh->IsSimulatingPhysics())
+	{
+		GranadeMesh->SetPhysicsLinearVelocity(FVector::ZeroVector);
+		GranadeMesh->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
+	}
+
+	SetOwner(nullptr);
+	SetInstigator(nullptr);
+
+	// Parked grenades cost nothing to replicate until they are handed out again
+	if (GetIsReplicated() && GetNetMode() != NM_Client)
+	{
+		SetNetDormancy(DORM_DormantAll);
+	}
+}
+
+void AGranade::ReturnToPool()
+{
+	UGranadePoolSubsystem* Pool = GetWorld()->GetSubsystem<UGranadePoolSubsystem>();
+	if (Pool != nullptr)
+	{
+		Pool->Release(this);
+	}
+	else
+	{
 		Destroy();
 	}
 }
 
+void AGranade::ApplyLoadedAssets()
+{
+	if (UStaticMesh* Mesh = GetDisplayMesh())
+	{
+		GranadeMesh->SetStaticMesh(Mesh);
+	}
+}
 
+UStaticMesh* AGranade::GetDisplayMesh() const
+{
+	// Blueprints that set their own mesh keep it
+	UStaticMesh* Mesh = GranadeMesh->GetStaticMesh();
+	if (Mesh != nullptr && Mesh != GetDefault<AGranade>()->GranadeMesh->GetStaticMesh())
+	{
+		return Mesh;
+	}
+	return UGranadeAssetData::Resolve(AssetData)->Mesh.Get();
+}
@@ -7,8 +7,44 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "PhysicsEngine/RadialForceComponent.h"
+#include "Engine/NetSerialization.h"
 #include "Granade.generated.h"
 
+class UGranadeAssetData;
+class UParticleSystem;
+class USoundBase;
+struct FQueuedExplosion;
+
+/** Everything a client needs to simulate the same arc as the server, sent once per throw */
+USTRUCT()
+struct FGranadeNetState
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	UPROPERTY()
+	float Speed = 0.0f;
+
+	/** Server world time the arc starts at */
+	UPROPERTY()
+	float LaunchTime = 0.0f;
+
+	/** Throw counter of the owning client, matches the server copy with its predicted proxy */
+	UPROPERTY()
+	uint8 ThrowId = 0;
+
+	UPROPERTY()
+	bool bInFlight = false;
+
+	UPROPERTY()
+	FVector_NetQuantize DetonationLocation;
+};
+
 UCLASS()
 class MGNGDECTECTIVES_API AGranade : public AActor
 {
@@ -20,11 +56,16 @@ class MGNGDECTECTIVES_API AGranade : public AActor
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class UProjectileMovementComponent* ProjectileMovement;
 
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Sound, meta = (AllowPrivateAccess = "true"))
-	class USoundBase* ExplosionSound;
+	/** Mesh and explosion effects, the UGranadeAssetData defaults when unset */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Assets, meta = (AllowPrivateAccess = "true"))
+	TSoftObjectPtr<UGranadeAssetData> AssetData;
+
+	/** Effects set before they moved to AssetData, PostLoad copies what a Blueprint still has saved into a data asset */
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the AssetData instead"))
+	TSoftObjectPtr<USoundBase> ExplosionSound_DEPRECATED;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Particles, meta = (AllowPrivateAccess = "true"))
-	class UParticleSystem* ExplosionParticles;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Set on the AssetData instead"))
+	TSoftObjectPtr<UParticleSystem> ExplosionParticles_DEPRECATED;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Physics, meta = (AllowPrivateAccess = "true"))
 	class URadialForceComponent* RadialForce;
@@ -40,15 +81,97 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-	virtual void Tick(float DeltaSeconds) override;
+	virtual void PostLoad() override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
 	UFUNCTION()
 	void OverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult & SweepResult);
 
 public:
+	/** Puts a parked grenade back in play as if it had just been spawned at SpawnTransform */
+	void ActivateFromPool(const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator);
+
+	/** Hides the grenade and stops its components so UGranadePoolSubsystem can hand it out again */
+	void DeactivateToPool();
+
+	/**
+	 * Starts the arc from Origin along Direction as if it had been thrown at LaunchTime.
+	 * On the server this is replicated to every client, a predicted proxy only lives on the throwing client.
+	 */
+	void Launch(const FVector& Origin, const FVector& Direction, float Speed, float LaunchTime, uint8 ThrowId, bool bPredicted);
+
+	/** Returns the grenade to the world's pool, or destroys it if there is none */
+	void ReturnToPool();
+
+	/** Puts the streamed in mesh on a grenade that still has the placeholder */
+	void ApplyLoadedAssets();
+
+	/** The Blueprint's own mesh, or AssetData's once it has streamed in, null while only the placeholder is there */
+	UStaticMesh* GetDisplayMesh() const;
+
+	FORCEINLINE const TSoftObjectPtr<UGranadeAssetData>& GetAssetData() const { return AssetData; }
+
+	FORCEINLINE bool IsInPool() const { return bInPool; }
+	FORCEINLINE bool IsPredictedProxy() const { return bPredictedProxy; }
+	FORCEINLINE uint8 GetThrowId() const { return NetState.ThrowId; }
+
+	/** Launch velocity a freshly spawned GranadeClass gets when facing Rotation */
+	static FVector GetDefaultLaunchVelocity(TSubclassOf<AGranade> GranadeClass, const FQuat& Rotation);
+
+	/** Server world time, shared by the server and every client to line up arcs */
+	static float GetSyncedWorldTime(const UWorld* World);
+
+	/** Fills in radius, damage, impulse and the actors the blast leaves out, also works on the class default object */
+	void FillExplosion(FQueuedExplosion& Explosion) const;
+
+	/** Plays the explosion sound and particles of Assets at Location, nothing on a dedicated server */
+	static void SpawnExplosionEffects(UWorld* World, const TSoftObjectPtr<UGranadeAssetData>& Assets, const FVector& Location);
+
+	/** Radius of the sphere that detects characters */
+	float GetCollisionRadius() const;
+
+	FORCEINLINE const UProjectileMovementComponent* GetProjectileMovement() const { return ProjectileMovement; }
+
 	UPROPERTY(EditAnywhere, Category="Weas")
 	float Impulso;
-	float counter;
+
+	/** Seconds after launch before the grenade goes off on its own, 0 only detonates on contact */
+	UPROPERTY(EditAnywhere, Category="Weas")
+	float FuseTime = 0.0f;
+
+	/** Furthest a launch is fast-forwarded to catch up with the thrower's timestamp */
+	UPROPERTY(EditAnywhere, Category="Weas")
+	float MaxLaunchFastForward = 0.3f;
+
+	/** Seconds a predicted proxy lives without being reconciled before it is dropped */
+	UPROPERTY(EditAnywhere, Category="Weas")
+	float PredictedProxyLifetime = 5.0f;
 
 	TArray<AActor*> IgnoreActors;
+
+private:
+	UFUNCTION()
+	void OnRep_NetState(const FGranadeNetState& PreviousState);
+
+	/** Places the grenade where NetState says it is right now and sets its velocity */
+	void ApplyNetState();
+
+	/** Stops movement and collision without touching the pool, used for copies the server owns */
+	void StopSimulation();
+
+	void PlayExplosionEffects(const FVector& Location);
+
+	void StartFuse();
+
+	/** Applies the blast, plays the effects and hands the grenade back */
+	void Detonate();
+
+	UPROPERTY(ReplicatedUsing=OnRep_NetState)
+	FGranadeNetState NetState;
+
+	FTimerHandle FuseTimerHandle;
+
+	bool bInPool = false;
+	bool bPredictedProxy = false;
 };
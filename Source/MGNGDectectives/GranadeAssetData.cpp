@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GranadeAssetData.h"
+
+#include "Engine/StaticMesh.h"
+#include "Particles/ParticleSystem.h"
+#include "Sound/SoundBase.h"
+
+UGranadeAssetData::UGranadeAssetData()
+{
+	// Paths only, nothing is loaded here
+	Mesh = TSoftObjectPtr<UStaticMesh>(FSoftObjectPath(TEXT("/Game/StarterContent/Shapes/Shape_Cylinder.Shape_Cylinder")));
+	ExplosionSound = TSoftObjectPtr<USoundBase>(FSoftObjectPath(TEXT("/Game/StarterContent/Audio/Explosion01.Explosion01")));
+	ExplosionParticles = TSoftObjectPtr<UParticleSystem>(FSoftObjectPath(TEXT("/Game/StarterContent/Particles/P_Explosion.P_Explosion")));
+}
+
+const UGranadeAssetData* UGranadeAssetData::Resolve(const TSoftObjectPtr<UGranadeAssetData>& AssetData)
+{
+	const UGranadeAssetData* Loaded = AssetData.Get();
+	return Loaded != nullptr ? Loaded : GetDefault<UGranadeAssetData>();
+}
+
+void UGranadeAssetData::GetAssetPaths(TArray<FSoftObjectPath>& OutPaths) const
+{
+	for (const FSoftObjectPath& Path : { Mesh.ToSoftObjectPath(), ExplosionSound.ToSoftObjectPath(), ExplosionParticles.ToSoftObjectPath() })
+	{
+		if (Path.IsValid())
+		{
+			OutPaths.AddUnique(Path);
+		}
+	}
+}
@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "GranadeAssetData.generated.h"
+
+class UParticleSystem;
+class USoundBase;
+class UStaticMesh;
+
+/**
+ * Meshes and effects of a grenade, referenced softly so spawning a grenade never loads anything.
+ * UGranadePoolSubsystem streams them in when a map starts. The class default object points at the
+ * StarterContent assets and is used by grenades that have no data asset of their own.
+ */
+UCLASS(BlueprintType)
+class MGNGDECTECTIVES_API UGranadeAssetData : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UGranadeAssetData();
+
+	/** Data asset to use for a grenade, the defaults when none is set */
+	static const UGranadeAssetData* Resolve(const TSoftObjectPtr<UGranadeAssetData>& AssetData);
+
+	/** Everything that has to be loaded before a grenade using this data can be shown */
+	void GetAssetPaths(TArray<FSoftObjectPath>& OutPaths) const;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Granade)
+	TSoftObjectPtr<UStaticMesh> Mesh;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Granade)
+	TSoftObjectPtr<USoundBase> ExplosionSound;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Granade)
+	TSoftObjectPtr<UParticleSystem> ExplosionParticles;
+};
@@ -0,0 +1,285 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GranadePoolSubsystem.h"
+
+#include "MGNGDectectives.h"
+#include "GranadeAssetData.h"
+#include "EngineUtils.h"
+#include "Engine/AssetManager.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Game Thread Sync Loads"), STAT_GameThreadSyncLoads, STATGROUP_MGNGDectectives);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Granade Asset Preload (ms)"), STAT_GranadeAssetPreloadMs, STATGROUP_MGNGDectectives);
+
+namespace GranadePool
+{
+	// Parked grenades wait far below the playable space
+	const FVector ParkLocation(0.0f, 0.0f, -100000.0f);
+}
+
+static FAutoConsoleCommandWithWorld GranadePoolStatsCommand(
+	TEXT("mgng.Pool.Stats"),
+	TEXT("Prints grenade pool hits, misses and parked instances for the current world."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UGranadePoolSubsystem* Pool = World ? World->GetSubsystem<UGranadePoolSubsystem>() : nullptr)
+		{
+			Pool->LogStats();
+		}
+	})
+);
+
+bool UGranadePoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UGranadePoolSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	SyncLoadHandle = FCoreUObjectDelegates::OnSyncLoadPackage.AddUObject(this, &ThisClass::OnSyncLoadPackage);
+}
+
+void UGranadePoolSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (!DefaultGranadeClass.IsNull())
+	{
+		// Prewarming waits for the class instead of loading it on the spot
+		AssetHandles.Add(UAssetManager::GetStreamableManager().RequestAsyncLoad(
+			DefaultGranadeClass.ToSoftObjectPath(),
+			FStreamableDelegate::CreateUObject(this, &ThisClass::OnDefaultClassLoaded)));
+	}
+}
+
+void UGranadePoolSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::OnSyncLoadPackage.Remove(SyncLoadHandle);
+
+	LogStats();
+	Pools.Empty();
+	PreloadedClasses.Empty();
+	for (const TSharedPtr<FStreamableHandle>& Handle : AssetHandles)
+	{
+		if (Handle.IsValid())
+		{
+			Handle->ReleaseHandle();
+		}
+	}
+	AssetHandles.Empty();
+
+	Super::Deinitialize();
+}
+
+int32 UGranadePoolSubsystem::GetPrewarmCount() const
+{
+	const FString MapName = UWorld::RemovePIEPrefix(GetWorld()->GetMapName());
+	if (const int32* MapCount = PrewarmCountPerMap.Find(MapName))
+	{
+		return *MapCount;
+	}
+	return PrewarmCount;
+}
+
+void UGranadePoolSubsystem::OnDefaultClassLoaded()
+{
+	if (UClass* GranadeClass = DefaultGranadeClass.Get())
+	{
+		Prewarm(GranadeClass, GetPrewarmCount());
+	}
+}
+
+void UGranadePoolSubsystem::PreloadAssets(TSubclassOf<AGranade> GranadeClass)
+{
+	if (!GranadeClass || PreloadedClasses.Contains(GranadeClass))
+	{
+		return;
+	}
+	PreloadedClasses.Add(GranadeClass);
+
+	const TSoftObjectPtr<UGranadeAssetData>& AssetData = GranadeClass->GetDefaultObject<AGranade>()->GetAssetData();
+	if (AssetData.IsNull() || AssetData.IsValid())
+	{
+		RequestAssetData(GranadeClass, UGranadeAssetData::Resolve(AssetData));
+		return;
+	}
+
+	// The data asset has to arrive before we know what it points at
+	TWeakObjectPtr<UClass> WeakClass = GranadeClass.Get();
+	AssetHandles.Add(UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		AssetData.ToSoftObjectPath(),
+		FStreamableDelegate::CreateWeakLambda(this, [this, WeakClass, AssetData]()
+		{
+			if (UClass* LoadedClass = WeakClass.Get())
+			{
+				RequestAssetData(LoadedClass, UGranadeAssetData::Resolve(AssetData));
+			}
+		})));
+}
+
+void UGranadePoolSubsystem::RequestAssetData(UClass* GranadeClass, const UGranadeAssetData* Assets)
+{
+	TArray<FSoftObjectPath> Paths;
+	Assets->GetAssetPaths(Paths);
+	if (Paths.Num() == 0)
+	{
+		return;
+	}
+
+	const double RequestTime = FPlatformTime::Seconds();
+	TWeakObjectPtr<UClass> WeakClass = GranadeClass;
+	AssetHandles.Add(UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		MoveTemp(Paths),
+		FStreamableDelegate::CreateWeakLambda(this, [this, WeakClass, RequestTime]()
+		{
+			OnAssetsLoaded(WeakClass.Get(), RequestTime);
+		})));
+}
+
+void UGranadePoolSubsystem::OnAssetsLoaded(UClass* GranadeClass, double RequestTime)
+{
+	const float LoadMs = (FPlatformTime::Seconds() - RequestTime) * 1000.0;
+	SET_FLOAT_STAT(STAT_GranadeAssetPreloadMs, LoadMs);
+	UE_LOG(LogMGNGDectectives, Log, TEXT("Granade assets for %s streamed in after %.1f ms"), *GetNameSafe(GranadeClass), LoadMs);
+
+	if (GranadeClass == nullptr)
+	{
+		return;
+	}
+
+	// Grenades spawned before the mesh arrived pick it up now
+	for (TActorIterator<AGranade> It(GetWorld(), GranadeClass); It; ++It)
+	{
+		It->ApplyLoadedAssets();
+	}
+}
+
+void UGranadePoolSubsystem::OnSyncLoadPackage(const FString& PackageName)
+{
+	if (!IsInGameThread() || !GetWorld()->HasBegunPlay())
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_GameThreadSyncLoads);
+	++SyncLoadsDuringPlay;
+	UE_LOG(LogMGNGDectectives, Warning, TEXT("Synchronous load of %s on the game thread during play"), *PackageName);
+}
+
+void UGranadePoolSubsystem::Prewarm(TSubclassOf<AGranade> GranadeClass, int32 Count)
+{
+	if (!GranadeClass)
+	{
+		return;
+	}
+
+	PreloadAssets(GranadeClass);
+
+	FGranadePool& Pool = Pools.FindOrAdd(GranadeClass);
+	const int32 Target = FMath::Min(Count, MaxPooledPerClass);
+	while (Pool.Available.Num() < Target)
+	{
+		AGranade* Granade = SpawnParked(GranadeClass);
+		if (Granade == nullptr)
+		{
+			break;
+		}
+		Pool.Available.Add(Granade);
+	}
+}
+
+AGranade* UGranadePoolSubsystem::Acquire(TSubclassOf<AGranade> GranadeClass, const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator)
+{
+	LLM_SCOPE_BYTAG(MGNG_Granades);
+
+	if (!GranadeClass)
+	{
+		return nullptr;
+	}
+
+	PreloadAssets(GranadeClass);
+
+	if (FGranadePool* Pool = Pools.Find(GranadeClass))
+	{
+		while (Pool->Available.Num() > 0)
+		{
+			AGranade* Granade = Pool->Available.Pop(false);
+			if (IsValid(Granade))
+			{
+				++Hits;
+				Granade->ActivateFromPool(SpawnTransform, NewOwner, NewInstigator);
+				return Granade;
+			}
+		}
+	}
+
+	++Misses;
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = NewOwner;
+	SpawnParams.Instigator = NewInstigator;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	INC_DWORD_STAT(STAT_MGNGActorSpawns);
+	return GetWorld()->SpawnActor<AGranade>(GranadeClass, SpawnTransform, SpawnParams);
+}
+
+void UGranadePoolSubsystem::Release(AGranade* Granade)
+{
+	if (!IsValid(Granade) || Granade->IsInPool())
+	{
+		return;
+	}
+
+	FGranadePool& Pool = Pools.FindOrAdd(Granade->GetClass());
+	if (Pool.Available.Num() >= MaxPooledPerClass)
+	{
+		Granade->Destroy();
+		return;
+	}
+
+	Granade->DeactivateToPool();
+	Pool.Available.Add(Granade);
+}
+
+int32 UGranadePoolSubsystem::GetNumAvailable(TSubclassOf<AGranade> GranadeClass) const
+{
+	const FGranadePool* Pool = Pools.Find(GranadeClass);
+	return Pool ? Pool->Available.Num() : 0;
+}
+
+void UGranadePoolSubsystem::ResetCounters()
+{
+	Hits = 0;
+	Misses = 0;
+}
+
+void UGranadePoolSubsystem::LogStats() const
+{
+	UE_LOG(LogMGNGDectectives, Log, TEXT("Granade pool on %s: %d hits, %d misses, %d game thread sync loads during play"), *GetWorld()->GetMapName(), Hits, Misses, SyncLoadsDuringPlay);
+	for (const TPair<UClass*, FGranadePool>& Pair : Pools)
+	{
+		UE_LOG(LogMGNGDectectives, Log, TEXT("  %s: %d parked"), *GetNameSafe(Pair.Key), Pair.Value.Available.Num());
+	}
+}
+
+AGranade* UGranadePoolSubsystem::SpawnParked(TSubclassOf<AGranade> GranadeClass)
+{
+	LLM_SCOPE_BYTAG(MGNG_Granades);
+
+	const FTransform ParkTransform(GranadePool::ParkLocation);
+	INC_DWORD_STAT(STAT_MGNGActorSpawns);
+	AGranade* Granade = GetWorld()->SpawnActorDeferred<AGranade>(GranadeClass, ParkTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (Granade == nullptr)
+	{
+		return nullptr;
+	}
+
+	// No overlaps while it is registered at the park location
+	Granade->SetActorEnableCollision(false);
+	Granade->FinishSpawning(ParkTransform);
+	Granade->DeactivateToPool();
+	return Granade;
+}
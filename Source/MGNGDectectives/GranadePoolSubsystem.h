@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/StreamableManager.h"
+#include "Granade.h"
+#include "GranadePoolSubsystem.generated.h"
+
+USTRUCT()
+struct FGranadePool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<AGranade*> Available;
+};
+
+/**
+ * Keeps parked AGranade instances per class so throws and detonations don't spawn and destroy actors.
+ * Sizes come from DefaultGame.ini and can be overridden per map.
+ * Also streams in the grenade classes and their UGranadeAssetData when the map starts and keeps them loaded,
+ * and counts every synchronous package load on the game thread once play has begun.
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API UGranadePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Streams in the mesh and effects of GranadeClass in the background, once per class */
+	void PreloadAssets(TSubclassOf<AGranade> GranadeClass);
+
+	/** Synchronous loads seen on the game thread since play began */
+	FORCEINLINE int32 GetSyncLoadsDuringPlay() const { return SyncLoadsDuringPlay; }
+
+	/** Tops the pool for GranadeClass up to Count parked instances */
+	void Prewarm(TSubclassOf<AGranade> GranadeClass, int32 Count);
+
+	/** Hands out a parked grenade, spawning a new one if the pool is empty */
+	AGranade* Acquire(TSubclassOf<AGranade> GranadeClass, const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator);
+
+	/** Parks a grenade for reuse, destroying it if its pool is already full */
+	void Release(AGranade* Granade);
+
+	/** Parked instances wanted per class on the current map */
+	int32 GetPrewarmCount() const;
+
+	UFUNCTION(BlueprintCallable, Category=Pool)
+	int32 GetHits() const { return Hits; }
+
+	UFUNCTION(BlueprintCallable, Category=Pool)
+	int32 GetMisses() const { return Misses; }
+
+	UFUNCTION(BlueprintCallable, Category=Pool)
+	int32 GetNumAvailable(TSubclassOf<AGranade> GranadeClass) const;
+
+	void ResetCounters();
+	void LogStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Instances parked per class when a map starts */
+	UPROPERTY(Config)
+	int32 PrewarmCount = 8;
+
+	/** Per map override of PrewarmCount, keyed by map name without the PIE prefix */
+	UPROPERTY(Config)
+	TMap<FString, int32> PrewarmCountPerMap;
+
+	/** Parked instances kept per class, anything released past this is destroyed */
+	UPROPERTY(Config)
+	int32 MaxPooledPerClass = 32;
+
+	/** Grenade class prewarmed on OnWorldBeginPlay */
+	UPROPERTY(Config)
+	TSoftClassPtr<AGranade> DefaultGranadeClass;
+
+private:
+	AGranade* SpawnParked(TSubclassOf<AGranade> GranadeClass);
+
+	void OnDefaultClassLoaded();
+	void RequestAssetData(UClass* GranadeClass, const UGranadeAssetData* Assets);
+	void OnAssetsLoaded(UClass* GranadeClass, double RequestTime);
+	void OnSyncLoadPackage(const FString& PackageName);
+
+	/** Keeps everything streamed in by this subsystem resident until the world goes away */
+	TArray<TSharedPtr<FStreamableHandle>> AssetHandles;
+
+	UPROPERTY()
+	TSet<UClass*> PreloadedClasses;
+
+	FDelegateHandle SyncLoadHandle;
+	int32 SyncLoadsDuringPlay = 0;
+
+	UPROPERTY()
+	TMap<UClass*, FGranadePool> Pools;
+
+	int32 Hits = 0;
+	int32 Misses = 0;
+};
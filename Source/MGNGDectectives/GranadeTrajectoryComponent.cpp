@@ -0,0 +1,218 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GranadeTrajectoryComponent.h"
+
+#include "MGNGDectectives.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Granade Trajectory Trace"), STAT_GranadeTrajectoryTrace, STATGROUP_MGNGDectectives);
+
+UGranadeTrajectoryComponent::UGranadeTrajectoryComponent()
+{
+	// Work is driven by UpdatePrediction from the owner's Tick, async results come back through the trace delegate
+	PrimaryComponentTick.bCanEverTick = false;
+
+	AsyncTraceDelegate.BindUObject(this, &ThisClass::OnAsyncTraceDone);
+}
+
+void UGranadeTrajectoryComponent::UpdatePrediction(const FVector& StartLocation, const FVector& LaunchVelocity)
+{
+	// An arc still being traced is finished first, the newest aim is picked up once it resolves
+	if (!bTraceInFlight && NeedsRetrace(StartLocation, LaunchVelocity))
+	{
+		BuildPath(StartLocation, LaunchVelocity);
+
+		if (TraceMode == EGranadeTraceMode::Async)
+		{
+			SubmitAsyncTraces();
+		}
+	}
+
+	if (bTraceInFlight)
+	{
+		if (TraceMode == EGranadeTraceMode::Immediate)
+		{
+			TraceSegments(MAX_int32);
+		}
+		else if (TraceMode == EGranadeTraceMode::TimeSliced)
+		{
+			TraceSegments(FMath::Max(SegmentsPerFrame, 1));
+		}
+	}
+}
+
+void UGranadeTrajectoryComponent::ResetPrediction()
+{
+	PathPositions.Reset();
+	SegmentStates.Reset();
+	SegmentHits.Reset();
+	NextSegment = 0;
+	ResolvedPrefix = 0;
+	++Generation;
+	bHasPrediction = false;
+	bTraceInFlight = false;
+}
+
+bool UGranadeTrajectoryComponent::NeedsRetrace(const FVector& StartLocation, const FVector& LaunchVelocity) const
+{
+	if (PathPositions.Num() == 0)
+	{
+		return true;
+	}
+
+	if (FVector::DistSquared(StartLocation, CachedStart) > FMath::Square(LocationThreshold))
+	{
+		return true;
+	}
+
+	if (!FMath::IsNearlyEqual(LaunchVelocity.SizeSquared(), CachedVelocity.SizeSquared(), 1.0f))
+	{
+		return true;
+	}
+
+	const float CosThreshold = FMath::Cos(FMath::DegreesToRadians(AngleThreshold));
+	return FVector::DotProduct(LaunchVelocity.GetSafeNormal(), CachedVelocity.GetSafeNormal()) < CosThreshold;
+}
+
+void UGranadeTrajectoryComponent::BuildPath(const FVector& StartLocation, const FVector& LaunchVelocity)
+{
+	CachedStart = StartLocation;
+	CachedVelocity = LaunchVelocity;
+	++Generation;
+
+	const float GravityZ = GetWorld()->GetGravityZ();
+	const float SubstepDeltaTime = 1.0f / FMath::Max(SimFrequency, 1.0f);
+
+	PathPositions.Reset();
+	PathPositions.Add(StartLocation);
+
+	// Same velocity verlet integration as UGameplayStatics::PredictProjectilePath
+	FVector CurrentLocation = StartLocation;
+	FVector CurrentVelocity = LaunchVelocity;
+	float CurrentTime = 0.0f;
+	while (CurrentTime < MaxSimTime)
+	{
+		const float StepDeltaTime = FMath::Min(MaxSimTime - CurrentTime, SubstepDeltaTime);
+		CurrentTime += StepDeltaTime;
+
+		const FVector OldVelocity = CurrentVelocity;
+		CurrentVelocity = OldVelocity + FVector(0.0f, 0.0f, GravityZ * StepDeltaTime);
+		CurrentLocation += (OldVelocity + CurrentVelocity) * (0.5f * StepDeltaTime);
+		PathPositions.Add(CurrentLocation);
+	}
+
+	const int32 NumSegments = PathPositions.Num() - 1;
+	SegmentStates.Init(ESegmentState::Pending, NumSegments);
+	SegmentHits.SetNum(NumSegments);
+	NextSegment = 0;
+	ResolvedPrefix = 0;
+	bTraceInFlight = NumSegments > 0;
+}
+
+void UGranadeTrajectoryComponent::TraceSegments(int32 MaxSegments)
+{
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_GranadeTrajectoryTrace);
+
+	UWorld* World = GetWorld();
+	const FCollisionQueryParams QueryParams = MakeQueryParams();
+	const FCollisionShape Shape = FCollisionShape::MakeSphere(ProjectileRadius);
+
+	int32 Traced = 0;
+	while (bTraceInFlight && NextSegment < SegmentStates.Num() && Traced < MaxSegments)
+	{
+		const int32 Segment = NextSegment++;
+		++Traced;
+
+		FHitResult Hit;
+		const bool bHit = World->SweepSingleByChannel(Hit, PathPositions[Segment], PathPositions[Segment + 1], FQuat::Identity, TraceChannel, Shape, QueryParams);
+		MarkSegment(Segment, bHit ? &Hit : nullptr);
+	}
+	INC_DWORD_STAT_BY(STAT_MGNGSceneQueries, Traced);
+}
+
+void UGranadeTrajectoryComponent::SubmitAsyncTraces()
+{
+	UWorld* World = GetWorld();
+	const FCollisionQueryParams QueryParams = MakeQueryParams();
+	const FCollisionShape Shape = FCollisionShape::MakeSphere(ProjectileRadius);
+
+	for (int32 Segment = 0; Segment < SegmentStates.Num(); ++Segment)
+	{
+		const uint32 UserData = (static_cast<uint32>(Generation) << 16) | static_cast<uint32>(Segment);
+		World->AsyncSweepByChannel(EAsyncTraceType::Single, PathPositions[Segment], PathPositions[Segment + 1], FQuat::Identity, TraceChannel, Shape, QueryParams, FCollisionResponseParams::DefaultResponseParam, &AsyncTraceDelegate, UserData);
+	}
+	INC_DWORD_STAT_BY(STAT_MGNGSceneQueries, SegmentStates.Num());
+	NextSegment = SegmentStates.Num();
+}
+
+void UGranadeTrajectoryComponent::OnAsyncTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceData)
+{
+	const uint16 ResultGeneration = static_cast<uint16>(TraceData.UserData >> 16);
+	const int32 Segment = static_cast<int32>(TraceData.UserData & 0xFFFF);
+	if (!bTraceInFlight || ResultGeneration != Generation || !SegmentStates.IsValidIndex(Segment))
+	{
+		return;
+	}
+
+	const FHitResult* Hit = nullptr;
+	for (const FHitResult& OutHit : TraceData.OutHits)
+	{
+		if (OutHit.bBlockingHit)
+		{
+			Hit = &OutHit;
+			break;
+		}
+	}
+	MarkSegment(Segment, Hit);
+}
+
+void UGranadeTrajectoryComponent::MarkSegment(int32 Segment, const FHitResult* Hit)
+{
+	SegmentStates[Segment] = Hit ? ESegmentState::Blocked : ESegmentState::Clear;
+	if (Hit)
+	{
+		SegmentHits[Segment] = *Hit;
+	}
+
+	// The impact is known once every segment before the first blocked one came back clear
+	while (ResolvedPrefix < SegmentStates.Num() && SegmentStates[ResolvedPrefix] == ESegmentState::Clear)
+	{
+		++ResolvedPrefix;
+	}
+
+	if (ResolvedPrefix == SegmentStates.Num())
+	{
+		ResolveImpact(nullptr);
+	}
+	else if (SegmentStates[ResolvedPrefix] == ESegmentState::Blocked)
+	{
+		ResolveImpact(&SegmentHits[ResolvedPrefix]);
+	}
+}
+
+void UGranadeTrajectoryComponent::ResolveImpact(const FHitResult* Hit)
+{
+	if (Hit)
+	{
+		PredictedHit = *Hit;
+	}
+	else
+	{
+		// Nothing blocked the arc, aim at where it ends
+		PredictedHit = FHitResult(CachedStart, PathPositions.Last());
+		PredictedHit.Location = PathPositions.Last();
+		PredictedHit.ImpactPoint = PathPositions.Last();
+		PredictedHit.ImpactNormal = FVector::UpVector;
+	}
+
+	bTraceInFlight = false;
+	bHasPrediction = true;
+	OnImpactPredicted.Broadcast(PredictedHit);
+}
+
+FCollisionQueryParams UGranadeTrajectoryComponent::MakeQueryParams() const
+{
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(GranadeTrajectory), bTraceComplex, GetOwner());
+	return QueryParams;
+}
@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
+#include "GranadeTrajectoryComponent.generated.h"
+
+UENUM(BlueprintType)
+enum class EGranadeTraceMode : uint8
+{
+	// Trace every segment of the arc in the frame it was requested
+	Immediate,
+	// Trace SegmentsPerFrame segments per update until the arc is resolved
+	TimeSliced,
+	// Submit every segment as an async sweep, results arrive on the next frame
+	Async
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnGranadeImpactPredicted, const FHitResult&);
+
+/**
+ * Predicts the grenade arc while the owner is aiming.
+ * The last arc is cached and only re-traced once the aim moves past the thresholds.
+ */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class MGNGDECTECTIVES_API UGranadeTrajectoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGranadeTrajectoryComponent();
+
+	/** Feeds the current aim, re-tracing the arc only if it moved past the thresholds */
+	void UpdatePrediction(const FVector& StartLocation, const FVector& LaunchVelocity);
+
+	/** Drops the cached arc and any trace still in flight */
+	void ResetPrediction();
+
+	FORCEINLINE const FHitResult& GetPredictedHit() const { return PredictedHit; }
+	FORCEINLINE const TArray<FVector>& GetPathPositions() const { return PathPositions; }
+	FORCEINLINE bool HasPrediction() const { return bHasPrediction; }
+
+	/** Fired once the first blocking segment of the arc is known, or with the arc end if nothing was hit */
+	FOnGranadeImpactPredicted OnImpactPredicted;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Trajectory)
+	EGranadeTraceMode TraceMode = EGranadeTraceMode::TimeSliced;
+
+	/** Aim change in degrees that invalidates the cached arc */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Trajectory)
+	float AngleThreshold = 0.5f;
+
+	/** Start location change in cm that invalidates the cached arc */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Trajectory)
+	float LocationThreshold = 5.0f;
+
+	/** Segments traced per update in TimeSliced mode */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Trajectory, meta=(ClampMin="1"))
+	int32 SegmentsPerFrame = 8;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Trajectory)
+	float ProjectileRadius = 20.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Trajectory)
+	float SimFrequency = 15.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Trajectory)
+	float MaxSimTime = 2.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Trajectory)
+	TEnumAsByte<ECollisionChannel> TraceChannel = ECC_WorldDynamic;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Trajectory)
+	bool bTraceComplex = false;
+
+private:
+	bool NeedsRetrace(const FVector& StartLocation, const FVector& LaunchVelocity) const;
+	void BuildPath(const FVector& StartLocation, const FVector& LaunchVelocity);
+	void TraceSegments(int32 MaxSegments);
+	void SubmitAsyncTraces();
+	void OnAsyncTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceData);
+	void MarkSegment(int32 Segment, const FHitResult* Hit);
+	void ResolveImpact(const FHitResult* Hit);
+	FCollisionQueryParams MakeQueryParams() const;
+
+	enum class ESegmentState : uint8
+	{
+		Pending,
+		Clear,
+		Blocked
+	};
+
+	FVector CachedStart;
+	FVector CachedVelocity;
+
+	// Arc points, segment i goes from PathPositions[i] to PathPositions[i + 1]
+	TArray<FVector> PathPositions;
+	TArray<ESegmentState> SegmentStates;
+	TArray<FHitResult> SegmentHits;
+
+	// First segment whose trace has not been issued yet
+	int32 NextSegment = 0;
+	// First segment whose result is not known yet
+	int32 ResolvedPrefix = 0;
+
+	// Bumped on every new arc so late async results from an older arc are dropped
+	uint16 Generation = 0;
+
+	bool bHasPrediction = false;
+	bool bTraceInFlight = false;
+
+	FHitResult PredictedHit;
+	FTraceDelegate AsyncTraceDelegate;
+};
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InventoryComponent.h"
+
+#include "ItemActor.h"
+#include "Net/UnrealNetwork.h"
+
+//////////////////////////////////////////////////////////////////////////
+// FInventoryEntry
+
+void FInventoryEntry::PostReplicatedAdd(const FInventoryList& InArraySerializer)
+{
+	if (InArraySerializer.Owner != nullptr)
+	{
+		InArraySerializer.Owner->HandleEntryReplicated(*this, false);
+	}
+}
+
+void FInventoryEntry::PostReplicatedChange(const FInventoryList& InArraySerializer)
+{
+	if (InArraySerializer.Owner != nullptr)
+	{
+		InArraySerializer.Owner->HandleEntryReplicated(*this, false);
+	}
+}
+
+void FInventoryEntry::PreReplicatedRemove(const FInventoryList& InArraySerializer)
+{
+	if (InArraySerializer.Owner != nullptr)
+	{
+		InArraySerializer.Owner->HandleEntryReplicated(*this, true);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UInventoryComponent
+
+UInventoryComponent::UInventoryComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	bWantsInitializeComponent = true;
+
+	SetIsReplicatedByDefault(true);
+	Items.Owner = this;
+}
+
+void UInventoryComponent::InitializeComponent()
+{
+	Super::InitializeComponent();
+
+	Items.Owner = this;
+}
+
+void UInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// Nobody else needs to know what a detective carries
+	DOREPLIFETIME_CONDITION(UInventoryComponent, Items, COND_OwnerOnly);
+}
+
+bool UInventoryComponent::AddItem(TSubclassOf<AItemActor> ItemClass, uint32 PieceId)
+{
+	if (GetOwnerRole() != ROLE_Authority || !ItemClass)
+	{
+		return false;
+	}
+
+	if (PieceId == 0)
+	{
+		// Anonymous items of the same class share one entry
+		for (FInventoryEntry& Entry : Items.Entries)
+		{
+			if (Entry.PieceId == 0 && Entry.ItemClass == ItemClass && Entry.Count < MAX_uint16)
+			{
+				++Entry.Count;
+				Items.MarkItemDirty(Entry);
+				OnEntryChanged.Broadcast(Entry, false);
+				return true;
+			}
+		}
+	}
+	else if (HasPiece(PieceId))
+	{
+		return false;
+	}
+
+	if (Items.Entries.Num() >= MaxEntries)
+	{
+		return false;
+	}
+
+	FInventoryEntry& Entry = Items.Entries.AddDefaulted_GetRef();
+	Entry.ItemClass = ItemClass;
+	Entry.PieceId = PieceId;
+	Items.MarkItemDirty(Entry);
+	OnEntryChanged.Broadcast(Entry, false);
+	return true;
+}
+
+bool UInventoryComponent::RemoveItem(uint32 PieceId)
+{
+	if (GetOwnerRole() != ROLE_Authority || PieceId == 0)
+	{
+		return false;
+	}
+
+	const int32 Index = Items.Entries.IndexOfByPredicate([PieceId](const FInventoryEntry& Entry) { return Entry.PieceId == PieceId; });
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// Same order as on clients, where PreReplicatedRemove runs while the entry is still there
+	OnEntryChanged.Broadcast(Items.Entries[Index], true);
+	Items.Entries.RemoveAtSwap(Index);
+	Items.MarkArrayDirty();
+	return true;
+}
+
+bool UInventoryComponent::HasPiece(uint32 PieceId) const
+{
+	return Items.Entries.ContainsByPredicate([PieceId](const FInventoryEntry& Entry) { return Entry.PieceId == PieceId; });
+}
+
+int32 UInventoryComponent::GetNumItems() const
+{
+	int32 NumItems = 0;
+	for (const FInventoryEntry& Entry : Items.Entries)
+	{
+		NumItems += Entry.Count;
+	}
+	return NumItems;
+}
+
+void UInventoryComponent::HandleEntryReplicated(const FInventoryEntry& Entry, bool bRemoved)
+{
+	OnEntryChanged.Broadcast(Entry, bRemoved);
+}
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "InventoryComponent.generated.h"
+
+class AItemActor;
+class UInventoryComponent;
+
+/** One carried item, a clue piece keeps the ID of the pickup it came from */
+USTRUCT()
+struct FInventoryEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TSubclassOf<AItemActor> ItemClass;
+
+	UPROPERTY()
+	uint32 PieceId = 0;
+
+	UPROPERTY()
+	uint16 Count = 1;
+
+	void PostReplicatedAdd(const struct FInventoryList& InArraySerializer);
+	void PostReplicatedChange(const struct FInventoryList& InArraySerializer);
+	void PreReplicatedRemove(const struct FInventoryList& InArraySerializer);
+};
+
+/** Items of one inventory, only entries that changed since the last update are sent */
+USTRUCT()
+struct FInventoryList : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FInventoryEntry> Entries;
+
+	/** Set by the owning component on both sides, the callbacks go through it */
+	UInventoryComponent* Owner = nullptr;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInventoryEntry, FInventoryList>(Entries, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventoryList> : public TStructOpsTypeTraitsBase2<FInventoryList>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnInventoryEntryChanged, const FInventoryEntry& /*Entry*/, bool /*bRemoved*/);
+
+/**
+ * Items the owning character carries. The server changes it, the owning client gets only the entries that
+ * were added, changed or removed and is told about each one, without diffing the whole list.
+ */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class MGNGDECTECTIVES_API UInventoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UInventoryComponent();
+
+	/** Adds a piece, or stacks another one of ItemClass when PieceId is 0. Authority only */
+	bool AddItem(TSubclassOf<AItemActor> ItemClass, uint32 PieceId);
+
+	/** Removes the piece with PieceId. Authority only */
+	bool RemoveItem(uint32 PieceId);
+
+	bool HasPiece(uint32 PieceId) const;
+
+	/** Carried items, stacks counted by their size */
+	UFUNCTION(BlueprintCallable, Category=Inventory)
+	int32 GetNumItems() const;
+
+	FORCEINLINE const TArray<FInventoryEntry>& GetEntries() const { return Items.Entries; }
+
+	/** Fired on the server and the owning client for every entry that is added, changed or removed */
+	FOnInventoryEntryChanged OnEntryChanged;
+
+	/** Upper bound on entries, pickups past it are refused */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Inventory)
+	int32 MaxEntries = 64;
+
+	void HandleEntryReplicated(const FInventoryEntry& Entry, bool bRemoved);
+
+protected:
+	virtual void InitializeComponent() override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+private:
+	UPROPERTY(Replicated)
+	FInventoryList Items;
+};
@@ -3,15 +3,26 @@
 
 #include "ItemActor.h"
 
+#include "MGNGDectectives.h"
 #include "MGNGDectectivesCharacter.h"
+#include "PickupInteractionSubsystem.h"
 #include "Components/BoxComponent.h"
+#include "Engine/World.h"
+#include "Misc/Crc.h"
+#include "Net/UnrealNetwork.h"
+
+DECLARE_CYCLE_STAT(TEXT("Item Overlap"), STAT_ItemOverlap, STATGROUP_MGNGDectectives);
 
 // Sets default values
 AItemActor::AItemActor()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// Pickups only react to overlaps, they never need to tick
+	PrimaryActorTick.bCanEverTick = false;
 
+	// Collected state travels through APickupStateReplicator, a piece only wakes up when the pool moves it
+	bReplicates = true;
+	SetReplicateMovement(true);
+	NetDormancy = DORM_Initial;
 
 	CollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("CollisionBox"));
 	SetRootComponent(CollisionBox);
@@ -24,44 +35,69 @@ AItemActor::AItemActor()
 void AItemActor::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	if (PieceId == 0 && IsNetStartupActor())
+	{
+		// Level actors have the same path on every machine once the PIE prefix is gone
+		PieceId = FCrc::StrCrc32(*UWorld::RemovePIEPrefix(GetPathName())) & 0x7FFFFFFF;
+		PieceId = FMath::Max<uint32>(PieceId, 1);
+	}
+
+	if (UPickupInteractionSubsystem* Pickups = GetWorld()->GetSubsystem<UPickupInteractionSubsystem>())
+	{
+		Pickups->RegisterItem(this);
+	}
+}
+
+void AItemActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UPickupInteractionSubsystem* Pickups = GetWorld()->GetSubsystem<UPickupInteractionSubsystem>())
+	{
+		Pickups->ForgetItem(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AItemActor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(AItemActor, PieceId, COND_InitialOnly);
+}
+
+void AItemActor::SetAvailable(bool bNewAvailable)
+{
+	bAvailable = bNewAvailable;
+	SetActorHiddenInGame(!bNewAvailable);
+	SetActorEnableCollision(bNewAvailable);
 }
 
 void AItemActor::OverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
 	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_ItemOverlap);
 
 	AMGNGDectectivesCharacter* Character = Cast<AMGNGDectectivesCharacter>(OtherActor);
+	UPickupInteractionSubsystem* Pickups = GetWorld()->GetSubsystem<UPickupInteractionSubsystem>();
 
-	if(Character != nullptr)
+	if (Character != nullptr && Pickups != nullptr)
 	{
-		Character->canPick = true;
-		Character->itemClass = this;
-		
+		// The subsystem decides which of the overlapped pickups the character points at
+		Pickups->AddCandidate(Character, this);
 	}
-
 }
 
 void AItemActor::OverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
 	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_ItemOverlap);
 
 	AMGNGDectectivesCharacter* Character = Cast<AMGNGDectectivesCharacter>(OtherActor);
-	
+	UPickupInteractionSubsystem* Pickups = GetWorld()->GetSubsystem<UPickupInteractionSubsystem>();
 
-	if(Character != nullptr)
+	if (Character != nullptr && Pickups != nullptr)
 	{
-		Character->canPick = false;
-		Character->itemClass = nullptr;
+		Pickups->RemoveCandidate(Character, this);
 	}
-	
-
-}
-
-// Called every frame
-void AItemActor::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-
 }
-
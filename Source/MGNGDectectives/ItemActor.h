@@ -18,9 +18,23 @@ public:
 	// Sets default values for this actor's properties
 	AItemActor();
 
+	/** Shows or hides the pickup, a hidden one has no collision and can't be picked */
+	void SetAvailable(bool bNewAvailable);
+
+	FORCEINLINE bool IsAvailable() const { return bAvailable; }
+
+	/** Same on the server and every client, 0 until the piece has begun play */
+	FORCEINLINE uint32 GetPieceId() const { return PieceId; }
+
+	/** Server only, for pieces spawned during play */
+	void SetPieceId(uint32 InPieceId) { PieceId = InPieceId; }
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
 	UFUNCTION()
 	void OverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
@@ -29,9 +43,10 @@ protected:
 	UFUNCTION()
 	void OverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
+private:
+	bool bAvailable = true;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
+	/** Level placed pieces derive it from their name, spawned ones get it from the server with their first bunch */
+	UPROPERTY(Replicated)
+	uint32 PieceId = 0;
 };
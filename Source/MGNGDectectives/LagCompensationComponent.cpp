@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationComponent.h"
+
+#include "LagCompensationSubsystem.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+
+ULagCompensationComponent::ULagCompensationComponent()
+{
+	// ULagCompensationSubsystem records every component in one pass
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void ULagCompensationComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GetOwnerRole() != ROLE_Authority)
+	{
+		return;
+	}
+
+	ActiveHitboxes = Hitboxes;
+	if (ActiveHitboxes.Num() == 0)
+	{
+		if (const UCapsuleComponent* Capsule = Cast<UCapsuleComponent>(GetOwner()->GetRootComponent()))
+		{
+			FLagCompHitbox& Hitbox = ActiveHitboxes.AddDefaulted_GetRef();
+			Hitbox.Radius = Capsule->GetScaledCapsuleRadius();
+			Hitbox.HalfHeight = Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere();
+		}
+	}
+
+	ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	if (LagCompensation != nullptr)
+	{
+		// A frame is recorded every server tick; an uncapped listen server is taken as 120 Hz, faster ones rewind
+		// the oldest frame at the far end of the window
+		const float MaxTickRate = GEngine != nullptr ? GEngine->GetMaxTickRate(0.0f, false) : 0.0f;
+		const float RecordRate = MaxTickRate > 0.0f ? MaxTickRate : 120.0f;
+		HistorySize = FMath::Max(HistorySize, FMath::CeilToInt(LagCompensation->GetMaxRewindTime() * RecordRate) + 1);
+	}
+
+	HistorySize = FMath::Max(HistorySize, 2);
+	FrameTimes.SetNumZeroed(HistorySize);
+	FrameBounds.SetNumZeroed(HistorySize);
+	Poses.SetNumUninitialized(HistorySize * ActiveHitboxes.Num());
+	NewestFrame = -1;
+	NumFrames = 0;
+
+	if (LagCompensation != nullptr)
+	{
+		LagCompensation->Register(this);
+	}
+}
+
+void ULagCompensationComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		LagCompensation->Unregister(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+FTransform ULagCompensationComponent::GetHitboxTransform(const FLagCompHitbox& Hitbox, const USkeletalMeshComponent* Mesh) const
+{
+	if (!Hitbox.Bone.IsNone() && Mesh != nullptr)
+	{
+		return Mesh->GetSocketTransform(Hitbox.Bone, RTS_World);
+	}
+	return GetOwner()->GetActorTransform();
+}
+
+void ULagCompensationComponent::RecordFrame(float Time)
+{
+	const int32 NumHitboxes = ActiveHitboxes.Num();
+	if (NumHitboxes == 0)
+	{
+		return;
+	}
+
+	NewestFrame = (NewestFrame + 1) % HistorySize;
+	NumFrames = FMath::Min(NumFrames + 1, HistorySize);
+	FrameTimes[NewestFrame] = Time;
+
+	const ACharacter* Character = Cast<ACharacter>(GetOwner());
+	const USkeletalMeshComponent* Mesh = Character ? Character->GetMesh() : nullptr;
+
+	FBox Bounds(ForceInit);
+	FLagCompPose* FramePoses = Poses.GetData() + NewestFrame * NumHitboxes;
+	for (int32 Index = 0; Index < NumHitboxes; ++Index)
+	{
+		const FLagCompHitbox& Hitbox = ActiveHitboxes[Index];
+		const FTransform Transform = GetHitboxTransform(Hitbox, Mesh);
+		FramePoses[Index].Location = FVector3f(Transform.GetLocation());
+		FramePoses[Index].Rotation = FQuat4f(Transform.GetRotation());
+		Bounds += FBox::BuildAABB(Transform.GetLocation(), FVector(Hitbox.Radius + Hitbox.HalfHeight));
+	}
+
+	FVector Center;
+	FVector Extent;
+	Bounds.GetCenterAndExtents(Center, Extent);
+	FrameBounds[NewestFrame] = FVector4f(FVector3f(Center), Extent.Size());
+}
+
+float ULagCompensationComponent::GetOldestTime() const
+{
+	return NumFrames > 0 ? FrameTimes[FrameIndex(NumFrames - 1)] : 0.0f;
+}
+
+float ULagCompensationComponent::GetNewestTime() const
+{
+	return NumFrames > 0 ? FrameTimes[NewestFrame] : 0.0f;
+}
+
+bool ULagCompensationComponent::TraceAtTime(float Time, const FVector& Start, const FVector& End, FLagCompHit& OutHit) const
+{
+	if (NumFrames == 0)
+	{
+		return false;
+	}
+	Time = FMath::Max(Time, GetOldestTime());
+
+	// Newest frame at or before Time, and the one after it
+	int32 Older = 0;
+	while (Older < NumFrames - 1 && FrameTimes[FrameIndex(Older)] > Time)
+	{
+		++Older;
+	}
+	const int32 OlderIndex = FrameIndex(Older);
+	const int32 NewerIndex = FrameIndex(FMath::Max(Older - 1, 0));
+
+	const float OlderTime = FrameTimes[OlderIndex];
+	const float NewerTime = FrameTimes[NewerIndex];
+	const float Alpha = NewerTime > OlderTime ? FMath::Clamp((Time - OlderTime) / (NewerTime - OlderTime), 0.0f, 1.0f) : 0.0f;
+
+	// Broad phase against the blended bounding sphere
+	const FVector4f& OlderBounds = FrameBounds[OlderIndex];
+	const FVector4f& NewerBounds = FrameBounds[NewerIndex];
+	const FVector BoundsCenter(FMath::Lerp(FVector3f(OlderBounds), FVector3f(NewerBounds), Alpha));
+	const float BoundsRadius = FMath::Max(OlderBounds.W, NewerBounds.W);
+	if (FMath::PointDistToSegmentSquared(BoundsCenter, Start, End) > FMath::Square(BoundsRadius))
+	{
+		return false;
+	}
+
+	const int32 NumHitboxes = ActiveHitboxes.Num();
+	const FLagCompPose* OlderPoses = Poses.GetData() + OlderIndex * NumHitboxes;
+	const FLagCompPose* NewerPoses = Poses.GetData() + NewerIndex * NumHitboxes;
+
+	bool bHit = false;
+	float BestDistance = MAX_flt;
+	for (int32 Index = 0; Index < NumHitboxes; ++Index)
+	{
+		const FLagCompHitbox& Hitbox = ActiveHitboxes[Index];
+		const FVector Location(FMath::Lerp(OlderPoses[Index].Location, NewerPoses[Index].Location, Alpha));
+		const FQuat Rotation(FQuat4f::Slerp(OlderPoses[Index].Rotation, NewerPoses[Index].Rotation, Alpha));
+		const FVector Axis = Rotation.GetAxisZ() * Hitbox.HalfHeight;
+
+		FVector OnShot;
+		FVector OnAxis;
+		FMath::SegmentDistToSegmentSafe(Start, End, Location - Axis, Location + Axis, OnShot, OnAxis);
+		if (FVector::DistSquared(OnShot, OnAxis) > FMath::Square(Hitbox.Radius))
+		{
+			continue;
+		}
+
+		const float Distance = FVector::Dist(Start, OnShot);
+		if (Distance < BestDistance)
+		{
+			bHit = true;
+			BestDistance = Distance;
+			OutHit.Actor = GetOwner();
+			OutHit.HitboxIndex = Index;
+			OutHit.Location = OnShot;
+			OutHit.Distance = Distance;
+			OutHit.DamageScale = Hitbox.DamageScale;
+		}
+	}
+	return bHit;
+}
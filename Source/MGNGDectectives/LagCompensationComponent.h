@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "LagCompensationComponent.generated.h"
+
+/** A capsule following a bone, or the owner's root when Bone is None */
+USTRUCT()
+struct FLagCompHitbox
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere)
+	FName Bone;
+
+	UPROPERTY(EditAnywhere)
+	float Radius = 20.0f;
+
+	/** Half the length of the capsule's straight part along the bone's Z axis, 0 makes it a sphere */
+	UPROPERTY(EditAnywhere)
+	float HalfHeight = 0.0f;
+
+	/** Damage multiplier for hits on this capsule */
+	UPROPERTY(EditAnywhere)
+	float DamageScale = 1.0f;
+};
+
+/** Where one hitbox was at a recorded frame, 28 bytes */
+struct FLagCompPose
+{
+	FVector3f Location;
+	FQuat4f Rotation;
+};
+
+/** What a rewound trace hit */
+struct FLagCompHit
+{
+	class AActor* Actor = nullptr;
+	int32 HitboxIndex = INDEX_NONE;
+	FVector Location = FVector::ZeroVector;
+
+	/** Along the shot, 0 at its start */
+	float Distance = 0.0f;
+	float DamageScale = 1.0f;
+};
+
+/**
+ * Keeps the last HistorySize server frames of the owner's hitboxes in a fixed ring buffer.
+ * All poses live in one flat array, frame after frame, so rewinding a target reads two short contiguous runs.
+ * Recorded by ULagCompensationSubsystem on the server; the live components and the physics scene are never moved.
+ * Hitboxes on bones need the mesh to update its pose on the server, see VisibilityBasedAnimTickOption.
+ */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class MGNGDECTECTIVES_API ULagCompensationComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULagCompensationComponent();
+
+	/** Appends the current hitbox poses at Time, overwriting the oldest frame once the buffer is full */
+	void RecordFrame(float Time);
+
+	/**
+	 * Traces Start to End against the hitboxes as they were at Time, blending the two frames around it.
+	 * Times before the oldest frame use the oldest one. Returns false when nothing was recorded or nothing was hit.
+	 */
+	bool TraceAtTime(float Time, const FVector& Start, const FVector& End, FLagCompHit& OutHit) const;
+
+	FORCEINLINE int32 GetNumFrames() const { return NumFrames; }
+	float GetOldestTime() const;
+	float GetNewestTime() const;
+
+	/** Capsules checked by the trace, the owner's capsule component when empty */
+	UPROPERTY(EditAnywhere, Category=LagCompensation)
+	TArray<FLagCompHitbox> Hitboxes;
+
+	/** Frames kept at least, grown on BeginPlay to cover ULagCompensationSubsystem's MaxRewindTime at the server tick rate */
+	UPROPERTY(EditAnywhere, Category=LagCompensation, meta=(ClampMin="2"))
+	int32 HistorySize = 32;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	/** Index into FrameTimes of the frame recorded N frames ago */
+	FORCEINLINE int32 FrameIndex(int32 FramesAgo) const { return (NewestFrame - FramesAgo + HistorySize) % HistorySize; }
+
+	FTransform GetHitboxTransform(const FLagCompHitbox& Hitbox, const class USkeletalMeshComponent* Mesh) const;
+
+	/** Bone hitboxes, or the one built from the capsule component */
+	TArray<FLagCompHitbox> ActiveHitboxes;
+
+	TArray<float> FrameTimes;
+
+	/** Bounding sphere per frame for the broad phase, XYZ centre and W radius */
+	TArray<FVector4f> FrameBounds;
+
+	/** HistorySize * ActiveHitboxes.Num() poses, frame after frame */
+	TArray<FLagCompPose> Poses;
+
+	int32 NewestFrame = -1;
+	int32 NumFrames = 0;
+};
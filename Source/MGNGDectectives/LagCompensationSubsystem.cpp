@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationSubsystem.h"
+
+#include "MGNGDectectives.h"
+#include "Granade.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Record"), STAT_LagCompRecord, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Validate Shot"), STAT_LagCompValidateShot, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Lag Compensated Shots"), STAT_LagCompShots, STATGROUP_MGNGDectectives);
+
+static FAutoConsoleCommandWithWorldAndArgs LagCompensationBenchmarkCommand(
+	TEXT("mgng.LagComp.Benchmark"),
+	TEXT("Fires rewound shots between random characters on the server and logs the cost per shot. Args: [Shots=10000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (ULagCompensationSubsystem* LagCompensation = World ? World->GetSubsystem<ULagCompensationSubsystem>() : nullptr)
+		{
+			LagCompensation->RunBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000);
+		}
+	})
+);
+
+bool ULagCompensationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId ULagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+void ULagCompensationSubsystem::Deinitialize()
+{
+	Components.Empty();
+
+	Super::Deinitialize();
+}
+
+void ULagCompensationSubsystem::Register(ULagCompensationComponent* Component)
+{
+	Components.AddUnique(Component);
+}
+
+void ULagCompensationSubsystem::Unregister(ULagCompensationComponent* Component)
+{
+	Components.RemoveSwap(Component);
+}
+
+void ULagCompensationSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompRecord);
+
+	// Same clock the clients stamp their shots with
+	const float Now = AGranade::GetSyncedWorldTime(GetWorld());
+	for (ULagCompensationComponent* Component : Components)
+	{
+		Component->RecordFrame(Now);
+	}
+}
+
+bool ULagCompensationSubsystem::ValidateShot(const AActor* Shooter, const FVector& Start, const FVector& Direction, float Range, float ClientTimestamp, FLagCompHit& OutHit)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompValidateShot);
+	INC_DWORD_STAT(STAT_LagCompShots);
+
+	const float Now = AGranade::GetSyncedWorldTime(GetWorld());
+	const float RewindTime = FMath::Clamp(ClientTimestamp, Now - MaxRewindTime, Now);
+	FVector End = Start + Direction.GetSafeNormal() * Range;
+
+	// Walls don't move, so the current scene is the right one for them
+	FHitResult WorldHit;
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(LagCompensatedShot), false, Shooter);
+	INC_DWORD_STAT(STAT_MGNGSceneQueries);
+	if (GetWorld()->LineTraceSingleByObjectType(WorldHit, Start, End, FCollisionObjectQueryParams(ECC_WorldStatic), QueryParams))
+	{
+		End = WorldHit.Location;
+	}
+
+	bool bHit = false;
+	FLagCompHit Candidate;
+	for (const ULagCompensationComponent* Component : Components)
+	{
+		if (Component->GetOwner() == Shooter)
+		{
+			continue;
+		}
+		if (Component->TraceAtTime(RewindTime, Start, End, Candidate) && (!bHit || Candidate.Distance < OutHit.Distance))
+		{
+			OutHit = Candidate;
+			bHit = true;
+		}
+	}
+	return bHit;
+}
+
+void ULagCompensationSubsystem::RunBenchmark(int32 NumShots)
+{
+	if (Components.Num() < 2 || NumShots <= 0)
+	{
+		UE_LOG(LogMGNGDectectives, Display, TEXT("Lag compensation benchmark needs at least two characters on the server, %d registered"), Components.Num());
+		return;
+	}
+
+	FRandomStream Random(0x4C414743);
+	int32 NumHits = 0;
+	FLagCompHit Hit;
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Shot = 0; Shot < NumShots; ++Shot)
+	{
+		const ULagCompensationComponent* Shooter = Components[Random.RandHelper(Components.Num())];
+		const ULagCompensationComponent* Target = Components[Random.RandHelper(Components.Num())];
+		const float Time = FMath::Lerp(Target->GetOldestTime(), Target->GetNewestTime(), Random.FRand());
+
+		const FVector Start = Shooter->GetOwner()->GetActorLocation() + FVector(0.0f, 0.0f, 60.0f);
+		const FVector Aim = Target->GetOwner()->GetActorLocation() + Random.VRand() * 50.0f - Start;
+		if (ValidateShot(Shooter->GetOwner(), Start, Aim, 10000.0f, Time, Hit))
+		{
+			++NumHits;
+		}
+	}
+	const double TotalMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	UE_LOG(LogMGNGDectectives, Display, TEXT("Lag compensation: %d shots against %d characters in %.2f ms, %.2f us per shot, %d hits"),
+		NumShots, Components.Num(), TotalMs, TotalMs * 1000.0 / NumShots, NumHits);
+}
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LagCompensationComponent.h"
+#include "LagCompensationSubsystem.generated.h"
+
+/**
+ * Records every ULagCompensationComponent once per server frame and validates shots against the past.
+ * A shot is traced against world geometry as it is now, then against each target's hitboxes as they were
+ * at the shooter's timestamp. Nothing is moved to do that, so there is nothing to restore afterwards.
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API ULagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override { return Components.Num() > 0; }
+
+	void Register(ULagCompensationComponent* Component);
+	void Unregister(ULagCompensationComponent* Component);
+
+	/**
+	 * Traces Start along Direction for Range as the shooter saw the world at ClientTimestamp.
+	 * Timestamps older than MaxRewindTime are clamped, so a laggy client can't reach further into the past.
+	 */
+	bool ValidateShot(const AActor* Shooter, const FVector& Start, const FVector& Direction, float Range, float ClientTimestamp, FLagCompHit& OutHit);
+
+	FORCEINLINE int32 GetNumComponents() const { return Components.Num(); }
+	FORCEINLINE float GetMaxRewindTime() const { return MaxRewindTime; }
+
+	/** Times NumShots rewound shots between random registered characters and logs the cost per shot */
+	void RunBenchmark(int32 NumShots);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Furthest a shot is rewound, in seconds */
+	UPROPERTY(Config)
+	float MaxRewindTime = 0.5f;
+
+private:
+	UPROPERTY()
+	TArray<ULagCompensationComponent*> Components;
+};
@@ -0,0 +1,302 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MGNGCharacterMovementComponent.h"
+
+#include "MGNGDectectives.h"
+#include "MGNGReplicationGraph.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Moves Sent Packed"), STAT_MGNGMovesPacked, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Moves Sent Unpacked"), STAT_MGNGMovesUnpacked, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Characters Net Idle"), STAT_MGNGCharactersNetIdle, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Characters Net Ragdoll"), STAT_MGNGCharactersNetRagdoll, STATGROUP_MGNGDectectives);
+
+static TAutoConsoleVariable<int32> CVarCompactMoves(
+	TEXT("mgng.Movement.CompactMoves"),
+	1,
+	TEXT("0 sends client moves with the stock acceleration precision, 1 packs level acceleration into 3 bytes. Client side."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<int32> CVarAdaptiveNetRate(
+	TEXT("mgng.Movement.AdaptiveNetRate"),
+	1,
+	TEXT("0 replicates every character at its full net update rate, 1 lowers it for idle characters. Server side, ragdolls always drop."),
+	ECVF_Default
+);
+
+//////////////////////////////////////////////////////////////////////////
+// FMGNGCharacterNetworkMoveData
+
+bool FMGNGCharacterNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType)
+{
+	NetworkMoveType = MoveType;
+	bool bLocalSuccess = true;
+	const bool bIsSaving = Ar.IsSaving();
+
+	Ar << TimeStamp;
+
+	// RoundAcceleration already put it on the grid, anything that doesn't come back exactly goes out the stock way
+	const float MaxAcceleration = CharacterMovement.GetMaxAcceleration();
+	uint16 Heading = 0;
+	uint8 Magnitude = 0;
+	uint8 bPacked = bIsSaving
+		&& UMGNGCharacterMovementComponent::PackAcceleration(Acceleration, MaxAcceleration, Heading, Magnitude)
+		&& UMGNGCharacterMovementComponent::UnpackAcceleration(Heading, Magnitude, MaxAcceleration) == Acceleration;
+	Ar.SerializeBits(&bPacked, 1);
+
+	if (bPacked)
+	{
+		Ar << Magnitude;
+		if (Magnitude != 0)
+		{
+			Ar << Heading;
+		}
+		if (!bIsSaving)
+		{
+			Acceleration = UMGNGCharacterMovementComponent::UnpackAcceleration(Heading, Magnitude, MaxAcceleration);
+		}
+	}
+	else
+	{
+		Acceleration.NetSerialize(Ar, PackageMap, bLocalSuccess);
+	}
+
+	if (bIsSaving)
+	{
+		if (bPacked)
+		{
+			INC_DWORD_STAT(STAT_MGNGMovesPacked);
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_MGNGMovesUnpacked);
+		}
+	}
+
+	ControlRotation.NetSerialize(Ar, PackageMap, bLocalSuccess);
+
+	SerializeOptionalValue<uint8>(bIsSaving, Ar, CompressedMoveFlags, 0);
+
+	if (MoveType == ENetworkMoveType::NewMove)
+	{
+		// The server only checks the newest move's location, a tenth of a centimetre is well inside its tolerance
+		FVector_NetQuantize10 PackedLocation(Location);
+		PackedLocation.NetSerialize(Ar, PackageMap, bLocalSuccess);
+		Location = PackedLocation;
+
+		SerializeOptionalValue<UPrimitiveComponent*>(bIsSaving, Ar, MovementBase, nullptr);
+		SerializeOptionalValue<FName>(bIsSaving, Ar, MovementBaseBoneName, NAME_None);
+		SerializeOptionalValue<uint8>(bIsSaving, Ar, MovementMode, MOVE_Walking);
+	}
+
+	return !Ar.IsError();
+}
+
+FMGNGCharacterNetworkMoveDataContainer::FMGNGCharacterNetworkMoveDataContainer()
+{
+	NewMoveData = &MoveData[0];
+	PendingMoveData = &MoveData[1];
+	OldMoveData = &MoveData[2];
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FMGNGNetworkPredictionData_Client
+
+FMGNGNetworkPredictionData_Client::FMGNGNetworkPredictionData_Client(const UMGNGCharacterMovementComponent& ClientMovement)
+	: FNetworkPredictionData_Client_Character(ClientMovement)
+	, AccelDotThresholdCombine(ClientMovement.MoveCombineAccelDot)
+	, MaxSpeedThresholdCombine(ClientMovement.MoveCombineMaxSpeedDelta)
+{
+}
+
+FSavedMovePtr FMGNGNetworkPredictionData_Client::AllocateNewMove()
+{
+	FSavedMovePtr Move = FNetworkPredictionData_Client_Character::AllocateNewMove();
+	Move->AccelDotThresholdCombine = AccelDotThresholdCombine;
+	Move->MaxSpeedThresholdCombine = MaxSpeedThresholdCombine;
+	return Move;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UMGNGCharacterMovementComponent
+
+UMGNGCharacterMovementComponent::UMGNGCharacterMovementComponent()
+{
+	SetNetworkMoveDataContainer(MoveDataContainer);
+}
+
+void UMGNGCharacterMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ActiveNetUpdateFrequency = CharacterOwner ? CharacterOwner->NetUpdateFrequency : 0.0f;
+}
+
+void UMGNGCharacterMovementComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (NetActivity == EMovementNetActivity::Idle)
+	{
+		DEC_DWORD_STAT(STAT_MGNGCharactersNetIdle);
+	}
+	else if (NetActivity == EMovementNetActivity::Ragdoll)
+	{
+		DEC_DWORD_STAT(STAT_MGNGCharactersNetRagdoll);
+	}
+	NetActivity = EMovementNetActivity::Moving;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UMGNGCharacterMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (CharacterOwner != nullptr && CharacterOwner->HasAuthority() && GetNetMode() != NM_Standalone)
+	{
+		UpdateNetActivity(DeltaTime);
+	}
+}
+
+FNetworkPredictionData_Client* UMGNGCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		UMGNGCharacterMovementComponent* MutableThis = const_cast<UMGNGCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FMGNGNetworkPredictionData_Client(*this);
+	}
+	return ClientPredictionData;
+}
+
+FVector UMGNGCharacterMovementComponent::RoundAcceleration(FVector InAccel) const
+{
+	// The client predicts with exactly what the server unpacks
+	const float MaxAcceleration = GetMaxAcceleration();
+	uint16 Heading = 0;
+	uint8 Magnitude = 0;
+	if (CVarCompactMoves.GetValueOnGameThread() != 0 && PackAcceleration(InAccel, MaxAcceleration, Heading, Magnitude))
+	{
+		return UnpackAcceleration(Heading, Magnitude, MaxAcceleration);
+	}
+	return Super::RoundAcceleration(InAccel);
+}
+
+bool UMGNGCharacterMovementComponent::PackAcceleration(const FVector& Acceleration, float MaxAcceleration, uint16& OutHeading, uint8& OutMagnitude)
+{
+	if (Acceleration.Z != 0.0 || MaxAcceleration <= 0.0f)
+	{
+		return false;
+	}
+
+	OutMagnitude = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Acceleration.Size2D() / MaxAcceleration * 255.0), 0, 255));
+	OutHeading = OutMagnitude != 0 ? FRotator::CompressAxisToShort(FMath::RadiansToDegrees(FMath::Atan2(Acceleration.Y, Acceleration.X))) : 0;
+	return true;
+}
+
+FVector UMGNGCharacterMovementComponent::UnpackAcceleration(uint16 Heading, uint8 Magnitude, float MaxAcceleration)
+{
+	if (Magnitude == 0)
+	{
+		return FVector::ZeroVector;
+	}
+
+	double Sin = 0.0;
+	double Cos = 0.0;
+	FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(FRotator::DecompressAxisFromShort(Heading)));
+	const double Size = Magnitude * static_cast<double>(MaxAcceleration) / 255.0;
+	return FVector(Cos * Size, Sin * Size, 0.0);
+}
+
+void UMGNGCharacterMovementComponent::SetRagdoll()
+{
+	if (CharacterOwner != nullptr && CharacterOwner->HasAuthority())
+	{
+		SetNetActivity(EMovementNetActivity::Ragdoll);
+	}
+}
+
+void UMGNGCharacterMovementComponent::MarkNetActive()
+{
+	if (CharacterOwner != nullptr && CharacterOwner->HasAuthority() && GetNetMode() != NM_Standalone && NetActivity != EMovementNetActivity::Ragdoll)
+	{
+		StillTime = 0.0f;
+		SetNetActivity(EMovementNetActivity::Moving);
+	}
+}
+
+void UMGNGCharacterMovementComponent::UpdateNetActivity(float DeltaTime)
+{
+	if (NetActivity == EMovementNetActivity::Ragdoll)
+	{
+		return;
+	}
+
+	// Compared with the last rotation that counted, so a slow turn still adds up to activity
+	const FRotator ViewRotation = CharacterOwner->GetControlRotation();
+	const bool bTurned = !ViewRotation.Equals(LastViewRotation, IdleViewAngle);
+	if (bTurned)
+	{
+		LastViewRotation = ViewRotation;
+	}
+
+	// Acceleration is whatever the last client move asked for, Velocity where it left the capsule
+	const bool bStill = !bTurned && GetCurrentAcceleration().IsZero() && !IsFalling() && Velocity.SizeSquared() <= FMath::Square(IdleSpeed);
+	StillTime = bStill ? StillTime + DeltaTime : 0.0f;
+
+	const bool bIdle = CVarAdaptiveNetRate.GetValueOnGameThread() != 0 && IdleNetUpdateFrequency > 0.0f && StillTime >= IdleDelay;
+	SetNetActivity(bIdle ? EMovementNetActivity::Idle : EMovementNetActivity::Moving);
+}
+
+void UMGNGCharacterMovementComponent::SetNetActivity(EMovementNetActivity InNetActivity)
+{
+	if (InNetActivity == NetActivity || CharacterOwner == nullptr)
+	{
+		return;
+	}
+
+	if (NetActivity == EMovementNetActivity::Idle)
+	{
+		DEC_DWORD_STAT(STAT_MGNGCharactersNetIdle);
+	}
+	NetActivity = InNetActivity;
+
+	switch (NetActivity)
+	{
+	case EMovementNetActivity::Idle:
+		INC_DWORD_STAT(STAT_MGNGCharactersNetIdle);
+		ApplyNetUpdateFrequency(IdleNetUpdateFrequency);
+		break;
+	case EMovementNetActivity::Ragdoll:
+		INC_DWORD_STAT(STAT_MGNGCharactersNetRagdoll);
+		ApplyNetUpdateFrequency(RagdollNetUpdateFrequency);
+		// The lower rate would otherwise hold back the ragdoll starting
+		CharacterOwner->ForceNetUpdate();
+		break;
+	default:
+		ApplyNetUpdateFrequency(ActiveNetUpdateFrequency);
+		// Don't wait out the idle period, the first step should reach everyone right away
+		CharacterOwner->ForceNetUpdate();
+		break;
+	}
+}
+
+void UMGNGCharacterMovementComponent::ApplyNetUpdateFrequency(float Frequency)
+{
+	if (Frequency <= 0.0f)
+	{
+		return;
+	}
+
+	CharacterOwner->NetUpdateFrequency = Frequency;
+
+	// The replication graph took its own copy of the class rate when the actor was added
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (UMGNGReplicationGraph* Graph = NetDriver ? Cast<UMGNGReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr)
+	{
+		Graph->SetActorNetUpdateFrequency(CharacterOwner, Frequency);
+	}
+}
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "MGNGCharacterMovementComponent.generated.h"
+
+/**
+ * Move sent to the server. Level acceleration, all this game has on foot and in the air, goes out as a heading and a
+ * fraction of MaxAcceleration in 3 bytes instead of a packed vector, and only the newest move carries the client
+ * location the server checks against.
+ */
+struct FMGNGCharacterNetworkMoveData : public FCharacterNetworkMoveData
+{
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
+};
+
+struct FMGNGCharacterNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
+{
+	FMGNGCharacterNetworkMoveDataContainer();
+
+	FMGNGCharacterNetworkMoveData MoveData[3];
+};
+
+/** Hands out saved moves with the component's combine thresholds */
+class FMGNGNetworkPredictionData_Client : public FNetworkPredictionData_Client_Character
+{
+public:
+	FMGNGNetworkPredictionData_Client(const class UMGNGCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+
+private:
+	float AccelDotThresholdCombine;
+	float MaxSpeedThresholdCombine;
+};
+
+/** What a character is doing as far as its replication rate goes */
+enum class EMovementNetActivity : uint8
+{
+	Moving,
+	Idle,
+	Ragdoll
+};
+
+/**
+ * Character movement of AMGNGDectectivesCharacter. Client moves are quantized the same way on both ends,
+ * so the client predicts with what the server will receive, and similar moves are merged before they are sent.
+ *
+ * The server lowers the owner's net update rate while it stands still without turning and once it is a ragdoll,
+ * whose root bone RagdollState replicates at its own pace, and goes back to the full rate the frame it starts moving,
+ * turns or calls MarkNetActive again.
+ * mgng.Movement.CompactMoves and mgng.Movement.AdaptiveNetRate turn either half off to compare net stats.
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API UMGNGCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UMGNGCharacterMovementComponent();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual FVector RoundAcceleration(FVector InAccel) const override;
+
+	/** Drops the owner to RagdollNetUpdateFrequency for good, movement stops ticking once it is a ragdoll */
+	void SetRagdoll();
+
+	/** Server only, back to the full rate for at least IdleDelay, for what changes the owner without moving it */
+	void MarkNetActive();
+
+	FORCEINLINE EMovementNetActivity GetNetActivity() const { return NetActivity; }
+
+	/** Heading and fraction of MaxAcceleration of a level acceleration, false if it isn't level */
+	static bool PackAcceleration(const FVector& Acceleration, float MaxAcceleration, uint16& OutHeading, uint8& OutMagnitude);
+	static FVector UnpackAcceleration(uint16 Heading, uint8 Magnitude, float MaxAcceleration);
+
+	/** Saved moves whose accelerations are at least this aligned are merged, stock moves use 0.996 */
+	UPROPERTY(Config, EditAnywhere, Category="Character Movement (Networking)")
+	float MoveCombineAccelDot = 0.98f;
+
+	/** Saved moves whose max speeds differ by less than this are merged */
+	UPROPERTY(Config, EditAnywhere, Category="Character Movement (Networking)")
+	float MoveCombineMaxSpeedDelta = 20.0f;
+
+	/** Update rate while standing still, 0 keeps the owner's own */
+	UPROPERTY(Config, EditAnywhere, Category="Character Movement (Networking)")
+	float IdleNetUpdateFrequency = 5.0f;
+
+	/** Update rate once ragdolled, should not go below RagdollState's SnapshotRate */
+	UPROPERTY(Config, EditAnywhere, Category="Character Movement (Networking)")
+	float RagdollNetUpdateFrequency = 10.0f;
+
+	/** Speed under which the owner counts as standing still */
+	UPROPERTY(Config, EditAnywhere, Category="Character Movement (Networking)")
+	float IdleSpeed = 10.0f;
+
+	/** Degrees the view has to turn to count as activity, other clients see the aim through RemoteViewPitch */
+	UPROPERTY(Config, EditAnywhere, Category="Character Movement (Networking)")
+	float IdleViewAngle = 1.0f;
+
+	/** Seconds without acceleration under IdleSpeed before the rate drops */
+	UPROPERTY(Config, EditAnywhere, Category="Character Movement (Networking)")
+	float IdleDelay = 0.5f;
+
+private:
+	void UpdateNetActivity(float DeltaTime);
+	void SetNetActivity(EMovementNetActivity InNetActivity);
+	void ApplyNetUpdateFrequency(float Frequency);
+
+	FMGNGCharacterNetworkMoveDataContainer MoveDataContainer;
+
+	/** The owner's own rate, used while it moves */
+	float ActiveNetUpdateFrequency = 0.0f;
+	float StillTime = 0.0f;
+	FRotator LastViewRotation = FRotator::ZeroRotator;
+	EMovementNetActivity NetActivity = EMovementNetActivity::Moving;
+};
@@ -1,7 +1,37 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "MGNGDectectives.h"
+#include "FixedStepSimulation.h"
+#include "GameplayEventRecorder.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, MGNGDectectives, "MGNGDectectives" );
- 
\ No newline at end of file
+DEFINE_LOG_CATEGORY(LogMGNGDectectives);
+
+DEFINE_STAT(STAT_MGNGActorSpawns);
+DEFINE_STAT(STAT_MGNGSceneQueries);
+DEFINE_STAT(STAT_MGNGDamageEvents);
+
+LLM_DEFINE_TAG(MGNG);
+LLM_DEFINE_TAG(MGNG_Granades, NAME_None, TEXT("MGNG"));
+LLM_DEFINE_TAG(MGNG_Projectiles, NAME_None, TEXT("MGNG"));
+LLM_DEFINE_TAG(MGNG_Pickups, NAME_None, TEXT("MGNG"));
+LLM_DEFINE_TAG(MGNG_Sessions, NAME_None, TEXT("MGNG"));
+LLM_DEFINE_TAG(MGNG_Ragdolls, NAME_None, TEXT("MGNG"));
+LLM_DEFINE_TAG(MGNG_Effects, NAME_None, TEXT("MGNG"));
+
+class FMGNGDectectivesModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		FGameplayEventRecorder::Startup();
+		FFixedStepSimulation::Startup();
+	}
+
+	virtual void ShutdownModule() override
+	{
+		FGameplayEventRecorder::Shutdown();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FMGNGDectectivesModule, MGNGDectectives, "MGNGDectectives" );
@@ -3,3 +3,36 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogMGNGDectectives, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("MGNGDectectives"), STATGROUP_MGNGDectectives, STATCAT_Advanced);
+
+// Low-Level Memory tracker tags, shown as MGNG/<Feature> by "stat LLMFULL" and in -llmcsv captures when run with -llm
+LLM_DECLARE_TAG_API(MGNG, MGNGDECTECTIVES_API);
+LLM_DECLARE_TAG_API(MGNG_Granades, MGNGDECTECTIVES_API);
+LLM_DECLARE_TAG_API(MGNG_Projectiles, MGNGDECTECTIVES_API);
+LLM_DECLARE_TAG_API(MGNG_Pickups, MGNGDECTECTIVES_API);
+LLM_DECLARE_TAG_API(MGNG_Sessions, MGNGDECTECTIVES_API);
+LLM_DECLARE_TAG_API(MGNG_Ragdolls, MGNGDECTECTIVES_API);
+LLM_DECLARE_TAG_API(MGNG_Effects, MGNGDECTECTIVES_API);
+
+// Per frame counters shared by every gameplay system, shown by "stat MGNGDectectives"
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Gameplay Actor Spawns"), STAT_MGNGActorSpawns, STATGROUP_MGNGDectectives, MGNGDECTECTIVES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Gameplay Scene Queries"), STAT_MGNGSceneQueries, STATGROUP_MGNGDectectives, MGNGDECTECTIVES_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Gameplay Damage Events"), STAT_MGNGDamageEvents, STATGROUP_MGNGDectectives, MGNGDECTECTIVES_API);
+
+/**
+ * Scoped cycle counter for gameplay hot paths. With stats it shows up under "stat MGNGDectectives" and,
+ * as every cycle stat, as a CPU timing event in Unreal Insights; without stats (Test) it is a plain
+ * trace scope, so headless captures with -trace=cpu,stats still see it. Compiled out in Shipping.
+ */
+#if UE_BUILD_SHIPPING
+	#define MGNG_SCOPE_CYCLE_COUNTER(Stat)
+#elif STATS
+	#define MGNG_SCOPE_CYCLE_COUNTER(Stat) SCOPE_CYCLE_COUNTER(Stat)
+#else
+	#define MGNG_SCOPE_CYCLE_COUNTER(Stat) TRACE_CPUPROFILER_EVENT_SCOPE(Stat)
+#endif
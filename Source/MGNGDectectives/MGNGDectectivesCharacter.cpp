@@ -1,5 +1,6 @@
 #include "MGNGDectectivesCharacter.h"
 #include "Camera/CameraComponent.h"
+#include "CharacterSignificanceSubsystem.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
@@ -7,23 +8,41 @@
 #include "GameFramework/SpringArmComponent.h"
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
+#include "GameplayEventRecorder.h"
+#include "InventoryComponent.h"
 #include "ItemActor.h"
+#include "LagCompensationSubsystem.h"
+#include "MGNGCharacterMovementComponent.h"
+#include "MGNGDectectives.h"
+#include "MatchSessionSubsystem.h"
+#include "Granade.h"
+#include "GranadePoolSubsystem.h"
+#include "GranadeTrajectoryComponent.h"
+#include "PickupInteractionSubsystem.h"
+#include "ProjectileManagerSubsystem.h"
+#include "RagdollStateComponent.h"
 #include "Components/ArrowComponent.h"
 #include "Engine/DamageEvents.h"
+#include "GameFramework/DamageType.h"
 #include "Kismet/GameplayStatics.h"
-#include "EnhancedInputSubsystems.h"
-#include "OnlineSubsystem.h"
-#include "OnlineSessionSettings.h"
+#include "Engine/GameInstance.h"
+
 
+DECLARE_CYCLE_STAT(TEXT("Character Construct"), STAT_CharacterConstruct, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Character Tick"), STAT_CharacterTick, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Character Trajectory Prediction"), STAT_CharacterTrajectoryPrediction, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Character Throw Cooldown"), STAT_CharacterThrowCooldown, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Character TakeDamage"), STAT_CharacterTakeDamage, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Character PickUp"), STAT_CharacterPickUp, STATGROUP_MGNGDectectives);
 
 //////////////////////////////////////////////////////////////////////////
 // AMGNGDectectivesCharacter
 
-AMGNGDectectivesCharacter::AMGNGDectectivesCharacter() :
-	CreateSessionCompleteDelegate(FOnCreateSessionCompleteDelegate::CreateUObject(this, &ThisClass::OnCreateSessionComplete)),
-	FindSessionsCompleteDelegate(FOnFindSessionsCompleteDelegate::CreateUObject(this, &ThisClass::OnFindSessionComplete)),
-	JoinSessionCompleteDelegate(FOnJoinSessionCompleteDelegate::CreateUObject(this, &ThisClass::OnJoinSessionComplete))
+AMGNGDectectivesCharacter::AMGNGDectectivesCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UMGNGCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
+	SCOPE_CYCLE_COUNTER(STAT_CharacterConstruct);
+
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
 		
@@ -61,32 +80,33 @@ AMGNGDectectivesCharacter::AMGNGDectectivesCharacter() :
 	
 	ArrowDirection = CreateDefaultSubobject<UArrowComponent>(TEXT("ArrowDirection"));
 	ArrowDirection->SetupAttachment(RootComponent);
+
+	GranadeTrajectory = CreateDefaultSubobject<UGranadeTrajectoryComponent>(TEXT("GranadeTrajectory"));
+
+	RagdollState = CreateDefaultSubobject<URagdollStateComponent>(TEXT("RagdollState"));
+
+	Inventory = CreateDefaultSubobject<UInventoryComponent>(TEXT("Inventory"));
+
+	LagCompensation = CreateDefaultSubobject<ULagCompensationComponent>(TEXT("LagCompensation"));
 	
 	isRagdoll = false;
 	LanzadoGranada = false;
 	StartCount = false;
 
-	counter = 0;
-
-	IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get();
-	if(OnlineSubsystem)
-	{
-		OnlineSessionInterface = OnlineSubsystem->GetSessionInterface();
-
-		if(GEngine)
-		{
-			GEngine->AddOnScreenDebugMessage(
-				-1,
-				10.f,
-				FColor::Purple,
-				FString::Printf(TEXT("Found Subsystem: %s"), *OnlineSubsystem->GetSubsystemName().ToString())
-			);
-		}
-	}
+	CountStartTime = 0.0;
 	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	// are set in the derived blueprint asset named ThirdPersonCharacter (to avoid direct content references in C++)
 }
 
+void AMGNGDectectivesCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// A late joiner gets the ragdoll and the inventory from the initial bunch, whose OnReps run before BeginPlay
+	RagdollState->OnRagdollStarted.AddUObject(this, &ThisClass::OnRagdollStarted);
+	Inventory->OnEntryChanged.AddUObject(this, &ThisClass::OnInventoryEntryChanged);
+}
+
 void AMGNGDectectivesCharacter::BeginPlay()
 {
 	// Call the base class  
@@ -100,239 +120,113 @@ void AMGNGDectectivesCharacter::BeginPlay()
 			Subsystem->AddMappingContext(DefaultMappingContext, 0);
 		}
 	}
-}
 
-void AMGNGDectectivesCharacter::CreateGameSession()
-{
-	if (!OnlineSessionInterface.IsValid())
+	if (IsNetMode(NM_DedicatedServer))
 	{
-		return;
+		// Nobody looks through this pawn on a dedicated server, skip the camera and aiming work
+		CameraBoom->SetComponentTickEnabled(false);
+		FollowCamera->Deactivate();
+		DecalComponent->SetVisibility(false);
+		DecalComponent->SetComponentTickEnabled(false);
 	}
-
-	auto ExistingSession = OnlineSessionInterface->GetNamedSession(NAME_GameSession);
-	if (ExistingSession != nullptr)
+	else
 	{
-		OnlineSessionInterface->DestroySession(NAME_GameSession);
+		GranadeTrajectory->OnImpactPredicted.AddUObject(this, &ThisClass::OnGranadeImpactPredicted);
 	}
 
-	//Add the Dalegate on DelegateList
-	OnlineSessionInterface->AddOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegate);
-
-	//Create Session
-	TSharedPtr<FOnlineSessionSettings> SessionSettings = MakeShareable(new FOnlineSessionSettings());
-	
-	SessionSettings->bIsLANMatch = false;
-	SessionSettings->NumPublicConnections = 4;
-	SessionSettings->bAllowJoinInProgress = true;
-	SessionSettings->bAllowJoinViaPresence = true;
-	SessionSettings->bShouldAdvertise = true;
-	SessionSettings->bUsesPresence = true;
-	SessionSettings->bUseLobbiesIfAvailable = true;
-	SessionSettings->Set(FName("MatchType"), FString("FreeForAll"), EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
-
-	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	OnlineSessionInterface->CreateSession(*LocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, *SessionSettings);
-}
-
-void AMGNGDectectivesCharacter::JoinGameSession()
-{
-	if(!OnlineSessionInterface)
+	// Make sure the pool holds enough of this character's grenade class before the first throw
+	if (UGranadePoolSubsystem* Pool = GetWorld()->GetSubsystem<UGranadePoolSubsystem>())
 	{
-		return;
+		Pool->Prewarm(Granada, Pool->GetPrewarmCount());
 	}
 
-	OnlineSessionInterface->AddOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate);
-
-	SessionSearch = MakeShareable(new FOnlineSessionSearch());
-	SessionSearch->MaxSearchResults = 10000;
-	SessionSearch->bIsLanQuery = false;
-	SessionSearch->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
-
-	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	OnlineSessionInterface->FindSessions(*LocalPlayer->GetPreferredUniqueNetId(), SessionSearch.ToSharedRef());
-}
-
-void AMGNGDectectivesCharacter::OnCreateSessionComplete(FName SessionName, bool bWasSuccess)
-{
-	if (bWasSuccess)
+	if (UCharacterSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UCharacterSignificanceSubsystem>())
 	{
-		if (GEngine)
-		{
-			GEngine->AddOnScreenDebugMessage(
-				-1,
-				15.f,
-				FColor::Blue,
-				FString::Printf(TEXT("Created Session %s"),*SessionName.ToString())
-			);
-		}
-
-		UWorld* World = GetWorld();
-		if(World)
-		{
-			World->ServerTravel(FString("/Game/ThirdPerson/Maps/BattleMap_Lobby?listen"));
-		}
-	}
-	else
-	{
-		GEngine->AddOnScreenDebugMessage(
-			-1,
-			15.f,
-			FColor::Blue,
-			FString::Printf(TEXT("Created Session Failed"))
-		);
+		Significance->Register(this);
 	}
 }
 
-void AMGNGDectectivesCharacter::OnFindSessionComplete(bool bWasSuccessful)
+void AMGNGDectectivesCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	if (!OnlineSessionInterface)
+	if (UCharacterSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UCharacterSignificanceSubsystem>())
 	{
-		return;
+		Significance->Unregister(this);
 	}
 
-	
-	for(auto Result : SessionSearch->SearchResults)
-	{
-		FString Id = Result.GetSessionIdStr();
-		FString User = Result.Session.OwningUserName;
-
-		FString MatchType;
-		Result.Session.SessionSettings.Get(FName("MatchType"), MatchType);
-
-		//Debug
-		if (GEngine)
-		{
-			GEngine->AddOnScreenDebugMessage(
-				-1,
-				15.f,
-				FColor::Orange,
-				FString::Printf(TEXT("Id: %s, User: %s"), *Id, *User)
-			);
-		}
+	Super::EndPlay(EndPlayReason);
+}
 
-		if(MatchType == FString("FreeForAll"))
-		{
-			if (GEngine)
-			{
-				GEngine->AddOnScreenDebugMessage(
-					-1,
-					15.f,
-					FColor::Orange,
-					FString::Printf(TEXT("Joining MatchType %s"), *MatchType)
-				);
-			}
-
-			OnlineSessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
-
-			const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-			OnlineSessionInterface->JoinSession(*LocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, Result);
-		}
-	}
+UMatchSessionSubsystem* AMGNGDectectivesCharacter::GetSessionSubsystem() const
+{
+	UGameInstance* GameInstance = GetGameInstance();
+	return GameInstance ? GameInstance->GetSubsystem<UMatchSessionSubsystem>() : nullptr;
 }
 
-void AMGNGDectectivesCharacter::OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
+void AMGNGDectectivesCharacter::CreateGameSession()
 {
-	if (!OnlineSessionInterface.IsValid())
+	if (UMatchSessionSubsystem* Sessions = GetSessionSubsystem())
 	{
-		return;
+		Sessions->CreateGameSession();
 	}
+}
 
-	FString Address;
-
-	if(OnlineSessionInterface->GetResolvedConnectString(NAME_GameSession, Address))
+void AMGNGDectectivesCharacter::JoinGameSession()
+{
+	if (UMatchSessionSubsystem* Sessions = GetSessionSubsystem())
 	{
-		if (GEngine)
-		{
-			GEngine->AddOnScreenDebugMessage(
-				-1,
-				15.f,
-				FColor::Cyan,
-				FString::Printf(TEXT("Connect to: %s"), *Address)
-			);
-			
-		}
-
-		APlayerController* PlayerController = GetGameInstance()->GetFirstLocalPlayerController();
-		if(PlayerController)
-		{
-			PlayerController->ClientTravel(Address, TRAVEL_Absolute);
-		}
+		Sessions->JoinGameSession();
 	}
 }
 
 void AMGNGDectectivesCharacter::Tick(float DeltaSeconds)
 {
-	if(isRagdoll)
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_CharacterTick);
+
+	// Measured for the time UCharacterSignificanceSubsystem saves by skipping Ticks
+	const double TickStartTime = FPlatformTime::Seconds();
+
+	// Aiming feedback is purely local, a dedicated server only runs the throw timing below
+	const bool bShowAim = !IsNetMode(NM_DedicatedServer);
+	if (bShowAim)
 	{
-		const FVector NewLocation(
-			GetMesh()->GetSocketLocation("spy_bones").X,
-			GetMesh()->GetSocketLocation("spy_bones").Y,
-			GetMesh()->GetSocketLocation("spy_bones").Z + 90
-		);
-		GetCapsuleComponent()->SetWorldLocation(NewLocation);
-		tieso = true;
+		DecalComponent->SetVisibility(LanzadoGranada);
 	}
-	
-	DecalComponent->SetVisibility(LanzadoGranada);
-	
-	if(LanzadoGranada)
+
+	if(LanzadoGranada && bShowAim)
 	{
+		MGNG_SCOPE_CYCLE_COUNTER(STAT_CharacterTrajectoryPrediction);
+
 		MyRotator = GetControlRotation();
 		ForwardVector = MyRotator.Vector();
 		StartLocation = ArrowDirection->GetComponentLocation();
 		LaunchVelocity = ForwardVector * 2000.0f;
-		bTraceComplex = false;
-		CollisionChannel = ECC_WorldDynamic;
-		EDrawDebugTrace::Type DrawDebugType = EDrawDebugTrace::None;
-		Params.bTraceComplex = bTraceComplex;
-		UGameplayStatics::Blueprint_PredictProjectilePath_ByTraceChannel(
-			GetWorld(),
-			HitResults,
-			OutPathPositions,
-			OutLastTraceDestinations,
-			StartLocation,
-			LaunchVelocity,
-			true,
-			20.0f,
-			CollisionChannel,
-			Params.bTraceComplex,
-			ActorsToIgnore,
-			DrawDebugType,
-			0.0f,
-			15.0f,
-			2.0f,
-			0.0f
-		);
-		DecalComponent->SetWorldLocationAndRotation(HitResults.ImpactPoint, FQuat::MakeFromEuler(HitResults.ImpactNormal));
+		// Only re-traces once the aim moved, the decal follows through OnGranadeImpactPredicted
+		GranadeTrajectory->UpdatePrediction(StartLocation, LaunchVelocity);
 	}
 
 	if(StartCount)
 	{
-		counter += DeltaSeconds;
-		if(counter >= 0.5f && canSoot)
+		MGNG_SCOPE_CYCLE_COUNTER(STAT_CharacterThrowCooldown);
+
+		// Adding up DeltaSeconds drifts with the frame rate, world time lands on the same step under a fixed step
+		const double counter = GetWorld()->GetTimeSeconds() - CountStartTime;
+		if(counter >= 0.5 && canSoot)
 		{
 			canSoot = false;
-			FActorSpawnParameters SpawnParams;
-			SpawnParams.Owner = this;
-			SpawnParams.Instigator = GetInstigator();
-			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-			// Set the initial location and rotation for the new actor
-			FVector SpawnLocation = GetActorLocation() + FVector(100.f, 0.f, 0.f);
-			FRotator SpawnRotation = GetActorRotation();
-			// Spawn the new actor
-			/*Object* SpawnActor = Cast<UObject>(StaticLoadObject(UObject::StaticClass(), NULL, TEXT("/Game/BP_Granade.BP_Granade")));
-			UBlueprint* GgeneratedBP = Cast<UBlueprint>(SpawnActor);*/
-			GetWorld()->SpawnActor<AActor>(Granada, ArrowDirection->GetComponentLocation(), GetControlRotation(), SpawnParams);
-		
+			ThrowGranada();
 		}
-		else if(counter >= 2.0f)
+		else if(counter >= 2.0)
 		{
 			granadeOpacity = 1.0;
 			StartCount = false;
-			counter = 0;
 			canSoot = true;
 		}
 	}
+
+	if (UCharacterSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UCharacterSignificanceSubsystem>())
+	{
+		Significance->AddTickTime(FPlatformTime::Seconds() - TickStartTime);
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -374,8 +268,10 @@ void AMGNGDectectivesCharacter::ThrowRelease()
 	if(!isRagdoll && canSoot)
 	{
 		LanzadoGranada = false;
+		GranadeTrajectory->ResetPrediction();
 		UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
 		StartCount = true;
+		CountStartTime = GetWorld()->GetTimeSeconds();
 		granadeOpacity = 0.2;
 		if (AnimInstance != nullptr)
 		{
@@ -401,18 +297,120 @@ void AMGNGDectectivesCharacter::Die(const FInputActionValue& Value)
 	if(Controller != nullptr)
 	{
 		LanzadoGranada = false;
-		// Set the spawn parameters for the new actor
-		FActorSpawnParameters SpawnParams;
-		SpawnParams.Owner = this;
-		SpawnParams.Instigator = GetInstigator();
-		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-		// Spawn the new actor
-		//UObject* SpawnActor = Cast<UObject>(StaticLoadObject(UObject::StaticClass(), NULL, TEXT("/Game/BP_Granade.BP_Granade")));
-		//UBlueprint* GeneratedBP = Cast<UBlueprint>(SpawnActor);
-		GetWorld()->SpawnActor<AActor>(Granada, ArrowDirection->GetComponentLocation(), GetControlRotation(), SpawnParams);
+		GranadeTrajectory->ResetPrediction();
+		ThrowGranada();
+	}
+}
+
+void AMGNGDectectivesCharacter::ThrowGranada()
+{
+	if (!Granada)
+	{
+		return;
+	}
+
+	const FVector Origin = ArrowDirection->GetComponentLocation();
+	const FVector LaunchVelocity = AGranade::GetDefaultLaunchVelocity(Granada, GetControlRotation().Quaternion());
+	const FVector Direction = LaunchVelocity.GetSafeNormal();
+	const float Speed = LaunchVelocity.Size();
+	const float Timestamp = AGranade::GetSyncedWorldTime(GetWorld());
+	const FTransform SpawnTransform(Direction.Rotation(), Origin);
+
+	if (HasAuthority())
+	{
+		FGameplayEventRecorder::Record(EGameplayEvent::Throw, this, Origin, Speed);
+		if (UProjectileManagerSubsystem* Projectiles = UProjectileManagerSubsystem::FindBatched(GetWorld()))
+		{
+			Projectiles->Spawn(Granada, Origin, LaunchVelocity, Timestamp, this, GetController());
+			return;
+		}
+		if (AGranade* Granade = AcquireGranada(SpawnTransform))
+		{
+			Granade->Launch(Origin, Direction, Speed, Timestamp, 0, false);
+		}
+		return;
+	}
+
+	// Batched projectiles are announced by the server, there is no actor to predict
+	if (UProjectileManagerSubsystem::FindBatched(GetWorld()) != nullptr)
+	{
+		ServerThrowGranada(Origin, Direction, Speed, Timestamp, 0);
+		return;
+	}
+
+	// Show the throw right away, the server copy replaces the proxy once it replicates
+	LastThrowId = LastThrowId == MAX_uint8 ? 1 : LastThrowId + 1;
+	if (AGranade* Proxy = AcquireGranada(SpawnTransform))
+	{
+		Proxy->Launch(Origin, Direction, Speed, Timestamp, LastThrowId, true);
+		PredictedGranadas.Add(LastThrowId, Proxy);
+	}
+	ServerThrowGranada(Origin, Direction, Speed, Timestamp, LastThrowId);
+}
+
+bool AMGNGDectectivesCharacter::ServerThrowGranada_Validate(FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction, float Impulse, float ClientTimestamp, uint8 ThrowId)
+{
+	return FMath::IsFinite(Impulse) && FMath::IsFinite(ClientTimestamp) && Impulse >= 0.0f;
+}
+
+void AMGNGDectectivesCharacter::ServerThrowGranada_Implementation(FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction, float Impulse, float ClientTimestamp, uint8 ThrowId)
+{
+	const float Now = AGranade::GetSyncedWorldTime(GetWorld());
+	if (!Granada || isRagdoll || Now - LastServerThrowTime < ServerThrowCooldown)
+	{
+		return;
+	}
+
+	// The client only chooses the aim, where and how hard it throws has to match what the server sees
+	if (FVector::DistSquared(Origin, ArrowDirection->GetComponentLocation()) > FMath::Square(ServerThrowTolerance))
+	{
+		return;
+	}
+	const float MaxSpeed = AGranade::GetDefaultLaunchVelocity(Granada, FQuat::Identity).Size();
+	LastServerThrowTime = Now;
+	FGameplayEventRecorder::Record(EGameplayEvent::Throw, this, Origin, FMath::Min(Impulse, MaxSpeed), ThrowId);
+
+	if (UProjectileManagerSubsystem* Projectiles = UProjectileManagerSubsystem::FindBatched(GetWorld()))
+	{
+		Projectiles->Spawn(Granada, Origin, FVector(Direction) * FMath::Min(Impulse, MaxSpeed), FMath::Min(ClientTimestamp, Now), this, GetController());
+		return;
+	}
+
+	if (AGranade* Granade = AcquireGranada(FTransform(Direction.Rotation(), Origin)))
+	{
+		Granade->Launch(Origin, Direction, FMath::Min(Impulse, MaxSpeed), FMath::Min(ClientTimestamp, Now), ThrowId, false);
+	}
+}
+
+void AMGNGDectectivesCharacter::ReconcilePredictedGranada(uint8 ThrowId)
+{
+	TWeakObjectPtr<AGranade> Proxy;
+	if (PredictedGranadas.RemoveAndCopyValue(ThrowId, Proxy) && Proxy.IsValid())
+	{
+		// The proxy may already have hit something and been handed out again for a later throw
+		if (Proxy->IsPredictedProxy() && Proxy->GetThrowId() == ThrowId)
+		{
+			Proxy->ReturnToPool();
+		}
 	}
 }
 
+AGranade* AMGNGDectectivesCharacter::AcquireGranada(const FTransform& SpawnTransform)
+{
+	if (UGranadePoolSubsystem* Pool = GetWorld()->GetSubsystem<UGranadePoolSubsystem>())
+	{
+		return Pool->Acquire(Granada, SpawnTransform, this, GetInstigator());
+	}
+
+	LLM_SCOPE_BYTAG(MGNG_Granades);
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = this;
+	SpawnParams.Instigator = GetInstigator();
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	INC_DWORD_STAT(STAT_MGNGActorSpawns);
+	return GetWorld()->SpawnActor<AGranade>(Granada, SpawnTransform, SpawnParams);
+}
+
 void AMGNGDectectivesCharacter::Move(const FInputActionValue& Value)
 {
 	// input is a Vector2D
@@ -451,34 +449,171 @@ void AMGNGDectectivesCharacter::Look(const FInputActionValue& Value)
 
 void AMGNGDectectivesCharacter::PrintOnDebug(FString TextToDisplay)
 {
-	GEngine->AddOnScreenDebugMessage(
-		-1,
-		1.0f,
-		FColor::Red,
-		TextToDisplay
-	);
+	// Shown by mgng.Events.OnScreen outside Shipping
+	FGameplayEventRecorder::Record(EGameplayEvent::Debug, this, GetActorLocation(), 0.0f, TextToDisplay.Len(), *TextToDisplay);
+}
+
+void AMGNGDectectivesCharacter::OnGranadeImpactPredicted(const FHitResult& Hit)
+{
+	DecalComponent->SetWorldLocationAndRotation(Hit.ImpactPoint, FQuat::MakeFromEuler(Hit.ImpactNormal));
+}
+
+void AMGNGDectectivesCharacter::OnRagdollStarted()
+{
+	FGameplayEventRecorder::Record(EGameplayEvent::Ragdoll, this, GetActorLocation());
+
+	isRagdoll = true;
+	tieso = true;
+	LanzadoGranada = false;
+
+	// The capsule is dragged along by RagdollState from now on
+	if (UMGNGCharacterMovementComponent* Movement = Cast<UMGNGCharacterMovementComponent>(GetCharacterMovement()))
+	{
+		Movement->SetRagdoll();
+	}
+	GetCharacterMovement()->DisableMovement();
+	GetCharacterMovement()->SetComponentTickEnabled(false);
 }
 
 void AMGNGDectectivesCharacter::PickUp()
 {
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_CharacterPickUp);
+
 	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
-	if (AnimInstance != nullptr && canPick)
+	UPickupInteractionSubsystem* Pickups = GetWorld()->GetSubsystem<UPickupInteractionSubsystem>();
+	if (AnimInstance == nullptr || Pickups == nullptr)
+	{
+		return;
+	}
+
+	// Ask again rather than trusting itemClass, the closest pickup may have changed since the last overlap
+	AItemActor* Item = Pickups->FindBestPickup(this);
+	if (Item != nullptr)
 	{
 		AnimInstance->Montage_Play(PickAnimation, 2.0f);
-		Piece++;
-		//canPick = false;
-		itemClass->Destroy();
-		itemClass = nullptr;
-		canPick=false;
+		if (HasAuthority())
+		{
+			CollectItem(Item);
+		}
+		else if (Item->GetPieceId() != 0)
+		{
+			// The piece disappears once the server's collected list arrives
+			ServerPickUp(Item->GetPieceId());
+		}
+	}
+}
+
+bool AMGNGDectectivesCharacter::ServerPickUp_Validate(uint32 PieceId)
+{
+	return PieceId != 0;
+}
+
+void AMGNGDectectivesCharacter::ServerPickUp_Implementation(uint32 PieceId)
+{
+	UPickupInteractionSubsystem* Pickups = GetWorld()->GetSubsystem<UPickupInteractionSubsystem>();
+	if (Pickups == nullptr || isRagdoll)
+	{
+		return;
+	}
+
+	// Someone else may have taken it first, or the client asks for a piece it can't reach
+	AItemActor* Item = Pickups->FindItem(PieceId);
+	if (Item != nullptr && Pickups->CanCollect(this, Item, ServerPickupTolerance))
+	{
+		CollectItem(Item);
+	}
+}
+
+void AMGNGDectectivesCharacter::CollectItem(AItemActor* Item)
+{
+	UPickupInteractionSubsystem* Pickups = GetWorld()->GetSubsystem<UPickupInteractionSubsystem>();
+	if (Pickups == nullptr || !Inventory->AddItem(Item->GetClass(), Item->GetPieceId()))
+	{
+		return;
 	}
+
+	FGameplayEventRecorder::Record(EGameplayEvent::Pickup, this, Item->GetActorLocation(), 0.0f, Item->GetPieceId());
+
+	// Refreshes canPick and itemClass with whatever is left in reach
+	Pickups->Collect(Item);
+}
+
+void AMGNGDectectivesCharacter::OnInventoryEntryChanged(const FInventoryEntry& Entry, bool bRemoved)
+{
+	// A removed entry is still in the list while its callback runs
+	Piece = Inventory->GetNumItems() - (bRemoved ? Entry.Count : 0);
+}
+
+void AMGNGDectectivesCharacter::FireShot(FVector Start, FVector Direction)
+{
+	if (isRagdoll)
+	{
+		return;
+	}
+
+	const float Timestamp = AGranade::GetSyncedWorldTime(GetWorld());
+	if (HasAuthority())
+	{
+		ConfirmShot(Start, Direction, Timestamp);
+	}
+	else
+	{
+		ServerFireShot(Start, Direction, Timestamp);
+	}
+}
+
+bool AMGNGDectectivesCharacter::ServerFireShot_Validate(FVector_NetQuantize Start, FVector_NetQuantizeNormal Direction, float ClientTimestamp)
+{
+	return FMath::IsFinite(ClientTimestamp);
+}
+
+void AMGNGDectectivesCharacter::ServerFireShot_Implementation(FVector_NetQuantize Start, FVector_NetQuantizeNormal Direction, float ClientTimestamp)
+{
+	const float Now = AGranade::GetSyncedWorldTime(GetWorld());
+	if (isRagdoll || Now - LastServerShotTime < ServerShotCooldown)
+	{
+		return;
+	}
+	if (FVector::DistSquared(Start, GetActorLocation()) > FMath::Square(ServerShotTolerance))
+	{
+		return;
+	}
+	LastServerShotTime = Now;
+	ConfirmShot(Start, Direction, ClientTimestamp);
+}
+
+void AMGNGDectectivesCharacter::ConfirmShot(const FVector& Start, const FVector& Direction, float ClientTimestamp)
+{
+	if (UMGNGCharacterMovementComponent* Movement = Cast<UMGNGCharacterMovementComponent>(GetCharacterMovement()))
+	{
+		Movement->MarkNetActive();
+	}
+
+	ULagCompensationSubsystem* LagCompensationSubsystem = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	FLagCompHit Hit;
+	if (LagCompensationSubsystem == nullptr || !LagCompensationSubsystem->ValidateShot(this, Start, Direction, ShotRange, ClientTimestamp, Hit))
+	{
+		return;
+	}
+
+	const FHitResult HitResult(Hit.Actor, nullptr, Hit.Location, -Direction);
+	UGameplayStatics::ApplyPointDamage(Hit.Actor, ShotDamage * Hit.DamageScale, Direction, HitResult, GetController(), this, UDamageType::StaticClass());
 }
 
 float AMGNGDectectivesCharacter::TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, AActor* DamageCauser)
 {
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_CharacterTakeDamage);
+	INC_DWORD_STAT(STAT_MGNGDamageEvents);
+	FGameplayEventRecorder::Record(EGameplayEvent::Damage, this, GetActorLocation(), DamageAmount, DamageEvent.GetTypeID());
+
+	if (UMGNGCharacterMovementComponent* Movement = Cast<UMGNGCharacterMovementComponent>(GetCharacterMovement()))
+	{
+		Movement->MarkNetActive();
+	}
+
 	if(DamageEvent.IsOfType(FRadialDamageEvent::ClassID))
 	{
-		GetMesh()->SetAllBodiesBelowSimulatePhysics("spy_bones", true);
-		isRagdoll = true;
+		RagdollState->StartRagdoll();
 	}
 	return 0;
 }
\ No newline at end of file
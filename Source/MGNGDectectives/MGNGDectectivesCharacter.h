@@ -5,7 +5,6 @@
 #include "InputActionValue.h"
 #include "Components/DecalComponent.h"
 #include "ItemActor.h"
-#include "Interfaces/OnlineSessionInterface.h"
 #include "MGNGDectectivesCharacter.generated.h"
 
 
@@ -14,6 +13,9 @@ class AMGNGDectectivesCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
+	/** Drives bots through the same input handlers a player uses */
+	friend class UGameplayBenchmarkSubsystem;
+
 	/** Camera boom positioning the camera behind the character */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class USpringArmComponent* CameraBoom;
@@ -56,6 +58,22 @@ class AMGNGDectectivesCharacter : public ACharacter
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Default, meta = (AllowPrivateAccess = "true"))
 	class UDecalComponent* DecalComponent;
 
+	/** Predicts the grenade arc while aiming and moves DecalComponent to the impact */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Weapon, meta = (AllowPrivateAccess = "true"))
+	class UGranadeTrajectoryComponent* GranadeTrajectory;
+
+	/** Simulates the ragdoll on the server and replicates its root bone to everyone else */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Death, meta = (AllowPrivateAccess = "true"))
+	class URagdollStateComponent* RagdollState;
+
+	/** Server side hitbox history that shots from laggy clients are checked against */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Weapon, meta = (AllowPrivateAccess = "true"))
+	class ULagCompensationComponent* LagCompensation;
+
+	/** Clue pieces and other items, replicated to the owning client */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Keys, meta = (AllowPrivateAccess = "true"))
+	class UInventoryComponent* Inventory;
+
 	/** Look Input Action */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	class UInputAction* PickAction;
@@ -75,10 +93,9 @@ UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Animation)
     class UAnimMontage* ShootAnimation;
 	UPROPERTY(EditAnywhere,Category = Item)
         AItemActor* itemClass;
-	AMGNGDectectivesCharacter();
+	AMGNGDectectivesCharacter(const FObjectInitializer& ObjectInitializer);
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Animation)
-	TSubclassOf<AActor>Granada;
-	IOnlineSessionPtr OnlineSessionInterface;
+	TSubclassOf<class AGranade>Granada;
 	
 
 protected:
@@ -111,29 +128,60 @@ protected:
 
 	void PickUp();
 
+	void OnGranadeImpactPredicted(const FHitResult& Hit);
+
+	void OnRagdollStarted();
+
+	/** Throws from ArrowDirection along the control rotation, through the server when this is a client */
+	void ThrowGranada();
+
+	/** Takes a grenade from the world's pool, or spawns one if there is no pool */
+	class AGranade* AcquireGranada(const FTransform& SpawnTransform);
+
+	/** Collects Item and puts it in the inventory, the caller has to have authority */
+	void CollectItem(AItemActor* Item);
+
+	void OnInventoryEntryChanged(const struct FInventoryEntry& Entry, bool bRemoved);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerPickUp(uint32 PieceId);
+
+	/** Rewinds the other characters to ClientTimestamp and applies ShotDamage to whatever the shot hit */
+	void ConfirmShot(const FVector& Start, const FVector& Direction, float ClientTimestamp);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerFireShot(FVector_NetQuantize Start, FVector_NetQuantizeNormal Direction, float ClientTimestamp);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerThrowGranada(FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction, float Impulse, float ClientTimestamp, uint8 ThrowId);
+
 
 protected:
 	// APawn interface
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	
+	virtual void PostInitializeComponents() override;
+
 	// To add mapping context
 	virtual void BeginPlay();
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void Tick(float DeltaSeconds) override;
 
 	virtual float TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, AActor* DamageCauser) override;
 
+	/** Forwards to UMatchSessionSubsystem, which outlives this pawn */
 	UFUNCTION(BlueprintCallable)
 	void CreateGameSession();
 
+	/** Forwards to UMatchSessionSubsystem, which outlives this pawn */
 	UFUNCTION(BlueprintCallable)
 	void JoinGameSession();
-
-	//Callbacks
-	void OnCreateSessionComplete(FName SessionName, bool bWasSuccess);
-	void OnFindSessionComplete(bool bWasSuccessful);
-	void OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result);
 public:
+	/** Drops the predicted proxy for ThrowId once the server's copy of that throw has arrived */
+	void ReconcilePredictedGranada(uint8 ThrowId);
+
 	/** Returns CameraBoom subobject **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
 	/** Returns FollowCamera subobject **/
@@ -144,31 +192,58 @@ public:
 	
 	bool LanzadoGranada;
 	float Impulso;
-	float counter;
 
+	/** World time the release started the count, the throw and cooldown are measured from it rather than summed up */
+	double CountStartTime;
 	bool StartCount;
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category=Weapon)
     bool canPick = false;
-	FHitResult HitResults;
-	TArray<FVector> OutPathPositions;
-	FVector OutLastTraceDestinations;
-
-	TArray<AActor*> ActorsToIgnore;
 	FRotator MyRotator;
 	FVector ForwardVector;
 	
 	FVector StartLocation;
 	FVector LaunchVelocity;
 
-	bool bTraceComplex;
-	TEnumAsByte<ECollisionChannel> CollisionChannel;
+	/** How far the throw origin a client sends may be from where the server sees ArrowDirection */
+	UPROPERTY(EditAnywhere, Category=Weapon)
+	float ServerThrowTolerance = 150.0f;
+
+	/** Shortest time between two throws the server accepts */
+	UPROPERTY(EditAnywhere, Category=Weapon)
+	float ServerThrowCooldown = 0.5f;
+
+	/** How much further than the pickup reach the server still accepts a client's pickup */
+	UPROPERTY(EditAnywhere, Category=Keys)
+	float ServerPickupTolerance = 100.0f;
+
+	FORCEINLINE class UInventoryComponent* GetInventory() const { return Inventory; }
+
+	FORCEINLINE class URagdollStateComponent* GetRagdollState() const { return RagdollState; }
+
+	/** Fires a hitscan shot from Start, confirmed by the server against where targets were when the client fired */
+	UFUNCTION(BlueprintCallable, Category=Weapon)
+	void FireShot(FVector Start, FVector Direction);
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Weapon)
+	float ShotDamage = 100.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category=Weapon)
+	float ShotRange = 10000.0f;
+
+	/** How far from the character the server still accepts the start of a client's shot */
+	UPROPERTY(EditAnywhere, Category=Weapon)
+	float ServerShotTolerance = 200.0f;
+
+	/** Shortest time between two shots the server accepts */
+	UPROPERTY(EditAnywhere, Category=Weapon)
+	float ServerShotCooldown = 0.1f;
 
-	FCollisionQueryParams Params;
 private:
-	FOnCreateSessionCompleteDelegate CreateSessionCompleteDelegate;
-	FOnFindSessionsCompleteDelegate FindSessionsCompleteDelegate;
-	FOnJoinSessionCompleteDelegate JoinSessionCompleteDelegate;
+	uint8 LastThrowId = 0;
+	float LastServerThrowTime = -1000.0f;
+	float LastServerShotTime = -1000.0f;
+	TMap<uint8, TWeakObjectPtr<class AGranade>> PredictedGranadas;
 
-	TSharedPtr<FOnlineSessionSearch> SessionSearch;
+	class UMatchSessionSubsystem* GetSessionSubsystem() const;
 };
 
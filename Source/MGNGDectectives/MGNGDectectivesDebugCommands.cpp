@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MGNGDectectives.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+
+namespace MGNGDebugCommands
+{
+	struct FTickReportRow
+	{
+		int32 Actors = 0;
+		int32 TickingActors = 0;
+		int32 TickingComponents = 0;
+	};
+
+	/** Closest native class declared in this module, or null for actors that don't derive from one */
+	UClass* FindProjectClass(UClass* Class)
+	{
+		static const FName ModulePackage(TEXT("/Script/MGNGDectectives"));
+		for (; Class != nullptr; Class = Class->GetSuperClass())
+		{
+			if (Class->HasAnyClassFlags(CLASS_Native) && Class->GetOutermost()->GetFName() == ModulePackage)
+			{
+				return Class;
+			}
+		}
+		return nullptr;
+	}
+
+	bool IsTickRegistered(const FTickFunction& TickFunction)
+	{
+		return TickFunction.IsTickFunctionRegistered() && TickFunction.IsTickFunctionEnabled();
+	}
+
+	void ReportTicking(UWorld* World)
+	{
+		if (World == nullptr)
+		{
+			return;
+		}
+
+		TMap<UClass*, FTickReportRow> Rows;
+		for (TActorIterator<AActor> It(World); It; ++It)
+		{
+			AActor* Actor = *It;
+			UClass* ProjectClass = FindProjectClass(Actor->GetClass());
+			if (ProjectClass == nullptr)
+			{
+				continue;
+			}
+
+			FTickReportRow& Row = Rows.FindOrAdd(ProjectClass);
+			++Row.Actors;
+			if (IsTickRegistered(Actor->PrimaryActorTick))
+			{
+				++Row.TickingActors;
+			}
+			for (UActorComponent* Component : Actor->GetComponents())
+			{
+				if (Component != nullptr && IsTickRegistered(Component->PrimaryComponentTick))
+				{
+					++Row.TickingComponents;
+				}
+			}
+		}
+
+		UE_LOG(LogMGNGDectectives, Display, TEXT("Ticking project actors in %s:"), *World->GetMapName());
+		for (const TPair<UClass*, FTickReportRow>& Pair : Rows)
+		{
+			UE_LOG(LogMGNGDectectives, Display, TEXT("  %-32s %5d actors, %5d ticking, %5d ticking components"),
+				*Pair.Key->GetName(), Pair.Value.Actors, Pair.Value.TickingActors, Pair.Value.TickingComponents);
+		}
+	}
+}
+
+static FAutoConsoleCommandWithWorld TickReportCommand(
+	TEXT("mgng.Tick.Report"),
+	TEXT("Prints how many actors of each project class are in the world and how many of them are registered to tick."),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&MGNGDebugCommands::ReportTicking)
+);
@@ -1,7 +1,13 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "MGNGDectectivesGameMode.h"
+#include "MGNGDectectives.h"
 #include "MGNGDectectivesCharacter.h"
+#include "MatchSessionSubsystem.h"
+#include "Engine/GameInstance.h"
+#include "GameFramework/GameStateBase.h"
+#include "HAL/PlatformTime.h"
+#include "TimerManager.h"
 #include "UObject/ConstructorHelpers.h"
 
 AMGNGDectectivesGameMode::AMGNGDectectivesGameMode()
@@ -13,3 +19,56 @@ AMGNGDectectivesGameMode::AMGNGDectectivesGameMode()
 		DefaultPawnClass = PlayerPawnBPClass.Class;
 	}
 }
+
+void AMGNGDectectivesGameMode::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!IsNetMode(NM_DedicatedServer))
+	{
+		return;
+	}
+
+	// The session lives on the game instance, so it survives travelling between maps
+	if (UMatchSessionSubsystem* Sessions = GetGameInstance()->GetSubsystem<UMatchSessionSubsystem>())
+	{
+		Sessions->RegisterDedicatedSession(MaxPublicConnections, MatchType);
+	}
+
+	MatchStartTime = FPlatformTime::Seconds();
+	if (MatchStatsInterval > 0.0f)
+	{
+		GetWorldTimerManager().SetTimer(MatchStatsTimer, this, &ThisClass::LogMatchStats, MatchStatsInterval, true);
+	}
+}
+
+void AMGNGDectectivesGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (IsNetMode(NM_DedicatedServer) && MatchStatsInterval > 0.0f)
+	{
+		// Final line covers the whole match on this map
+		LogMatchStats();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AMGNGDectectivesGameMode::LogMatchStats()
+{
+	// Every match is its own process, so process wide numbers are per match numbers
+	const FCPUTime CpuTime = FPlatformTime::GetCPUTime();
+	CpuPctSum += CpuTime.CPUTimePct;
+	++NumCpuSamples;
+
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	const int32 NumPlayers = GameState != nullptr ? GameState->PlayerArray.Num() : 0;
+
+	UE_LOG(LogMGNGDectectives, Log, TEXT("Match stats %s: %.0f s, %d players, CPU %.1f%% of a core (avg %.1f%%), memory %.1f MB (peak %.1f MB)"),
+		*GetWorld()->GetMapName(),
+		FPlatformTime::Seconds() - MatchStartTime,
+		NumPlayers,
+		CpuTime.CPUTimePct,
+		CpuPctSum / NumCpuSamples,
+		MemoryStats.UsedPhysical / (1024.0 * 1024.0),
+		MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0));
+}
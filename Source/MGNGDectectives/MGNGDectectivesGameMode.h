@@ -13,6 +13,30 @@ class AMGNGDectectivesGameMode : public AGameModeBase
 
 public:
 	AMGNGDectectivesGameMode();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+protected:
+	/** Players a dedicated server advertises room for */
+	UPROPERTY(Config)
+	int32 MaxPublicConnections = 4;
+
+	/** MatchType setting of the advertised session, matchmaking filters on it */
+	UPROPERTY(Config)
+	FString MatchType = TEXT("FreeForAll");
+
+	/** Seconds between two CPU and memory lines in a dedicated server's log, 0 turns them off */
+	UPROPERTY(Config)
+	float MatchStatsInterval = 30.0f;
+
+private:
+	void LogMatchStats();
+
+	FTimerHandle MatchStatsTimer;
+	double MatchStartTime = 0.0;
+	double CpuPctSum = 0.0;
+	int32 NumCpuSamples = 0;
 };
 
 
@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MGNGReplicationGraph.h"
+
+#include "MGNGDectectives.h"
+#include "MGNGDectectivesCharacter.h"
+#include "Granade.h"
+#include "ItemActor.h"
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "ReplicationGraphTypes.h"
+#include "UObject/UObjectIterator.h"
+
+DECLARE_CYCLE_STAT(TEXT("Replication Graph Replicate Actors"), STAT_MGNGReplicateActors, STATGROUP_MGNGDectectives);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Replication Graph Replicate (ms)"), STAT_MGNGReplicateActorsMs, STATGROUP_MGNGDectectives);
+
+static FAutoConsoleCommandWithWorld ReplicationGraphStatsCommand(
+	TEXT("mgng.RepGraph.Stats"),
+	TEXT("Prints the connection count and the last and peak ServerReplicateActors time of the project replication graph."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		if (const UMGNGReplicationGraph* Graph = NetDriver ? Cast<UMGNGReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr)
+		{
+			Graph->LogStats();
+		}
+		else
+		{
+			UE_LOG(LogMGNGDectectives, Display, TEXT("The current net driver doesn't use UMGNGReplicationGraph"));
+		}
+	})
+);
+
+//////////////////////////////////////////////////////////////////////////
+// UMGNGReplicationGraphNode_AlwaysRelevant_ForConnection
+
+void UMGNGReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	ReplicationActorList.Reset();
+
+	for (const FNetViewer& Viewer : Params.Viewers)
+	{
+		ReplicationActorList.ConditionalAdd(Viewer.InViewer);
+		ReplicationActorList.ConditionalAdd(Viewer.ViewTarget);
+
+		if (const APlayerController* PlayerController = Cast<APlayerController>(Viewer.InViewer))
+		{
+			ReplicationActorList.ConditionalAdd(PlayerController->GetPawn());
+			ReplicationActorList.ConditionalAdd(PlayerController->PlayerState);
+		}
+	}
+
+	Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorList);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UMGNGReplicationGraph
+
+void UMGNGReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	ClassRepNodePolicies.Set(AMGNGDectectivesCharacter::StaticClass(), EMGNGClassRepNodeMapping::Spatialize_Dynamic);
+	// Grenades are dynamic while in flight, parked ones go dormant and stop being re-bucketed
+	ClassRepNodePolicies.Set(AGranade::StaticClass(), EMGNGClassRepNodeMapping::Spatialize_Dormancy);
+	ClassRepNodePolicies.Set(AItemActor::StaticClass(), EMGNGClassRepNodeMapping::Spatialize_Dormancy);
+	ClassRepNodePolicies.Set(ALevelScriptActor::StaticClass(), EMGNGClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(APlayerController::StaticClass(), EMGNGClassRepNodeMapping::NotRouted);
+
+	FClassReplicationInfo CharacterInfo;
+	CharacterInfo.SetCullDistanceSquared(FMath::Square(CharacterCullDistance));
+	CharacterInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(GetDefault<AMGNGDectectivesCharacter>()->NetUpdateFrequency);
+	GlobalActorReplicationInfoMap.SetClassInfo(AMGNGDectectivesCharacter::StaticClass(), CharacterInfo);
+
+	// Only NetState changes and it is needed right away, an awake grenade goes out every frame
+	FClassReplicationInfo GranadeInfo;
+	GranadeInfo.SetCullDistanceSquared(FMath::Square(GranadeCullDistance));
+	GranadeInfo.ReplicationPeriodFrame = 1;
+	GlobalActorReplicationInfoMap.SetClassInfo(AGranade::StaticClass(), GranadeInfo);
+
+	FClassReplicationInfo PickupInfo;
+	PickupInfo.SetCullDistanceSquared(FMath::Square(PickupCullDistance));
+	PickupInfo.ReplicationPeriodFrame = FMath::Max(PickupReplicationPeriodFrame, 1);
+	GlobalActorReplicationInfoMap.SetClassInfo(AItemActor::StaticClass(), PickupInfo);
+
+	// Everything else keeps the update rate and cull distance its defaults ask for
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject(false));
+		if (ActorCDO == nullptr || !ActorCDO->GetIsReplicated())
+		{
+			continue;
+		}
+		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+		if (Class->IsChildOf<AMGNGDectectivesCharacter>() || Class->IsChildOf<AGranade>() || Class->IsChildOf<AItemActor>())
+		{
+			continue;
+		}
+
+		FClassReplicationInfo ClassInfo;
+		if (GetMappingPolicy(Class) >= EMGNGClassRepNodeMapping::Spatialize_Static)
+		{
+			ClassInfo.SetCullDistanceSquared(ActorCDO->NetCullDistanceSquared);
+		}
+		ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(FMath::Max(ActorCDO->NetUpdateFrequency, 1.0f));
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+}
+
+void UMGNGReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = CellSize;
+	GridNode->SpatialBias = SpatialBias;
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void UMGNGReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	UMGNGReplicationGraphNode_AlwaysRelevant_ForConnection* ConnectionNode = CreateNewNode<UMGNGReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(ConnectionNode, RepGraphConnection);
+}
+
+EMGNGClassRepNodeMapping UMGNGReplicationGraph::GetMappingPolicy(const UClass* Class)
+{
+	if (const EMGNGClassRepNodeMapping* Policy = ClassRepNodePolicies.Get(Class))
+	{
+		return *Policy;
+	}
+
+	const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+	EMGNGClassRepNodeMapping Mapping = EMGNGClassRepNodeMapping::Spatialize_Dynamic;
+	if (ActorCDO->bOnlyRelevantToOwner)
+	{
+		Mapping = EMGNGClassRepNodeMapping::NotRouted;
+	}
+	else if (ActorCDO->bAlwaysRelevant || ActorCDO->GetRootComponent() == nullptr)
+	{
+		// Actors without a location, game state and player states included, can't be placed in the grid
+		Mapping = EMGNGClassRepNodeMapping::RelevantAllConnections;
+	}
+
+	ClassRepNodePolicies.Set(Class, Mapping);
+	return Mapping;
+}
+
+void UMGNGReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case EMGNGClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case EMGNGClassRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case EMGNGClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case EMGNGClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+void UMGNGReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case EMGNGClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case EMGNGClassRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case EMGNGClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+	case EMGNGClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+int32 UMGNGReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MGNGReplicateActors);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 Result = Super::ServerReplicateActors(DeltaSeconds);
+	LastReplicateMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	PeakReplicateMs = FMath::Max(PeakReplicateMs, LastReplicateMs);
+	SET_FLOAT_STAT(STAT_MGNGReplicateActorsMs, LastReplicateMs);
+	return Result;
+}
+
+void UMGNGReplicationGraph::SetActorNetUpdateFrequency(AActor* Actor, float NetUpdateFrequency)
+{
+	FGlobalActorReplicationInfo* GlobalInfo = GlobalActorReplicationInfoMap.Find(Actor);
+	if (GlobalInfo == nullptr)
+	{
+		return;
+	}
+	const uint16 PeriodFrame = GetReplicationPeriodFrameForFrequency(FMath::Max(NetUpdateFrequency, 1.0f));
+	GlobalInfo->Settings.ReplicationPeriodFrame = PeriodFrame;
+
+	// Connections copied the period when they first saw the actor and schedule from their copy
+	for (UNetReplicationGraphConnection* Connection : Connections)
+	{
+		if (FConnectionReplicationActorInfo* ConnectionInfo = Connection ? Connection->ActorInfoMap.Find(Actor) : nullptr)
+		{
+			ConnectionInfo->ReplicationPeriodFrame = PeriodFrame;
+			ConnectionInfo->NextReplicationFrameNum = ConnectionInfo->LastRepFrameNum + PeriodFrame;
+		}
+	}
+}
+
+void UMGNGReplicationGraph::LogStats() const
+{
+	UE_LOG(LogMGNGDectectives, Display, TEXT("Replication graph: %d connections, last replicate %.3f ms, peak %.3f ms, grid cell %.0f"),
+		Connections.Num(), LastReplicateMs, PeakReplicateMs, CellSize);
+}
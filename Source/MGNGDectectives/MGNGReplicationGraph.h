@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "MGNGReplicationGraph.generated.h"
+
+class UReplicationGraphNode_ActorList;
+class UReplicationGraphNode_GridSpatialization2D;
+
+/** Which node of the graph a replicated class goes to */
+enum class EMGNGClassRepNodeMapping : uint32
+{
+	/** Doesn't go in any node, the per-connection node picks it up when it matters */
+	NotRouted,
+	RelevantAllConnections,
+
+	/** Never moves, put in the grid cells it touches once */
+	Spatialize_Static,
+	/** Moves, re-bucketed in the grid every frame */
+	Spatialize_Dynamic,
+	/** Static while dormant, dynamic while awake */
+	Spatialize_Dormancy,
+};
+
+/** Adds each connection's own controller, view target and pawn, which the grid may not cover */
+UCLASS()
+class MGNGDECTECTIVES_API UMGNGReplicationGraphNode_AlwaysRelevant_ForConnection : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& Actor) override {}
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override { return false; }
+	virtual void NotifyResetAllNetworkActors() override {}
+
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+private:
+	FActorRepListRefView ReplicationActorList;
+};
+
+/**
+ * Replication driver of the game net drivers. Characters are re-bucketed every frame in a 2D grid,
+ * grenades and clue pieces sit in the same grid as dormancy actors, so parked grenades and untouched pickups
+ * cost nothing until they wake up. A connection only considers the cells around its viewers, which makes
+ * server replication scale with how crowded an area is instead of with connections times actors.
+ */
+UCLASS(transient, config=Game)
+class MGNGDECTECTIVES_API UMGNGReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+	/** Game thread time of the last ServerReplicateActors call */
+	FORCEINLINE double GetLastReplicateMs() const { return LastReplicateMs; }
+
+	FORCEINLINE int32 GetNumConnections() const { return Connections.Num(); }
+
+	/** Replaces the rate one actor was given from its class on every connection, for characters that slow down while idle */
+	void SetActorNetUpdateFrequency(AActor* Actor, float NetUpdateFrequency);
+
+	void LogStats() const;
+
+protected:
+	/** Edge length of a grid cell */
+	UPROPERTY(Config)
+	float CellSize = 10000.0f;
+
+	/** Lower corner of the grid, keeps cell indices positive on maps centred on the origin */
+	UPROPERTY(Config)
+	FVector2D SpatialBias = FVector2D(-150000.0f, -200000.0f);
+
+	UPROPERTY(Config)
+	float CharacterCullDistance = 15000.0f;
+
+	UPROPERTY(Config)
+	float GranadeCullDistance = 8000.0f;
+
+	UPROPERTY(Config)
+	float PickupCullDistance = 6000.0f;
+
+	/** Frames between two replication passes over a pickup that is awake */
+	UPROPERTY(Config)
+	int32 PickupReplicationPeriodFrame = 4;
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+private:
+	EMGNGClassRepNodeMapping GetMappingPolicy(const UClass* Class);
+
+	TClassMap<EMGNGClassRepNodeMapping> ClassRepNodePolicies;
+
+	double LastReplicateMs = 0.0;
+	double PeakReplicateMs = 0.0;
+};
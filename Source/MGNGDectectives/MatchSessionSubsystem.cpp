@@ -0,0 +1,281 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MatchSessionSubsystem.h"
+
+#include "MGNGDectectives.h"
+#include "GameplayEventRecorder.h"
+#include "MatchmakingService.h"
+#include "Engine/GameInstance.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "OnlineSubsystem.h"
+#include "OnlineSessionSettings.h"
+
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Online Subsystem Lookup (ms)"), STAT_OnlineSubsystemLookupMs, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Session Create Complete"), STAT_SessionCreateComplete, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Session Matchmaking Finished"), STAT_SessionMatchmakingFinished, STATGROUP_MGNGDectectives);
+
+static FAutoConsoleCommandWithWorld MatchSessionStatsCommand(
+	TEXT("mgng.Session.Stats"),
+	TEXT("Prints when the online subsystem was looked up, how long that took and what the session subsystem is doing."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		if (const UMatchSessionSubsystem* Sessions = GameInstance ? GameInstance->GetSubsystem<UMatchSessionSubsystem>() : nullptr)
+		{
+			Sessions->LogStats();
+		}
+	})
+);
+
+void UMatchSessionSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	InitializeTime = FPlatformTime::Seconds();
+	FramesUntilInit = FMath::Max(OnlineInitDelayFrames, 0);
+
+	// Loading the online layer is not needed to show the first frame, so it waits until the engine is ticking
+	DeferredInitHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickDeferredInit));
+}
+
+void UMatchSessionSubsystem::Deinitialize()
+{
+	if (DeferredInitHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(DeferredInitHandle);
+		DeferredInitHandle.Reset();
+	}
+
+	if (Matchmaking.IsValid())
+	{
+		Matchmaking->Cancel();
+		Matchmaking.Reset();
+	}
+
+	if (SessionInterface.IsValid())
+	{
+		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionHandle);
+	}
+	SessionInterface.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UMatchSessionSubsystem::TickDeferredInit(float DeltaTime)
+{
+	if (FramesUntilInit-- > 0)
+	{
+		return true;
+	}
+
+	DeferredInitHandle.Reset();
+	EnsureOnlineSubsystem();
+	return false;
+}
+
+bool UMatchSessionSubsystem::EnsureOnlineSubsystem()
+{
+	if (SessionInterface.IsValid())
+	{
+		return true;
+	}
+
+	if (DeferredInitHandle.IsValid())
+	{
+		// Somebody needed a session before the deferred init came round
+		FTSTicker::GetCoreTicker().RemoveTicker(DeferredInitHandle);
+		DeferredInitHandle.Reset();
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get();
+	if (OnlineSubsystem != nullptr)
+	{
+		SessionInterface = OnlineSubsystem->GetSessionInterface();
+	}
+	OnlineReadyTime = FPlatformTime::Seconds();
+	OnlineLookupMs = (OnlineReadyTime - StartTime) * 1000.0;
+	SET_FLOAT_STAT(STAT_OnlineSubsystemLookupMs, OnlineLookupMs);
+
+	UE_LOG(LogMGNGDectectives, Log, TEXT("Online subsystem %s looked up in %.2f ms, %.2f s after the game instance started"),
+		OnlineSubsystem ? *OnlineSubsystem->GetSubsystemName().ToString() : TEXT("<none>"), OnlineLookupMs, OnlineReadyTime - InitializeTime);
+
+	return SessionInterface.IsValid();
+}
+
+void UMatchSessionSubsystem::CreateGameSession()
+{
+	if (!EnsureOnlineSubsystem())
+	{
+		return;
+	}
+
+	const ULocalPlayer* LocalPlayer = GetGameInstance()->GetFirstGamePlayer();
+	if (LocalPlayer == nullptr || !LocalPlayer->GetPreferredUniqueNetId().IsValid())
+	{
+		return;
+	}
+
+	if (SessionInterface->GetNamedSession(NAME_GameSession) != nullptr)
+	{
+		SessionInterface->DestroySession(NAME_GameSession);
+	}
+
+	FOnlineSessionSettings SessionSettings;
+	SessionSettings.bIsLANMatch = false;
+	SessionSettings.NumPublicConnections = LobbyPublicConnections;
+	SessionSettings.bAllowJoinInProgress = true;
+	SessionSettings.bAllowJoinViaPresence = true;
+	SessionSettings.bShouldAdvertise = true;
+	SessionSettings.bUsesPresence = true;
+	SessionSettings.bUseLobbiesIfAvailable = true;
+	SessionSettings.Set(FName("MatchType"), LobbyMatchType, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+
+	StartCreateSession(SessionSettings, false);
+}
+
+void UMatchSessionSubsystem::RegisterDedicatedSession(int32 MaxPublicConnections, const FString& MatchType)
+{
+	if (!EnsureOnlineSubsystem() || SessionInterface->GetNamedSession(NAME_GameSession) != nullptr)
+	{
+		return;
+	}
+
+	FOnlineSessionSettings SessionSettings;
+	SessionSettings.bIsDedicated = true;
+	SessionSettings.bIsLANMatch = false;
+	SessionSettings.NumPublicConnections = MaxPublicConnections;
+	SessionSettings.bAllowJoinInProgress = true;
+	SessionSettings.bShouldAdvertise = true;
+	// No host player, so no presence or lobby to hang the session on
+	SessionSettings.bUsesPresence = false;
+	SessionSettings.bAllowJoinViaPresence = false;
+	SessionSettings.bUseLobbiesIfAvailable = false;
+	SessionSettings.Set(FName("MatchType"), MatchType, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+
+	if (!StartCreateSession(SessionSettings, true))
+	{
+		UE_LOG(LogMGNGDectectives, Warning, TEXT("Dedicated server could not start creating its session"));
+	}
+}
+
+bool UMatchSessionSubsystem::StartCreateSession(const FOnlineSessionSettings& Settings, bool bDedicated)
+{
+	if (IsCreatingSession())
+	{
+		return false;
+	}
+
+	bCreatingDedicated = bDedicated;
+	FGameplayEventRecorder::Record(EGameplayEvent::SessionCreateStarted, this, FVector::ZeroVector, 0.0f, bDedicated ? 1 : 0);
+	CreateSessionHandle = SessionInterface->AddOnCreateSessionCompleteDelegate_Handle(
+		FOnCreateSessionCompleteDelegate::CreateUObject(this, &ThisClass::OnCreateSessionComplete));
+
+	bool bStarted = false;
+	if (bDedicated)
+	{
+		bStarted = SessionInterface->CreateSession(0, NAME_GameSession, Settings);
+	}
+	else
+	{
+		const ULocalPlayer* LocalPlayer = GetGameInstance()->GetFirstGamePlayer();
+		bStarted = SessionInterface->CreateSession(*LocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, Settings);
+	}
+
+	// The completion may already have fired and cleared the handle inside CreateSession
+	if (!bStarted && CreateSessionHandle.IsValid())
+	{
+		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionHandle);
+	}
+	return bStarted;
+}
+
+void UMatchSessionSubsystem::OnCreateSessionComplete(FName SessionName, bool bWasSuccessful)
+{
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_SessionCreateComplete);
+
+	SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionHandle);
+
+	TCHAR SessionNameText[NAME_SIZE];
+	SessionName.ToString(SessionNameText);
+	FGameplayEventRecorder::Record(bWasSuccessful ? EGameplayEvent::SessionCreated : EGameplayEvent::SessionCreateFailed,
+		this, FVector::ZeroVector, 0.0f, bCreatingDedicated ? 1 : 0, SessionNameText);
+
+	if (bCreatingDedicated)
+	{
+		UE_LOG(LogMGNGDectectives, Log, TEXT("Dedicated server session %s %s"), *SessionName.ToString(), bWasSuccessful ? TEXT("registered") : TEXT("failed to register"));
+		return;
+	}
+
+	if (bWasSuccessful)
+	{
+		if (UWorld* World = GetWorld())
+		{
+			World->ServerTravel(LobbyMap + TEXT("?listen"));
+		}
+	}
+}
+
+void UMatchSessionSubsystem::JoinGameSession()
+{
+	if (!EnsureOnlineSubsystem())
+	{
+		return;
+	}
+
+	if (Matchmaking.IsValid() && Matchmaking->IsBusy())
+	{
+		return;
+	}
+
+	const ULocalPlayer* LocalPlayer = GetGameInstance()->GetFirstGamePlayer();
+	if (LocalPlayer == nullptr)
+	{
+		return;
+	}
+
+	if (!Matchmaking.IsValid())
+	{
+		Matchmaking = MakeShared<FMatchmakingService>(MakeShared<FOnlineSessionProvider>(SessionInterface, LocalPlayer->GetPreferredUniqueNetId()));
+	}
+	// Before starting, a search that fails right away finishes inside Start
+	FGameplayEventRecorder::Record(EGameplayEvent::MatchmakingStarted, this);
+	FMatchmakingParams Params;
+	Params.bSearchPresence = !bJoinDedicatedServers;
+	Matchmaking->Start(Params, FOnMatchmakingFinished::CreateUObject(this, &ThisClass::OnMatchmakingFinished));
+}
+
+void UMatchSessionSubsystem::OnMatchmakingFinished(bool bSuccess, const FString& ConnectAddress)
+{
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_SessionMatchmakingFinished);
+
+	const FMatchmakingMetrics& Metrics = Matchmaking->GetMetrics();
+	FGameplayEventRecorder::Record(bSuccess ? EGameplayEvent::MatchmakingJoined : EGameplayEvent::MatchmakingFailed,
+		this, FVector::ZeroVector, static_cast<float>(Metrics.GetTimeToJoin()), Metrics.NumResultsSeen, *ConnectAddress);
+
+	if (!bSuccess)
+	{
+		return;
+	}
+
+	if (APlayerController* PlayerController = GetGameInstance()->GetFirstLocalPlayerController())
+	{
+		PlayerController->ClientTravel(ConnectAddress, TRAVEL_Absolute);
+	}
+}
+
+void UMatchSessionSubsystem::LogStats() const
+{
+	if (!IsOnlineReady())
+	{
+		UE_LOG(LogMGNGDectectives, Log, TEXT("Session subsystem: online subsystem not looked up yet, %.2f s after start"), FPlatformTime::Seconds() - InitializeTime);
+		return;
+	}
+
+	UE_LOG(LogMGNGDectectives, Log, TEXT("Session subsystem: online lookup took %.2f ms, %.2f s after start; creating session %d, matchmaking %d"),
+		OnlineLookupMs, OnlineReadyTime - InitializeTime, IsCreatingSession() ? 1 : 0, Matchmaking.IsValid() && Matchmaking->IsBusy() ? 1 : 0);
+}
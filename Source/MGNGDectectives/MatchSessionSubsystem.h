@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "MatchSessionSubsystem.generated.h"
+
+class FMatchmakingService;
+
+/**
+ * Owns the online session work of the game instance: hosting, matchmaking and the dedicated server session.
+ * The online subsystem is looked up a few frames after startup instead of in the first pawn constructor,
+ * or right away when a session call needs it earlier. Every call registers its completion delegate once
+ * and clears it when the call finishes, so repeated calls never stack callbacks.
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API UMatchSessionSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Hosts a FreeForAll lobby for the first local player and travels to LobbyMap once it exists */
+	UFUNCTION(BlueprintCallable, Category=Session)
+	void CreateGameSession();
+
+	/** Searches for a session through FMatchmakingService and travels to the one it joins, see bJoinDedicatedServers */
+	UFUNCTION(BlueprintCallable, Category=Session)
+	void JoinGameSession();
+
+	/** Advertises this dedicated server once per process, the session survives travelling between maps */
+	void RegisterDedicatedSession(int32 MaxPublicConnections, const FString& MatchType);
+
+	/** Looks up the online subsystem now if the deferred init hasn't run yet */
+	bool EnsureOnlineSubsystem();
+
+	FORCEINLINE bool IsOnlineReady() const { return SessionInterface.IsValid(); }
+	FORCEINLINE bool IsCreatingSession() const { return CreateSessionHandle.IsValid(); }
+
+	/** Null until the first JoinGameSession */
+	FORCEINLINE const FMatchmakingService* GetMatchmaking() const { return Matchmaking.Get(); }
+
+	void LogStats() const;
+
+protected:
+	/** Frames to wait after the game instance starts before the online subsystem is looked up */
+	UPROPERTY(Config)
+	int32 OnlineInitDelayFrames = 2;
+
+	/** Map the host travels to once its lobby session exists */
+	UPROPERTY(Config)
+	FString LobbyMap = TEXT("/Game/ThirdPerson/Maps/BattleMap_Lobby");
+
+	UPROPERTY(Config)
+	int32 LobbyPublicConnections = 4;
+
+	UPROPERTY(Config)
+	FString LobbyMatchType = TEXT("FreeForAll");
+
+	/** JoinGameSession looks for dedicated servers, which advertise without presence, instead of player hosted lobbies */
+	UPROPERTY(Config)
+	bool bJoinDedicatedServers = true;
+
+private:
+	bool TickDeferredInit(float DeltaTime);
+
+	/** Starts CreateSession with a delegate that is only registered for this call */
+	bool StartCreateSession(const FOnlineSessionSettings& Settings, bool bDedicated);
+	void OnCreateSessionComplete(FName SessionName, bool bWasSuccessful);
+	void OnMatchmakingFinished(bool bSuccess, const FString& ConnectAddress);
+
+	IOnlineSessionPtr SessionInterface;
+	TSharedPtr<FMatchmakingService> Matchmaking;
+
+	FTSTicker::FDelegateHandle DeferredInitHandle;
+	FDelegateHandle CreateSessionHandle;
+	bool bCreatingDedicated = false;
+	int32 FramesUntilInit = 0;
+
+	// When and how long the online subsystem lookup took, for before/after startup comparisons
+	double InitializeTime = 0.0;
+	double OnlineReadyTime = 0.0;
+	double OnlineLookupMs = 0.0;
+};
@@ -0,0 +1,526 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MatchmakingService.h"
+
+#include "MGNGDectectives.h"
+#include "HAL/IConsoleManager.h"
+
+namespace Matchmaking
+{
+	static const FName MatchTypeKey(TEXT("MatchType"));
+
+	/** Steam lobbies report no ping at all, they are still joinable but rank behind everything measured */
+	bool HasKnownPing(const FOnlineSessionSearchResult& Result)
+	{
+		return Result.PingInMs >= 0 && Result.PingInMs < MAX_QUERY_PING;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FOnlineSessionProvider
+
+FOnlineSessionProvider::FOnlineSessionProvider(IOnlineSessionPtr InSessions, FUniqueNetIdRepl InUserId)
+	: Sessions(InSessions)
+	, UserId(InUserId)
+{
+}
+
+FOnlineSessionProvider::~FOnlineSessionProvider()
+{
+	ClearDelegates();
+}
+
+bool FOnlineSessionProvider::FindSessions(const TSharedRef<FOnlineSessionSearch>& Search, const FOnFindSessionsCompleteDelegate& OnComplete)
+{
+	if (!Sessions.IsValid() || !UserId.IsValid())
+	{
+		return false;
+	}
+
+	Sessions->ClearOnFindSessionsCompleteDelegate_Handle(FindHandle);
+	PendingFind = OnComplete;
+	FindHandle = Sessions->AddOnFindSessionsCompleteDelegate_Handle(
+		FOnFindSessionsCompleteDelegate::CreateSP(this, &FOnlineSessionProvider::HandleFindSessionsComplete));
+
+	if (!Sessions->FindSessions(*UserId, Search))
+	{
+		Sessions->ClearOnFindSessionsCompleteDelegate_Handle(FindHandle);
+		PendingFind.Unbind();
+		return false;
+	}
+	return true;
+}
+
+void FOnlineSessionProvider::CancelFindSessions()
+{
+	if (Sessions.IsValid() && PendingFind.IsBound())
+	{
+		// Nobody waits for the cancelled search any more
+		Sessions->ClearOnFindSessionsCompleteDelegate_Handle(FindHandle);
+		PendingFind.Unbind();
+		Sessions->CancelFindSessions();
+	}
+}
+
+bool FOnlineSessionProvider::JoinSession(const FOnlineSessionSearchResult& Result, const FOnJoinSessionCompleteDelegate& OnComplete)
+{
+	if (!Sessions.IsValid() || !UserId.IsValid())
+	{
+		return false;
+	}
+
+	Sessions->ClearOnJoinSessionCompleteDelegate_Handle(JoinHandle);
+	PendingJoin = OnComplete;
+	JoinHandle = Sessions->AddOnJoinSessionCompleteDelegate_Handle(
+		FOnJoinSessionCompleteDelegate::CreateSP(this, &FOnlineSessionProvider::HandleJoinSessionComplete));
+
+	if (!Sessions->JoinSession(*UserId, NAME_GameSession, Result))
+	{
+		Sessions->ClearOnJoinSessionCompleteDelegate_Handle(JoinHandle);
+		PendingJoin.Unbind();
+		return false;
+	}
+	return true;
+}
+
+bool FOnlineSessionProvider::GetResolvedConnectString(FString& OutAddress) const
+{
+	return Sessions.IsValid() && Sessions->GetResolvedConnectString(NAME_GameSession, OutAddress);
+}
+
+void FOnlineSessionProvider::HandleFindSessionsComplete(bool bWasSuccessful)
+{
+	Sessions->ClearOnFindSessionsCompleteDelegate_Handle(FindHandle);
+	FOnFindSessionsCompleteDelegate Callback = MoveTemp(PendingFind);
+	PendingFind.Unbind();
+	Callback.ExecuteIfBound(bWasSuccessful);
+}
+
+void FOnlineSessionProvider::HandleJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
+{
+	Sessions->ClearOnJoinSessionCompleteDelegate_Handle(JoinHandle);
+	FOnJoinSessionCompleteDelegate Callback = MoveTemp(PendingJoin);
+	PendingJoin.Unbind();
+	Callback.ExecuteIfBound(SessionName, Result);
+}
+
+void FOnlineSessionProvider::ClearDelegates()
+{
+	if (Sessions.IsValid())
+	{
+		Sessions->ClearOnFindSessionsCompleteDelegate_Handle(FindHandle);
+		Sessions->ClearOnJoinSessionCompleteDelegate_Handle(JoinHandle);
+	}
+	PendingFind.Unbind();
+	PendingJoin.Unbind();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FFakeSessionProvider
+
+#if !UE_BUILD_SHIPPING
+FFakeSessionProvider::FFakeSessionProvider(int32 InNumSessions, float InResultsPerSecond, int32 InSeed)
+	: NumSessions(InNumSessions)
+	, ResultsPerSecond(FMath::Max(InResultsPerSecond, 1.0f))
+	, Random(InSeed)
+{
+}
+
+FFakeSessionProvider::~FFakeSessionProvider()
+{
+	StopTicking();
+}
+
+bool FFakeSessionProvider::FindSessions(const TSharedRef<FOnlineSessionSearch>& Search, const FOnFindSessionsCompleteDelegate& OnComplete)
+{
+	StopTicking();
+
+	ActiveSearch = Search;
+	ActiveSearch->SearchResults.Reset();
+	ActiveSearch->SearchState = EOnlineAsyncTaskState::InProgress;
+	PendingFind = OnComplete;
+	PendingResults = 0.0f;
+	NumDelivered = 0;
+
+	TickHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FFakeSessionProvider::Tick));
+	return true;
+}
+
+void FFakeSessionProvider::CancelFindSessions()
+{
+	StopTicking();
+	PendingFind.Unbind();
+	if (ActiveSearch.IsValid())
+	{
+		ActiveSearch->SearchState = EOnlineAsyncTaskState::Failed;
+		ActiveSearch.Reset();
+	}
+}
+
+bool FFakeSessionProvider::JoinSession(const FOnlineSessionSearchResult& Result, const FOnJoinSessionCompleteDelegate& OnComplete)
+{
+	JoinedAddress = FString::Printf(TEXT("127.0.0.1:%d"), 7777 + Result.Session.SessionSettings.BuildUniqueId % 100);
+	PendingJoin = OnComplete;
+
+	// Joins never complete inside the call on real subsystems either
+	FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSPLambda(this, [this](float)
+	{
+		FOnJoinSessionCompleteDelegate Callback = MoveTemp(PendingJoin);
+		PendingJoin.Unbind();
+		Callback.ExecuteIfBound(NAME_GameSession, EOnJoinSessionCompleteResult::Success);
+		return false;
+	}));
+	return true;
+}
+
+bool FFakeSessionProvider::GetResolvedConnectString(FString& OutAddress) const
+{
+	OutAddress = JoinedAddress;
+	return !JoinedAddress.IsEmpty();
+}
+
+bool FFakeSessionProvider::Tick(float DeltaTime)
+{
+	if (!ActiveSearch.IsValid())
+	{
+		TickHandle.Reset();
+		return false;
+	}
+
+	LLM_SCOPE_BYTAG(MGNG_Sessions);
+
+	PendingResults += DeltaTime * ResultsPerSecond;
+	const int32 Limit = FMath::Min(NumSessions, ActiveSearch->MaxSearchResults);
+	while (PendingResults >= 1.0f && NumDelivered < Limit)
+	{
+		PendingResults -= 1.0f;
+
+		FOnlineSessionSearchResult& Result = ActiveSearch->SearchResults.AddDefaulted_GetRef();
+		const int32 Slots = 4;
+		Result.PingInMs = Random.RandRange(10, 400);
+		Result.Session.OwningUserName = FString::Printf(TEXT("FakeHost%d"), NumDelivered);
+		Result.Session.SessionSettings.NumPublicConnections = Slots;
+		Result.Session.SessionSettings.BuildUniqueId = NumDelivered;
+		Result.Session.NumOpenPublicConnections = Random.RandRange(0, Slots);
+		Result.Session.SessionSettings.Set(Matchmaking::MatchTypeKey, FString(Random.FRand() < 0.7f ? TEXT("FreeForAll") : TEXT("Teams")), EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+		++NumDelivered;
+	}
+
+	if (NumDelivered < Limit)
+	{
+		return true;
+	}
+
+	ActiveSearch->SearchState = EOnlineAsyncTaskState::Done;
+	ActiveSearch.Reset();
+	TickHandle.Reset();
+
+	FOnFindSessionsCompleteDelegate Callback = MoveTemp(PendingFind);
+	PendingFind.Unbind();
+	Callback.ExecuteIfBound(true);
+	return false;
+}
+
+void FFakeSessionProvider::StopTicking()
+{
+	if (TickHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickHandle);
+		TickHandle.Reset();
+	}
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// FMatchmakingService
+
+double FMatchmakingMetrics::GetResultsPerSecond() const
+{
+	const double End = SearchEndTime > 0.0 ? SearchEndTime : FPlatformTime::Seconds();
+	const double Duration = End - SearchStartTime;
+	return Duration > 0.0 ? NumResultsSeen / Duration : 0.0;
+}
+
+FMatchmakingService::FMatchmakingService(TSharedRef<IMatchmakingSessionProvider> InProvider)
+	: Provider(InProvider)
+{
+}
+
+FMatchmakingService::~FMatchmakingService()
+{
+	if (TickHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickHandle);
+	}
+	if (bSearchRunning)
+	{
+		Provider->CancelFindSessions();
+	}
+}
+
+SIZE_T FMatchmakingService::GetSearchAllocatedSize() const
+{
+	if (!Search.IsValid())
+	{
+		return 0;
+	}
+
+	SIZE_T Size = sizeof(FOnlineSessionSearch) + Search->SearchResults.GetAllocatedSize() + Search->QuerySettings.SearchParams.GetAllocatedSize();
+	for (const FOnlineSessionSearchResult& Result : Search->SearchResults)
+	{
+		Size += Result.Session.OwningUserName.GetAllocatedSize() + Result.Session.SessionSettings.Settings.GetAllocatedSize();
+	}
+	return Size;
+}
+
+bool FMatchmakingService::Start(const FMatchmakingParams& InParams, const FOnMatchmakingFinished& InOnFinished)
+{
+	LLM_SCOPE_BYTAG(MGNG_Sessions);
+
+	if (IsBusy())
+	{
+		return false;
+	}
+
+	Params = InParams;
+	OnFinished = InOnFinished;
+	Metrics = FMatchmakingMetrics();
+	Metrics.SearchStartTime = FPlatformTime::Seconds();
+	NextResultIndex = 0;
+
+	Search = MakeShared<FOnlineSessionSearch>();
+	Search->MaxSearchResults = Params.MaxSearchResults;
+	Search->bIsLanQuery = Params.bIsLanQuery;
+	Search->QuerySettings.Set(SEARCH_PRESENCE, Params.bSearchPresence, EOnlineComparisonOp::Equals);
+
+	State = EState::Searching;
+	bSearchRunning = true;
+	if (!Provider->FindSessions(Search.ToSharedRef(), FOnFindSessionsCompleteDelegate::CreateSP(this, &FMatchmakingService::OnFindSessionsComplete)))
+	{
+		bSearchRunning = false;
+		Finish(false);
+		return false;
+	}
+
+	// The search may already have finished inside FindSessions
+	if (State != EState::Idle)
+	{
+		TickHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FMatchmakingService::Tick));
+	}
+	return true;
+}
+
+void FMatchmakingService::Cancel()
+{
+	if (State == EState::Searching && bSearchRunning)
+	{
+		Provider->CancelFindSessions();
+		bSearchRunning = false;
+	}
+	if (IsBusy())
+	{
+		Finish(false);
+	}
+}
+
+float FMatchmakingService::RankResult(const FOnlineSessionSearchResult& Result)
+{
+	// Ping decides in 20 ms steps, inside a step the session with more room wins
+	const int32 Ping = Matchmaking::HasKnownPing(Result) ? Result.PingInMs : MAX_QUERY_PING;
+	return FMath::FloorToFloat(Ping / 20.0f) * 100.0f - Result.Session.NumOpenPublicConnections;
+}
+
+bool FMatchmakingService::Tick(float DeltaTime)
+{
+	if (State == EState::Searching)
+	{
+		ProcessResults(Params.BatchSize);
+	}
+
+	if (State != EState::Idle && FPlatformTime::Seconds() - Metrics.SearchStartTime > Params.Timeout)
+	{
+		UE_LOG(LogMGNGDectectives, Warning, TEXT("Matchmaking timed out after %.1f s"), Params.Timeout);
+		Cancel();
+	}
+
+	if (State == EState::Idle)
+	{
+		TickHandle.Reset();
+		return false;
+	}
+	return true;
+}
+
+void FMatchmakingService::OnFindSessionsComplete(bool bWasSuccessful)
+{
+	bSearchRunning = false;
+	Metrics.SearchEndTime = FPlatformTime::Seconds();
+	if (State != EState::Searching)
+	{
+		return;
+	}
+
+	// Whatever is left arrived in the final update
+	while (State == EState::Searching && ProcessResults(Params.BatchSize))
+	{
+	}
+
+	if (State == EState::Searching)
+	{
+		UE_LOG(LogMGNGDectectives, Log, TEXT("Matchmaking found no acceptable session in %d results"), Metrics.NumResultsSeen);
+		Finish(false);
+	}
+}
+
+bool FMatchmakingService::ProcessResults(int32 MaxResults)
+{
+	const TArray<FOnlineSessionSearchResult>& Results = Search->SearchResults;
+	const int32 End = FMath::Min(Results.Num(), NextResultIndex + MaxResults);
+	if (NextResultIndex >= End)
+	{
+		return false;
+	}
+
+	if (Metrics.NumResultsSeen == 0)
+	{
+		Metrics.FirstResultTime = FPlatformTime::Seconds();
+	}
+	Metrics.PeakResultBytes = FMath::Max(Metrics.PeakResultBytes, GetSearchAllocatedSize());
+
+	int32 BestIndex = INDEX_NONE;
+	float BestRank = MAX_flt;
+	for (int32 Index = NextResultIndex; Index < End; ++Index)
+	{
+		const FOnlineSessionSearchResult& Result = Results[Index];
+		if (!IsAcceptable(Result))
+		{
+			++Metrics.NumResultsRejected;
+			continue;
+		}
+
+		const float Rank = RankResult(Result);
+		if (Rank < BestRank)
+		{
+			BestRank = Rank;
+			BestIndex = Index;
+		}
+	}
+	Metrics.NumResultsSeen += End - NextResultIndex;
+	NextResultIndex = End;
+
+	if (BestIndex != INDEX_NONE)
+	{
+		BeginJoin(Results[BestIndex]);
+	}
+	return true;
+}
+
+bool FMatchmakingService::IsAcceptable(const FOnlineSessionSearchResult& Result) const
+{
+	if (Matchmaking::HasKnownPing(Result) && Result.PingInMs > Params.MaxPingMs)
+	{
+		return false;
+	}
+	if (Result.Session.NumOpenPublicConnections < Params.MinFreeSlots)
+	{
+		return false;
+	}
+
+	FString MatchType;
+	Result.Session.SessionSettings.Get(Matchmaking::MatchTypeKey, MatchType);
+	return MatchType == Params.MatchType;
+}
+
+void FMatchmakingService::BeginJoin(const FOnlineSessionSearchResult& Result)
+{
+	State = EState::Joining;
+	Metrics.JoinStartTime = FPlatformTime::Seconds();
+
+	// Copy before cancelling, the provider may clear the search results
+	const FOnlineSessionSearchResult Chosen = Result;
+	if (bSearchRunning)
+	{
+		Provider->CancelFindSessions();
+		bSearchRunning = false;
+		Metrics.SearchEndTime = Metrics.JoinStartTime;
+	}
+
+	UE_LOG(LogMGNGDectectives, Log, TEXT("Matchmaking joining %s (%d ms, %d free) after %d results"),
+		*Chosen.Session.OwningUserName, Chosen.PingInMs, Chosen.Session.NumOpenPublicConnections, Metrics.NumResultsSeen);
+
+	if (!Provider->JoinSession(Chosen, FOnJoinSessionCompleteDelegate::CreateSP(this, &FMatchmakingService::OnJoinSessionComplete)))
+	{
+		Finish(false);
+	}
+}
+
+void FMatchmakingService::OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
+{
+	if (State != EState::Joining)
+	{
+		return;
+	}
+
+	FString Address;
+	if (Result == EOnJoinSessionCompleteResult::Success && Provider->GetResolvedConnectString(Address))
+	{
+		Metrics.bJoined = true;
+		Finish(true, Address);
+	}
+	else
+	{
+		UE_LOG(LogMGNGDectectives, Warning, TEXT("Matchmaking join failed (%s)"), LexToString(Result));
+		Finish(false);
+	}
+}
+
+void FMatchmakingService::Finish(bool bSuccess, const FString& ConnectAddress)
+{
+	State = EState::Idle;
+	Metrics.FinishTime = FPlatformTime::Seconds();
+	if (Metrics.SearchEndTime <= 0.0)
+	{
+		Metrics.SearchEndTime = Metrics.FinishTime;
+	}
+
+	UE_LOG(LogMGNGDectectives, Log, TEXT("Matchmaking %s: time to join %.3f s, %d results (%d rejected), %.1f results/s, results peaked at %.1f KB"),
+		bSuccess ? TEXT("joined") : TEXT("failed"), Metrics.GetTimeToJoin(), Metrics.NumResultsSeen, Metrics.NumResultsRejected, Metrics.GetResultsPerSecond(),
+		Metrics.PeakResultBytes / 1024.0);
+
+	Search.Reset();
+	FOnMatchmakingFinished Callback = MoveTemp(OnFinished);
+	OnFinished.Unbind();
+	Callback.ExecuteIfBound(bSuccess, ConnectAddress);
+}
+
+#if !UE_BUILD_SHIPPING
+namespace Matchmaking
+{
+	static TSharedPtr<FMatchmakingService> FakeSearchService;
+
+	void RunFakeSearch(const TArray<FString>& Args)
+	{
+		const int32 NumSessions = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 500;
+		const float ResultsPerSecond = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 200.0f;
+		const int32 Seed = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 0;
+
+		if (FakeSearchService.IsValid())
+		{
+			FakeSearchService->Cancel();
+		}
+
+		FakeSearchService = MakeShared<FMatchmakingService>(MakeShared<FFakeSessionProvider>(NumSessions, ResultsPerSecond, Seed));
+		FakeSearchService->Start(FMatchmakingParams(), FOnMatchmakingFinished::CreateLambda([](bool bSuccess, const FString& Address)
+		{
+			UE_LOG(LogMGNGDectectives, Display, TEXT("Fake matchmaking finished: %s %s"), bSuccess ? TEXT("would travel to") : TEXT("no session"), *Address);
+		}));
+	}
+}
+
+static FAutoConsoleCommand MatchmakingFakeSearchCommand(
+	TEXT("mgng.Matchmaking.FakeSearch"),
+	TEXT("Runs matchmaking against a local fake session provider and logs time-to-join and results/s. Args: [NumSessions=500] [ResultsPerSecond=200] [Seed=0]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&Matchmaking::RunFakeSearch)
+);
+#endif
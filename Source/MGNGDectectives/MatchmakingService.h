@@ -0,0 +1,186 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "GameFramework/OnlineReplStructs.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "OnlineSessionSettings.h"
+
+/** The few session calls matchmaking needs, so a search can run against something other than the online subsystem */
+class MGNGDECTECTIVES_API IMatchmakingSessionProvider
+{
+public:
+	virtual ~IMatchmakingSessionProvider() {}
+
+	/** Results are appended to Search->SearchResults while the search runs, OnComplete fires once it stops */
+	virtual bool FindSessions(const TSharedRef<FOnlineSessionSearch>& Search, const FOnFindSessionsCompleteDelegate& OnComplete) = 0;
+	virtual void CancelFindSessions() = 0;
+	virtual bool JoinSession(const FOnlineSessionSearchResult& Result, const FOnJoinSessionCompleteDelegate& OnComplete) = 0;
+	virtual bool GetResolvedConnectString(FString& OutAddress) const = 0;
+};
+
+/** Forwards to the session interface of an online subsystem, registering each completion delegate only for its call */
+class MGNGDECTECTIVES_API FOnlineSessionProvider : public IMatchmakingSessionProvider, public TSharedFromThis<FOnlineSessionProvider>
+{
+public:
+	FOnlineSessionProvider(IOnlineSessionPtr InSessions, FUniqueNetIdRepl InUserId);
+	virtual ~FOnlineSessionProvider();
+
+	virtual bool FindSessions(const TSharedRef<FOnlineSessionSearch>& Search, const FOnFindSessionsCompleteDelegate& OnComplete) override;
+	virtual void CancelFindSessions() override;
+	virtual bool JoinSession(const FOnlineSessionSearchResult& Result, const FOnJoinSessionCompleteDelegate& OnComplete) override;
+	virtual bool GetResolvedConnectString(FString& OutAddress) const override;
+
+private:
+	void HandleFindSessionsComplete(bool bWasSuccessful);
+	void HandleJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result);
+	void ClearDelegates();
+
+	IOnlineSessionPtr Sessions;
+	FUniqueNetIdRepl UserId;
+
+	FOnFindSessionsCompleteDelegate PendingFind;
+	FOnJoinSessionCompleteDelegate PendingJoin;
+	FDelegateHandle FindHandle;
+	FDelegateHandle JoinHandle;
+};
+
+#if !UE_BUILD_SHIPPING
+/** Local stand-in that streams made-up sessions in over time, used by mgng.Matchmaking.FakeSearch */
+class MGNGDECTECTIVES_API FFakeSessionProvider : public IMatchmakingSessionProvider, public TSharedFromThis<FFakeSessionProvider>
+{
+public:
+	FFakeSessionProvider(int32 InNumSessions, float InResultsPerSecond, int32 InSeed);
+	virtual ~FFakeSessionProvider();
+
+	virtual bool FindSessions(const TSharedRef<FOnlineSessionSearch>& Search, const FOnFindSessionsCompleteDelegate& OnComplete) override;
+	virtual void CancelFindSessions() override;
+	virtual bool JoinSession(const FOnlineSessionSearchResult& Result, const FOnJoinSessionCompleteDelegate& OnComplete) override;
+	virtual bool GetResolvedConnectString(FString& OutAddress) const override;
+
+private:
+	bool Tick(float DeltaTime);
+	void StopTicking();
+
+	int32 NumSessions;
+	float ResultsPerSecond;
+	FRandomStream Random;
+
+	TSharedPtr<FOnlineSessionSearch> ActiveSearch;
+	FOnFindSessionsCompleteDelegate PendingFind;
+	FOnJoinSessionCompleteDelegate PendingJoin;
+	FTSTicker::FDelegateHandle TickHandle;
+	float PendingResults = 0.0f;
+	int32 NumDelivered = 0;
+	FString JoinedAddress;
+};
+#endif
+
+struct FMatchmakingParams
+{
+	/** Value of the MatchType session setting we want to play */
+	FString MatchType = TEXT("FreeForAll");
+
+	/** Upper bound for one search, the search is cancelled as soon as something acceptable shows up */
+	int32 MaxSearchResults = 200;
+
+	/** Results ranked per tick while the search is still running */
+	int32 BatchSize = 16;
+
+	/** Sessions above this ping are never joined */
+	int32 MaxPingMs = 150;
+
+	/** Sessions with fewer open public slots are never joined */
+	int32 MinFreeSlots = 1;
+
+	/** Gives up when neither the search nor the join finished after this many seconds */
+	float Timeout = 15.0f;
+
+	bool bIsLanQuery = false;
+
+	/** Player hosted lobbies are found through presence, dedicated servers only without it */
+	bool bSearchPresence = true;
+};
+
+struct FMatchmakingMetrics
+{
+	double SearchStartTime = 0.0;
+	double FirstResultTime = 0.0;
+	double SearchEndTime = 0.0;
+	double JoinStartTime = 0.0;
+	double FinishTime = 0.0;
+	int32 NumResultsSeen = 0;
+	int32 NumResultsRejected = 0;
+	bool bJoined = false;
+
+	/** Most memory the search results held at once */
+	SIZE_T PeakResultBytes = 0;
+
+	/** Seconds from starting the search until the join finished, negative when nothing was joined */
+	double GetTimeToJoin() const { return bJoined ? FinishTime - SearchStartTime : -1.0; }
+
+	/** Rate the provider delivered results at until the search stopped */
+	double GetResultsPerSecond() const;
+};
+
+DECLARE_DELEGATE_TwoParams(FOnMatchmakingFinished, bool /*bSuccess*/, const FString& /*ConnectAddress*/);
+
+/**
+ * Searches for a session to join without waiting for the whole search to finish.
+ * Results are ranked in batches as they arrive; the best acceptable one of the first batch that has any is joined
+ * and the rest of the search is cancelled, so one search never starts more than one join.
+ */
+class MGNGDECTECTIVES_API FMatchmakingService : public TSharedFromThis<FMatchmakingService>
+{
+public:
+	explicit FMatchmakingService(TSharedRef<IMatchmakingSessionProvider> InProvider);
+	~FMatchmakingService();
+
+	bool Start(const FMatchmakingParams& InParams, const FOnMatchmakingFinished& InOnFinished);
+	void Cancel();
+
+	bool IsBusy() const { return State != EState::Idle; }
+	const FMatchmakingMetrics& GetMetrics() const { return Metrics; }
+
+	int32 GetNumSearchResults() const { return Search.IsValid() ? Search->SearchResults.Num() : 0; }
+
+	/**
+	 * Heap memory of the running search's results and their settings, 0 between searches.
+	 * The online subsystem's own session info behind each result is opaque and not counted.
+	 */
+	SIZE_T GetSearchAllocatedSize() const;
+
+	/** Lower is better, only meaningful for results that pass IsAcceptable */
+	static float RankResult(const FOnlineSessionSearchResult& Result);
+
+private:
+	enum class EState : uint8
+	{
+		Idle,
+		Searching,
+		Joining,
+	};
+
+	bool Tick(float DeltaTime);
+	void OnFindSessionsComplete(bool bWasSuccessful);
+	void OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result);
+
+	/** Ranks up to MaxResults new results and starts the join if one of them is good enough */
+	bool ProcessResults(int32 MaxResults);
+	bool IsAcceptable(const FOnlineSessionSearchResult& Result) const;
+	void BeginJoin(const FOnlineSessionSearchResult& Result);
+	void Finish(bool bSuccess, const FString& ConnectAddress = FString());
+
+	TSharedRef<IMatchmakingSessionProvider> Provider;
+	FMatchmakingParams Params;
+	FOnMatchmakingFinished OnFinished;
+	FMatchmakingMetrics Metrics;
+
+	TSharedPtr<FOnlineSessionSearch> Search;
+	FTSTicker::FDelegateHandle TickHandle;
+	int32 NextResultIndex = 0;
+	bool bSearchRunning = false;
+	EState State = EState::Idle;
+};
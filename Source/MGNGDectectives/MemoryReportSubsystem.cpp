@@ -0,0 +1,289 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MemoryReportSubsystem.h"
+
+#include "MGNGDectectives.h"
+#include "ExplosionEffectsSubsystem.h"
+#include "Granade.h"
+#include "ItemActor.h"
+#include "MatchmakingService.h"
+#include "MatchSessionSubsystem.h"
+#include "MGNGDectectivesCharacter.h"
+#include "ProjectileManagerSubsystem.h"
+#include "RagdollStateComponent.h"
+#include "EngineUtils.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "PhysicsEngine/ConstraintInstance.h"
+#include "Serialization/ArchiveCountMem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Memory Report Sample"), STAT_MemoryReportSample, STATGROUP_MGNGDectectives);
+DECLARE_MEMORY_STAT(TEXT("Granades Memory"), STAT_GranadesMemory, STATGROUP_MGNGDectectives);
+DECLARE_MEMORY_STAT(TEXT("Projectiles Memory"), STAT_ProjectilesMemory, STATGROUP_MGNGDectectives);
+DECLARE_MEMORY_STAT(TEXT("Pickups Memory"), STAT_PickupsMemory, STATGROUP_MGNGDectectives);
+DECLARE_MEMORY_STAT(TEXT("Sessions Memory"), STAT_SessionsMemory, STATGROUP_MGNGDectectives);
+DECLARE_MEMORY_STAT(TEXT("Ragdolls Memory"), STAT_RagdollsMemory, STATGROUP_MGNGDectectives);
+DECLARE_MEMORY_STAT(TEXT("Effects Memory"), STAT_EffectsMemory, STATGROUP_MGNGDectectives);
+
+static FAutoConsoleCommandWithWorldAndArgs MemoryReportCommand(
+	TEXT("mgng.Memory.Report"),
+	TEXT("Measures every gameplay feature now and logs its memory and high-water mark. Args: [reset]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UMemoryReportSubsystem* Memory = World ? World->GetSubsystem<UMemoryReportSubsystem>() : nullptr)
+		{
+			Memory->Sample();
+			Memory->LogReport();
+			Memory->CheckBudgets();
+			if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+			{
+				Memory->ResetPeaks();
+			}
+		}
+	})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs MemoryTrackCommand(
+	TEXT("mgng.Memory.Track"),
+	TEXT("Samples the per-feature memory every few seconds so the high-water marks catch short peaks. Args: 0|1"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UMemoryReportSubsystem* Memory = World ? World->GetSubsystem<UMemoryReportSubsystem>() : nullptr)
+		{
+			Memory->SetTracking(Args.Num() > 0 ? FCString::Atoi(*Args[0]) != 0 : !Memory->IsTracking());
+		}
+	})
+);
+
+bool UMemoryReportSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UMemoryReportSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMemoryReportSubsystem, STATGROUP_Tickables);
+}
+
+void UMemoryReportSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	float CommandLineBudget = 0.0f;
+	if (FParse::Value(FCommandLine::Get(), TEXT("MGNGMemoryBudgetMB="), CommandLineBudget))
+	{
+		MaxPeakUsedPhysicalMB = CommandLineBudget;
+	}
+}
+
+const TCHAR* UMemoryReportSubsystem::GetFeatureName(EMemoryFeature Feature)
+{
+	switch (Feature)
+	{
+	case EMemoryFeature::Granades:		return TEXT("Granades");
+	case EMemoryFeature::Projectiles:	return TEXT("Projectiles");
+	case EMemoryFeature::Pickups:		return TEXT("Pickups");
+	case EMemoryFeature::Sessions:		return TEXT("Sessions");
+	case EMemoryFeature::Ragdolls:		return TEXT("Ragdolls");
+	case EMemoryFeature::Effects:		return TEXT("Effects");
+	default:							return TEXT("Unknown");
+	}
+}
+
+void UMemoryReportSubsystem::SetTracking(bool bInTracking)
+{
+	if (bTracking == bInTracking)
+	{
+		return;
+	}
+
+	bTracking = bInTracking;
+	SinceSample = 0.0f;
+	if (bTracking)
+	{
+		Sample();
+	}
+}
+
+void UMemoryReportSubsystem::Tick(float DeltaTime)
+{
+	SinceSample += DeltaTime;
+	if (SinceSample >= SampleInterval)
+	{
+		SinceSample = 0.0f;
+		Sample();
+	}
+}
+
+int64 UMemoryReportSubsystem::MeasureObject(const UObject* Object)
+{
+	if (Object == nullptr)
+	{
+		return 0;
+	}
+
+	// Counting only reads, the archive just isn't declared for const objects
+	FArchiveCountMem Count(const_cast<UObject*>(Object));
+	return static_cast<int64>(Count.GetMax());
+}
+
+int64 UMemoryReportSubsystem::MeasureActor(const AActor* Actor)
+{
+	int64 Bytes = MeasureObject(Actor);
+	for (const UActorComponent* Component : Actor->GetComponents())
+	{
+		Bytes += MeasureObject(Component);
+	}
+	return Bytes;
+}
+
+void UMemoryReportSubsystem::SetFeature(EMemoryFeature Feature, int32 Count, int64 Bytes)
+{
+	const int32 Index = static_cast<int32>(Feature);
+	Current[Index].Count = Count;
+	Current[Index].Bytes = Bytes;
+	Peak[Index].Count = FMath::Max(Peak[Index].Count, Count);
+	Peak[Index].Bytes = FMath::Max(Peak[Index].Bytes, Bytes);
+}
+
+void UMemoryReportSubsystem::Sample()
+{
+	SCOPE_CYCLE_COUNTER(STAT_MemoryReportSample);
+
+	UWorld* World = GetWorld();
+
+	// Pooled grenades parked out of sight are still held, so they count
+	int32 NumGranades = 0;
+	int64 GranadeBytes = 0;
+	for (TActorIterator<AGranade> It(World); It; ++It)
+	{
+		++NumGranades;
+		GranadeBytes += MeasureActor(*It);
+	}
+	SetFeature(EMemoryFeature::Granades, NumGranades, GranadeBytes);
+
+	const UProjectileManagerSubsystem* Projectiles = World->GetSubsystem<UProjectileManagerSubsystem>();
+	SetFeature(EMemoryFeature::Projectiles, Projectiles ? Projectiles->GetNumProjectiles() : 0, Projectiles ? static_cast<int64>(Projectiles->GetAllocatedSize()) : 0);
+
+	int32 NumPickups = 0;
+	int64 PickupBytes = 0;
+	for (TActorIterator<AItemActor> It(World); It; ++It)
+	{
+		++NumPickups;
+		PickupBytes += MeasureActor(*It);
+	}
+	SetFeature(EMemoryFeature::Pickups, NumPickups, PickupBytes);
+
+	const UGameInstance* GameInstance = World->GetGameInstance();
+	const UMatchSessionSubsystem* Sessions = GameInstance ? GameInstance->GetSubsystem<UMatchSessionSubsystem>() : nullptr;
+	const FMatchmakingService* Matchmaking = Sessions ? Sessions->GetMatchmaking() : nullptr;
+	SetFeature(EMemoryFeature::Sessions, Matchmaking ? Matchmaking->GetNumSearchResults() : 0, Matchmaking ? static_cast<int64>(Matchmaking->GetSearchAllocatedSize()) : 0);
+
+	// A character's mesh keeps its bodies either way, ragdolling is what fills them with simulated state
+	int32 NumRagdolls = 0;
+	int64 RagdollBytes = 0;
+	for (TActorIterator<AMGNGDectectivesCharacter> It(World); It; ++It)
+	{
+		const URagdollStateComponent* RagdollState = It->GetRagdollState();
+		const USkeletalMeshComponent* Mesh = It->GetMesh();
+		if (RagdollState == nullptr || !RagdollState->IsRagdoll() || Mesh == nullptr)
+		{
+			continue;
+		}
+
+		++NumRagdolls;
+		RagdollBytes += Mesh->Bodies.GetAllocatedSize() + Mesh->Bodies.Num() * sizeof(FBodyInstance)
+			+ Mesh->Constraints.GetAllocatedSize() + Mesh->Constraints.Num() * sizeof(FConstraintInstance);
+	}
+	SetFeature(EMemoryFeature::Ragdolls, NumRagdolls, RagdollBytes);
+
+	const UExplosionEffectsSubsystem* Effects = World->GetSubsystem<UExplosionEffectsSubsystem>();
+	const AActor* EffectsHost = Effects ? Effects->GetPoolHost() : nullptr;
+	SetFeature(EMemoryFeature::Effects, Effects ? Effects->GetNumPooled() : 0, EffectsHost ? MeasureActor(EffectsHost) : 0);
+
+	SET_MEMORY_STAT(STAT_GranadesMemory, GranadeBytes);
+	SET_MEMORY_STAT(STAT_ProjectilesMemory, Current[static_cast<int32>(EMemoryFeature::Projectiles)].Bytes);
+	SET_MEMORY_STAT(STAT_PickupsMemory, PickupBytes);
+	SET_MEMORY_STAT(STAT_SessionsMemory, Current[static_cast<int32>(EMemoryFeature::Sessions)].Bytes);
+	SET_MEMORY_STAT(STAT_RagdollsMemory, RagdollBytes);
+	SET_MEMORY_STAT(STAT_EffectsMemory, Current[static_cast<int32>(EMemoryFeature::Effects)].Bytes);
+
+	PeakTotalBytes = FMath::Max(PeakTotalBytes, GetTotalBytes());
+	PeakUsedPhysical = FMath::Max<uint64>(PeakUsedPhysical, FPlatformMemory::GetStats().UsedPhysical);
+}
+
+void UMemoryReportSubsystem::ResetPeaks()
+{
+	for (int32 Index = 0; Index < static_cast<int32>(EMemoryFeature::Num); ++Index)
+	{
+		Peak[Index] = Current[Index];
+	}
+	PeakTotalBytes = GetTotalBytes();
+	PeakUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+}
+
+int64 UMemoryReportSubsystem::GetTotalBytes() const
+{
+	int64 Total = 0;
+	for (const FFeatureMemory& Feature : Current)
+	{
+		Total += Feature.Bytes;
+	}
+	return Total;
+}
+
+int64 UMemoryReportSubsystem::GetPeakTotalBytes() const
+{
+	return PeakTotalBytes;
+}
+
+bool UMemoryReportSubsystem::CheckBudgets() const
+{
+	bool bWithinBudget = true;
+	for (const FFeatureMemoryBudget& Budget : Budgets)
+	{
+		for (int32 Index = 0; Index < static_cast<int32>(EMemoryFeature::Num); ++Index)
+		{
+			if (Budget.Feature != FName(GetFeatureName(static_cast<EMemoryFeature>(Index))) || Budget.MaxPeakMB <= 0.0f)
+			{
+				continue;
+			}
+
+			const double PeakMB = Peak[Index].Bytes / (1024.0 * 1024.0);
+			if (PeakMB > Budget.MaxPeakMB)
+			{
+				UE_LOG(LogMGNGDectectives, Error, TEXT("Memory budget exceeded: %s peaked at %.2f MB, budget %.2f MB"), *Budget.Feature.ToString(), PeakMB, Budget.MaxPeakMB);
+				bWithinBudget = false;
+			}
+		}
+	}
+
+	const double PeakPhysicalMB = PeakUsedPhysical / (1024.0 * 1024.0);
+	if (MaxPeakUsedPhysicalMB > 0.0f && PeakPhysicalMB > MaxPeakUsedPhysicalMB)
+	{
+		UE_LOG(LogMGNGDectectives, Error, TEXT("Memory budget exceeded: process peaked at %.1f MB used physical, budget %.1f MB"), PeakPhysicalMB, MaxPeakUsedPhysicalMB);
+		bWithinBudget = false;
+	}
+	return bWithinBudget;
+}
+
+void UMemoryReportSubsystem::LogReport() const
+{
+	UE_LOG(LogMGNGDectectives, Display, TEXT("Gameplay memory in %s:"), *GetWorld()->GetMapName());
+	UE_LOG(LogMGNGDectectives, Display, TEXT("  %-12s %6s %10s %10s %10s"), TEXT("Feature"), TEXT("Count"), TEXT("Now KB"), TEXT("Peak"), TEXT("Peak KB"));
+	for (int32 Index = 0; Index < static_cast<int32>(EMemoryFeature::Num); ++Index)
+	{
+		UE_LOG(LogMGNGDectectives, Display, TEXT("  %-12s %6d %10.1f %10d %10.1f"), GetFeatureName(static_cast<EMemoryFeature>(Index)),
+			Current[Index].Count, Current[Index].Bytes / 1024.0, Peak[Index].Count, Peak[Index].Bytes / 1024.0);
+	}
+
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	UE_LOG(LogMGNGDectectives, Display, TEXT("  Total %.1f KB, peak %.1f KB. Process %.1f MB used physical, peak %.1f MB while tracked, %.1f MB since start"),
+		GetTotalBytes() / 1024.0, PeakTotalBytes / 1024.0, MemoryStats.UsedPhysical / (1024.0 * 1024.0),
+		PeakUsedPhysical / (1024.0 * 1024.0), MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0));
+}
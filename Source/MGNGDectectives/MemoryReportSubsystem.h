@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MemoryReportSubsystem.generated.h"
+
+/** Gameplay features memory is attributed to, same split as the MGNG/<Feature> LLM tags */
+enum class EMemoryFeature : uint8
+{
+	Granades,
+	Projectiles,
+	Pickups,
+	Sessions,
+	Ragdolls,
+	Effects,
+	Num
+};
+
+/** Peak memory one feature may reach during a run */
+USTRUCT()
+struct FFeatureMemoryBudget
+{
+	GENERATED_BODY()
+
+	/** Granades, Projectiles, Pickups, Sessions, Ragdolls or Effects */
+	UPROPERTY()
+	FName Feature;
+
+	UPROPERTY()
+	float MaxPeakMB = 0.0f;
+};
+
+/**
+ * Measures what each gameplay feature holds: live AGranade actors with their components, the batched projectile
+ * buffers, AItemActor pickups, the running session search's results, the physics bodies of ragdolled characters
+ * and the pooled explosion effects. Object memory is what FArchiveCountMem finds, so engine side allocations
+ * behind a component (physics scene, audio voices) only show up under the LLM tags, run with -llm for those.
+ *
+ * mgng.Memory.Report prints the breakdown with high-water marks, mgng.Memory.Track samples every SampleInterval.
+ * The gameplay benchmark tracks while it runs and, once done, checks the peaks against Budgets and
+ * MaxPeakUsedPhysicalMB (or -MGNGMemoryBudgetMB=); an unattended run that went over exits with code 1.
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API UMemoryReportSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override { return bTracking; }
+
+	void SetTracking(bool bInTracking);
+	FORCEINLINE bool IsTracking() const { return bTracking; }
+
+	/** Measures every feature now and raises the high-water marks */
+	void Sample();
+	void ResetPeaks();
+
+	/** Sum of every feature at the last sample and its high-water mark */
+	int64 GetTotalBytes() const;
+	int64 GetPeakTotalBytes() const;
+
+	/** Logs each budget the peaks went over, false if any was */
+	bool CheckBudgets() const;
+
+	void LogReport() const;
+
+	static const TCHAR* GetFeatureName(EMemoryFeature Feature);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Seconds between two samples while tracking */
+	UPROPERTY(Config)
+	float SampleInterval = 1.0f;
+
+	UPROPERTY(Config)
+	TArray<FFeatureMemoryBudget> Budgets;
+
+	/** Peak used physical memory of the whole process, 0 for no limit */
+	UPROPERTY(Config)
+	float MaxPeakUsedPhysicalMB = 0.0f;
+
+private:
+	struct FFeatureMemory
+	{
+		int32 Count = 0;
+		int64 Bytes = 0;
+	};
+
+	/** The object's own properties and the containers they own, what "obj list" would show for it */
+	static int64 MeasureObject(const UObject* Object);
+
+	/** The actor and every component it owns */
+	static int64 MeasureActor(const AActor* Actor);
+
+	void SetFeature(EMemoryFeature Feature, int32 Count, int64 Bytes);
+
+	FFeatureMemory Current[static_cast<int32>(EMemoryFeature::Num)];
+	FFeatureMemory Peak[static_cast<int32>(EMemoryFeature::Num)];
+	int64 PeakTotalBytes = 0;
+	uint64 PeakUsedPhysical = 0;
+
+	bool bTracking = false;
+	float SinceSample = 0.0f;
+};
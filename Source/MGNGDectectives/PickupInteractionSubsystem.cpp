@@ -0,0 +1,336 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PickupInteractionSubsystem.h"
+
+#include "ItemActor.h"
+#include "MGNGDectectives.h"
+#include "MGNGDectectivesCharacter.h"
+#include "PickupStateReplicator.h"
+#include "Engine/World.h"
+
+bool UPickupInteractionSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPickupInteractionSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (InWorld.GetNetMode() != NM_Client && InWorld.GetNetMode() != NM_Standalone)
+	{
+		// Clients get the replicator from the server, it registers itself in BeginPlay
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		InWorld.SpawnActor<APickupStateReplicator>(SpawnParams);
+	}
+}
+
+void UPickupInteractionSubsystem::Deinitialize()
+{
+	ItemsById.Empty();
+	StateReplicator = nullptr;
+	Cells.Empty();
+	ItemCells.Empty();
+	Candidates.Empty();
+	PooledItems.Empty();
+	NumRegisteredItems = 0;
+
+	Super::Deinitialize();
+}
+
+FIntVector UPickupInteractionSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / CellSize),
+		FMath::FloorToInt(Location.Y / CellSize),
+		FMath::FloorToInt(Location.Z / CellSize)
+	);
+}
+
+void UPickupInteractionSubsystem::RegisterItem(AItemActor* Item, bool bFromReplication)
+{
+	if (Item == nullptr || ItemCells.Contains(Item))
+	{
+		return;
+	}
+
+	LLM_SCOPE_BYTAG(MGNG_Pickups);
+
+	if (Item->GetPieceId() == 0 && Item->HasAuthority())
+	{
+		Item->SetPieceId(NextRuntimePieceId++);
+	}
+	if (Item->GetPieceId() != 0)
+	{
+		ItemsById.Add(Item->GetPieceId(), Item);
+	}
+
+	// The server may have said this piece is gone before the client had loaded it
+	if (!bFromReplication && !Item->HasAuthority() && IsPieceCollected(Item->GetPieceId()))
+	{
+		Item->SetAvailable(false);
+		return;
+	}
+
+	const FIntVector Cell = GetCell(Item->GetActorLocation());
+	Cells.FindOrAdd(Cell).Add(Item);
+	ItemCells.Add(Item, Cell);
+	++NumRegisteredItems;
+}
+
+void UPickupInteractionSubsystem::UnregisterItem(AItemActor* Item)
+{
+	FIntVector Cell;
+	if (!ItemCells.RemoveAndCopyValue(Item, Cell))
+	{
+		return;
+	}
+
+	if (TArray<TWeakObjectPtr<AItemActor>>* CellItems = Cells.Find(Cell))
+	{
+		CellItems->RemoveSwap(Item);
+		if (CellItems->Num() == 0)
+		{
+			Cells.Remove(Cell);
+		}
+	}
+	--NumRegisteredItems;
+
+	// Nobody can keep pointing at an item that left play
+	for (TPair<TWeakObjectPtr<AMGNGDectectivesCharacter>, TArray<TWeakObjectPtr<AItemActor>>>& Pair : Candidates)
+	{
+		if (Pair.Value.RemoveSwap(Item) > 0 && Pair.Key.IsValid())
+		{
+			RefreshCharacter(Pair.Key.Get());
+		}
+	}
+}
+
+void UPickupInteractionSubsystem::ForgetItem(AItemActor* Item)
+{
+	UnregisterItem(Item);
+	if (Item != nullptr && Item->GetPieceId() != 0)
+	{
+		ItemsById.Remove(Item->GetPieceId());
+	}
+}
+
+void UPickupInteractionSubsystem::SetStateReplicator(APickupStateReplicator* InReplicator)
+{
+	if (InReplicator == nullptr || StateReplicator == nullptr || InReplicator == StateReplicator)
+	{
+		StateReplicator = InReplicator;
+	}
+}
+
+bool UPickupInteractionSubsystem::IsPieceCollected(uint32 PieceId) const
+{
+	return StateReplicator != nullptr && PieceId != 0 && StateReplicator->IsCollected(PieceId);
+}
+
+void UPickupInteractionSubsystem::ApplyPieceState(uint32 PieceId, bool bCollected)
+{
+	const TWeakObjectPtr<AItemActor>* WeakItem = ItemsById.Find(PieceId);
+	AItemActor* Item = WeakItem != nullptr ? WeakItem->Get() : nullptr;
+	if (Item == nullptr)
+	{
+		// RegisterItem checks the replicator once the piece shows up
+		return;
+	}
+
+	if (bCollected)
+	{
+		UnregisterItem(Item);
+		Item->SetAvailable(false);
+	}
+	else
+	{
+		Item->SetAvailable(true);
+		RegisterItem(Item, true);
+	}
+}
+
+void UPickupInteractionSubsystem::AddCandidate(AMGNGDectectivesCharacter* Character, AItemActor* Item)
+{
+	Candidates.FindOrAdd(Character).AddUnique(Item);
+	RefreshCharacter(Character);
+}
+
+void UPickupInteractionSubsystem::RemoveCandidate(AMGNGDectectivesCharacter* Character, AItemActor* Item)
+{
+	if (TArray<TWeakObjectPtr<AItemActor>>* CharacterCandidates = Candidates.Find(Character))
+	{
+		CharacterCandidates->RemoveSwap(Item);
+		if (CharacterCandidates->Num() == 0)
+		{
+			Candidates.Remove(Character);
+		}
+	}
+	RefreshCharacter(Character);
+}
+
+AItemActor* UPickupInteractionSubsystem::FindBestPickup(const AMGNGDectectivesCharacter* Character) const
+{
+	if (Character == nullptr)
+	{
+		return nullptr;
+	}
+
+	const FVector Location = Character->GetActorLocation();
+	AItemActor* Best = nullptr;
+	float BestDistanceSquared = MAX_flt;
+
+	auto Consider = [&Best, &BestDistanceSquared, &Location](const TWeakObjectPtr<AItemActor>& WeakItem, float MaxDistanceSquared)
+	{
+		AItemActor* Item = WeakItem.Get();
+		if (Item == nullptr || !Item->IsAvailable())
+		{
+			return;
+		}
+		const float DistanceSquared = FVector::DistSquared(Location, Item->GetActorLocation());
+		if (DistanceSquared <= MaxDistanceSquared && DistanceSquared < BestDistanceSquared)
+		{
+			Best = Item;
+			BestDistanceSquared = DistanceSquared;
+		}
+	};
+
+	// Overlapping pickups always count, however big their collision box is. Weak pointer keys don't take const pointers
+	const TWeakObjectPtr<AMGNGDectectivesCharacter> CharacterKey(const_cast<AMGNGDectectivesCharacter*>(Character));
+	if (const TArray<TWeakObjectPtr<AItemActor>>* CharacterCandidates = Candidates.Find(CharacterKey))
+	{
+		for (const TWeakObjectPtr<AItemActor>& Item : *CharacterCandidates)
+		{
+			Consider(Item, MAX_flt);
+		}
+	}
+
+	// With PickupReach <= CellSize this visits at most 8 cells
+	const float ReachSquared = FMath::Square(PickupReach);
+	const FIntVector MinCell = GetCell(Location - FVector(PickupReach));
+	const FIntVector MaxCell = GetCell(Location + FVector(PickupReach));
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+			{
+				if (const TArray<TWeakObjectPtr<AItemActor>>* CellItems = Cells.Find(FIntVector(X, Y, Z)))
+				{
+					for (const TWeakObjectPtr<AItemActor>& Item : *CellItems)
+					{
+						Consider(Item, ReachSquared);
+					}
+				}
+			}
+		}
+	}
+
+	return Best;
+}
+
+AItemActor* UPickupInteractionSubsystem::FindItem(uint32 PieceId) const
+{
+	const TWeakObjectPtr<AItemActor>* WeakItem = ItemsById.Find(PieceId);
+	return WeakItem != nullptr ? WeakItem->Get() : nullptr;
+}
+
+bool UPickupInteractionSubsystem::CanCollect(const AMGNGDectectivesCharacter* Character, const AItemActor* Item, float Tolerance) const
+{
+	// Weak pointer keys don't take const pointers
+	const TWeakObjectPtr<AItemActor> ItemKey(const_cast<AItemActor*>(Item));
+	if (Character == nullptr || !IsValid(Item) || !Item->IsAvailable() || !ItemCells.Contains(ItemKey))
+	{
+		return false;
+	}
+
+	// Overlapping counts whatever the distance, the client saw the same overlap a moment ago
+	const TWeakObjectPtr<AMGNGDectectivesCharacter> CharacterKey(const_cast<AMGNGDectectivesCharacter*>(Character));
+	if (const TArray<TWeakObjectPtr<AItemActor>>* CharacterCandidates = Candidates.Find(CharacterKey))
+	{
+		if (CharacterCandidates->Contains(ItemKey))
+		{
+			return true;
+		}
+	}
+	return FVector::DistSquared(Character->GetActorLocation(), Item->GetActorLocation()) <= FMath::Square(PickupReach + Tolerance);
+}
+
+void UPickupInteractionSubsystem::Collect(AItemActor* Item)
+{
+	if (!IsValid(Item))
+	{
+		return;
+	}
+
+	UnregisterItem(Item);
+
+	if (StateReplicator != nullptr && Item->HasAuthority())
+	{
+		StateReplicator->SetCollected(Item->GetPieceId(), true);
+	}
+
+	if (bPoolCollectedItems)
+	{
+		Item->SetAvailable(false);
+		PooledItems.Add(Item);
+	}
+	else
+	{
+		Item->Destroy();
+	}
+}
+
+AItemActor* UPickupInteractionSubsystem::SpawnItem(TSubclassOf<AItemActor> ItemClass, const FTransform& SpawnTransform)
+{
+	if (!ItemClass)
+	{
+		return nullptr;
+	}
+
+	LLM_SCOPE_BYTAG(MGNG_Pickups);
+
+	for (int32 Index = PooledItems.Num() - 1; Index >= 0; --Index)
+	{
+		AItemActor* Item = PooledItems[Index];
+		if (!IsValid(Item))
+		{
+			PooledItems.RemoveAtSwap(Index);
+			continue;
+		}
+		if (Item->GetClass() == ItemClass)
+		{
+			PooledItems.RemoveAtSwap(Index);
+			// The new location has to reach clients, the availability goes through the replicator
+			Item->FlushNetDormancy();
+			Item->SetActorTransform(SpawnTransform);
+			Item->SetAvailable(true);
+			RegisterItem(Item);
+			if (StateReplicator != nullptr)
+			{
+				StateReplicator->SetCollected(Item->GetPieceId(), false);
+			}
+			return Item;
+		}
+	}
+
+	// BeginPlay registers freshly spawned items
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	INC_DWORD_STAT(STAT_MGNGActorSpawns);
+	return GetWorld()->SpawnActor<AItemActor>(ItemClass, SpawnTransform, SpawnParams);
+}
+
+void UPickupInteractionSubsystem::RefreshCharacter(AMGNGDectectivesCharacter* Character)
+{
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	AItemActor* Best = FindBestPickup(Character);
+	Character->canPick = Best != nullptr;
+	Character->itemClass = Best;
+}
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PickupInteractionSubsystem.generated.h"
+
+class AItemActor;
+class AMGNGDectectivesCharacter;
+class APickupStateReplicator;
+
+/**
+ * Keeps every AItemActor of the world in a uniform spatial hash and tracks which pickups each character overlaps.
+ * Characters ask for their best pickup instead of holding on to whichever overlap fired last.
+ * On the server it also spawns the APickupStateReplicator that tells clients which pieces are collected,
+ * and on clients it applies that state to the dormant pickups.
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API UPickupInteractionSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Puts an available item in the spatial hash, and gives it a piece ID on the server if it has none.
+	 * bFromReplication skips the collected check, the replicator still lists a piece while it reports its removal.
+	 */
+	void RegisterItem(AItemActor* Item, bool bFromReplication = false);
+	void UnregisterItem(AItemActor* Item);
+
+	/** Drops an item that leaves play for good, called from its EndPlay */
+	void ForgetItem(AItemActor* Item);
+
+	void SetStateReplicator(APickupStateReplicator* InReplicator);
+
+	/** Shows or hides the piece with PieceId, or remembers the state until that piece registers */
+	void ApplyPieceState(uint32 PieceId, bool bCollected);
+
+	/** Called from the item's overlap events */
+	void AddCandidate(AMGNGDectectivesCharacter* Character, AItemActor* Item);
+	void RemoveCandidate(AMGNGDectectivesCharacter* Character, AItemActor* Item);
+
+	/** Closest available pickup the character overlaps or has within PickupReach */
+	AItemActor* FindBestPickup(const AMGNGDectectivesCharacter* Character) const;
+
+	/** Item in play with PieceId, collected or not */
+	AItemActor* FindItem(uint32 PieceId) const;
+
+	/** Whether Character may take Item right now, the server checks this before accepting a pickup */
+	bool CanCollect(const AMGNGDectectivesCharacter* Character, const AItemActor* Item, float Tolerance) const;
+
+	/** Takes the item out of play, parking it for reuse when bPoolCollectedItems is set */
+	void Collect(AItemActor* Item);
+
+	/** Places a pickup of ItemClass, reusing a collected one when possible */
+	AItemActor* SpawnItem(TSubclassOf<AItemActor> ItemClass, const FTransform& SpawnTransform);
+
+	FORCEINLINE int32 GetNumRegisteredItems() const { return NumRegisteredItems; }
+	FORCEINLINE int32 GetNumPooledItems() const { return PooledItems.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Edge length of a spatial hash cell, should be at least PickupReach */
+	UPROPERTY(Config)
+	float CellSize = 500.0f;
+
+	/** How far from a character a pickup can be grabbed without overlapping it */
+	UPROPERTY(Config)
+	float PickupReach = 150.0f;
+
+	/** Hide and park collected pickups instead of destroying them */
+	UPROPERTY(Config)
+	bool bPoolCollectedItems = true;
+
+private:
+	FIntVector GetCell(const FVector& Location) const;
+
+	/** Pushes the current best pickup into the character's canPick and itemClass */
+	void RefreshCharacter(AMGNGDectectivesCharacter* Character);
+
+	bool IsPieceCollected(uint32 PieceId) const;
+
+	TMap<FIntVector, TArray<TWeakObjectPtr<AItemActor>>> Cells;
+	TMap<TWeakObjectPtr<AItemActor>, FIntVector> ItemCells;
+	TMap<TWeakObjectPtr<AMGNGDectectivesCharacter>, TArray<TWeakObjectPtr<AItemActor>>> Candidates;
+
+	UPROPERTY()
+	TArray<AItemActor*> PooledItems;
+
+	/** Every item in play by piece ID, collected ones included */
+	TMap<uint32, TWeakObjectPtr<AItemActor>> ItemsById;
+
+	UPROPERTY()
+	APickupStateReplicator* StateReplicator = nullptr;
+
+	int32 NumRegisteredItems = 0;
+
+	/** Piece IDs handed to items spawned during play, the top bit keeps them apart from level placed ones */
+	uint32 NextRuntimePieceId = 0x80000001;
+};
@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PickupStateReplicator.h"
+
+#include "MGNGDectectives.h"
+#include "PickupInteractionSubsystem.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pickup State Changes"), STAT_PickupStateChanges, STATGROUP_MGNGDectectives);
+
+//////////////////////////////////////////////////////////////////////////
+// FCollectedPieceArray
+
+void FCollectedPieceItem::PostReplicatedAdd(const FCollectedPieceArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner != nullptr)
+	{
+		InArraySerializer.Owner->OnPieceReplicated(PieceId, true);
+	}
+}
+
+void FCollectedPieceItem::PreReplicatedRemove(const FCollectedPieceArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner != nullptr)
+	{
+		InArraySerializer.Owner->OnPieceReplicated(PieceId, false);
+	}
+}
+
+bool FCollectedPieceArray::Add(uint32 PieceId)
+{
+	if (Contains(PieceId))
+	{
+		return false;
+	}
+
+	FCollectedPieceItem& Item = Items.AddDefaulted_GetRef();
+	Item.PieceId = PieceId;
+	MarkItemDirty(Item);
+	return true;
+}
+
+bool FCollectedPieceArray::Remove(uint32 PieceId)
+{
+	const int32 Index = Items.IndexOfByPredicate([PieceId](const FCollectedPieceItem& Item) { return Item.PieceId == PieceId; });
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	Items.RemoveAtSwap(Index);
+	MarkArrayDirty();
+	return true;
+}
+
+bool FCollectedPieceArray::Contains(uint32 PieceId) const
+{
+	return Items.ContainsByPredicate([PieceId](const FCollectedPieceItem& Item) { return Item.PieceId == PieceId; });
+}
+
+//////////////////////////////////////////////////////////////////////////
+// APickupStateReplicator
+
+APickupStateReplicator::APickupStateReplicator()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	bReplicates = true;
+	bAlwaysRelevant = true;
+	NetDormancy = DORM_DormantAll;
+	// Woken explicitly on every change, so the rate only bounds how fast a burst of pickups goes out
+	NetUpdateFrequency = 10.0f;
+
+	CollectedPieces.Owner = this;
+}
+
+void APickupStateReplicator::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(APickupStateReplicator, CollectedPieces);
+}
+
+void APickupStateReplicator::BeginPlay()
+{
+	Super::BeginPlay();
+
+	CollectedPieces.Owner = this;
+	if (UPickupInteractionSubsystem* Pickups = GetWorld()->GetSubsystem<UPickupInteractionSubsystem>())
+	{
+		Pickups->SetStateReplicator(this);
+	}
+}
+
+void APickupStateReplicator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UPickupInteractionSubsystem* Pickups = GetWorld()->GetSubsystem<UPickupInteractionSubsystem>())
+	{
+		Pickups->SetStateReplicator(nullptr);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void APickupStateReplicator::SetCollected(uint32 PieceId, bool bCollected)
+{
+	if (!HasAuthority() || PieceId == 0)
+	{
+		return;
+	}
+
+	const bool bChanged = bCollected ? CollectedPieces.Add(PieceId) : CollectedPieces.Remove(PieceId);
+	if (bChanged)
+	{
+		INC_DWORD_STAT(STAT_PickupStateChanges);
+		FlushNetDormancy();
+	}
+}
+
+void APickupStateReplicator::OnPieceReplicated(uint32 PieceId, bool bCollected)
+{
+	if (UPickupInteractionSubsystem* Pickups = GetWorld()->GetSubsystem<UPickupInteractionSubsystem>())
+	{
+		Pickups->ApplyPieceState(PieceId, bCollected);
+	}
+}
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "PickupStateReplicator.generated.h"
+
+class APickupStateReplicator;
+
+/** One clue piece that is currently collected, identified by AItemActor::GetPieceId */
+USTRUCT()
+struct FCollectedPieceItem : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint32 PieceId = 0;
+
+	void PostReplicatedAdd(const struct FCollectedPieceArray& InArraySerializer);
+	void PreReplicatedRemove(const struct FCollectedPieceArray& InArraySerializer);
+};
+
+/** Collected pieces of the level, only added and removed entries are sent */
+USTRUCT()
+struct FCollectedPieceArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FCollectedPieceItem> Items;
+
+	/** Set by the owning actor on both sides, the callbacks go through it */
+	APickupStateReplicator* Owner = nullptr;
+
+	/** Returns false when PieceId was already in the list */
+	bool Add(uint32 PieceId);
+
+	/** Returns false when PieceId wasn't in the list */
+	bool Remove(uint32 PieceId);
+
+	bool Contains(uint32 PieceId) const;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FCollectedPieceItem, FCollectedPieceArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FCollectedPieceArray> : public TStructOpsTypeTraitsBase2<FCollectedPieceArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ * Replicates which clue pieces of the level are collected, so the AItemActors themselves can stay dormant.
+ * The server spawns one per world through UPickupInteractionSubsystem. It is dormant too and only wakes
+ * for the update after a piece changes; a client joining mid-match gets the whole list in its first bunch.
+ */
+UCLASS(NotPlaceable)
+class MGNGDECTECTIVES_API APickupStateReplicator : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	APickupStateReplicator();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Server only, records the new state of PieceId and wakes the actor for one update */
+	void SetCollected(uint32 PieceId, bool bCollected);
+
+	FORCEINLINE bool IsCollected(uint32 PieceId) const { return CollectedPieces.Contains(PieceId); }
+	FORCEINLINE int32 GetNumCollected() const { return CollectedPieces.Items.Num(); }
+
+	/** Called from the fast array callbacks on clients */
+	void OnPieceReplicated(uint32 PieceId, bool bCollected);
+
+protected:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+private:
+	UPROPERTY(Replicated)
+	FCollectedPieceArray CollectedPieces;
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileEventReplicator.h"
+
+#include "ProjectileManagerSubsystem.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+
+AProjectileEventReplicator::AProjectileEventReplicator()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	bReplicates = true;
+	bAlwaysRelevant = true;
+	// Only bBatched replicates, the event batches force an update when they are queued
+	NetUpdateFrequency = 1.0f;
+}
+
+void AProjectileEventReplicator::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AProjectileEventReplicator, bBatched);
+}
+
+void AProjectileEventReplicator::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UProjectileManagerSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileManagerSubsystem>())
+	{
+		Projectiles->SetEventReplicator(this);
+	}
+}
+
+void AProjectileEventReplicator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UProjectileManagerSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileManagerSubsystem>())
+	{
+		Projectiles->SetEventReplicator(nullptr);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AProjectileEventReplicator::SetBatched(bool bInBatched)
+{
+	if (HasAuthority() && bBatched != bInBatched)
+	{
+		bBatched = bInBatched;
+		ForceNetUpdate();
+	}
+}
+
+void AProjectileEventReplicator::MulticastSpawnProjectiles_Implementation(const TArray<FProjectileSpawnEvent>& Events)
+{
+	if (HasAuthority())
+	{
+		return;
+	}
+
+	if (UProjectileManagerSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileManagerSubsystem>())
+	{
+		Projectiles->HandleSpawnEvents(Events);
+	}
+}
+
+void AProjectileEventReplicator::MulticastDetonateProjectiles_Implementation(const TArray<FProjectileDetonateEvent>& Events)
+{
+	if (HasAuthority())
+	{
+		return;
+	}
+
+	if (UProjectileManagerSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileManagerSubsystem>())
+	{
+		Projectiles->HandleDetonateEvents(Events);
+	}
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Engine/NetSerialization.h"
+#include "ProjectileEventReplicator.generated.h"
+
+class AGranade;
+
+/** A batched projectile the server launched, enough for clients to run the same arc */
+USTRUCT()
+struct FProjectileSpawnEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint32 Id = 0;
+
+	UPROPERTY()
+	TSubclassOf<AGranade> Class;
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	FVector_NetQuantize Velocity;
+
+	/** Server world time the arc starts at */
+	UPROPERTY()
+	float LaunchTime = 0.0f;
+};
+
+/** A batched projectile that went off on the server */
+USTRUCT()
+struct FProjectileDetonateEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint32 Id = 0;
+
+	UPROPERTY()
+	FVector_NetQuantize Location;
+};
+
+/**
+ * Sends the spawns and detonations of UProjectileManagerSubsystem to every client, batched per frame.
+ * Both are unreliable: a lost spawn only hides a projectile, a lost detonation is caught by the client's lifetime.
+ * Also replicates whether the server batches throws at all, so clients pick the same throw path.
+ * The server spawns one per world, it registers itself with the subsystem on both sides.
+ */
+UCLASS(NotPlaceable)
+class MGNGDECTECTIVES_API AProjectileEventReplicator : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AProjectileEventReplicator();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Server only */
+	void SetBatched(bool bInBatched);
+
+	FORCEINLINE bool IsBatched() const { return bBatched; }
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastSpawnProjectiles(const TArray<FProjectileSpawnEvent>& Events);
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastDetonateProjectiles(const TArray<FProjectileDetonateEvent>& Events);
+
+private:
+	UPROPERTY(Replicated)
+	bool bBatched = false;
+};
@@ -0,0 +1,713 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileManagerSubsystem.h"
+
+#include "MGNGDectectives.h"
+#include "GameplayEventRecorder.h"
+#include "Granade.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/VectorRegister.h"
+#include "UObject/UObjectIterator.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectiles Tick"), STAT_ProjectilesTick, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Projectiles Integrate"), STAT_ProjectilesIntegrate, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Projectiles Sweeps"), STAT_ProjectilesSweeps, STATGROUP_MGNGDectectives);
+DECLARE_CYCLE_STAT(TEXT("Projectiles Instances"), STAT_ProjectilesInstances, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Live Projectiles"), STAT_LiveProjectiles, STATGROUP_MGNGDectectives);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Detonations"), STAT_ProjectileDetonations, STATGROUP_MGNGDectectives);
+
+static TAutoConsoleVariable<int32> CVarBatchedProjectiles(
+	TEXT("mgng.Projectiles.Batched"),
+	0,
+	TEXT("1 throws grenades through UProjectileManagerSubsystem instead of spawning an AGranade per throw. Read on the server, clients follow it."),
+	FConsoleVariableDelegate::CreateLambda([](IConsoleVariable* Variable)
+	{
+		for (TObjectIterator<AProjectileEventReplicator> It; It; ++It)
+		{
+			if (!It->IsTemplate() && It->HasAuthority())
+			{
+				It->SetBatched(Variable->GetInt() != 0);
+			}
+		}
+	}),
+	ECVF_Default
+);
+
+static FAutoConsoleCommandWithWorldAndArgs ProjectileStressCommand(
+	TEXT("mgng.Projectiles.Stress"),
+	TEXT("Launches batched projectiles around the first player on the server. Args: [Count=1000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UProjectileManagerSubsystem* Projectiles = World ? World->GetSubsystem<UProjectileManagerSubsystem>() : nullptr;
+		if (Projectiles == nullptr || World->GetNetMode() == NM_Client)
+		{
+			return;
+		}
+
+		const APlayerController* PlayerController = World->GetFirstPlayerController();
+		const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+		Projectiles->RunStress(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000, Pawn ? Pawn->GetActorLocation() : FVector::ZeroVector);
+	})
+);
+
+static FAutoConsoleCommandWithWorld ProjectileStatsCommand(
+	TEXT("mgng.Projectiles.Stats"),
+	TEXT("Logs the live batched projectiles and the cost of the last frame."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UProjectileManagerSubsystem* Projectiles = World ? World->GetSubsystem<UProjectileManagerSubsystem>() : nullptr)
+		{
+			Projectiles->LogStats();
+		}
+	})
+);
+
+//////////////////////////////////////////////////////////////////////////
+// FProjectileBuffers
+
+int32 FProjectileBuffers::Add()
+{
+	const int32 Index = Num++;
+	if (Index == PositionX.Num())
+	{
+		// Grow the padded arrays a whole vector register at a time
+		for (TArray<float>* Lanes : { &PositionX, &PositionY, &PositionZ, &VelocityX, &VelocityY, &VelocityZ, &GravityZ, &Age, &PreviousX, &PreviousY, &PreviousZ })
+		{
+			Lanes->AddZeroed(4);
+		}
+	}
+
+	Sweeps.AddDefaulted();
+	Ids.Add(0);
+	Types.Add(0);
+	Resting.Add(false);
+	Throwers.AddDefaulted();
+	Instigators.AddDefaulted();
+	return Index;
+}
+
+void FProjectileBuffers::RemoveAtSwap(int32 Index)
+{
+	const int32 Last = --Num;
+	for (TArray<float>* Lanes : { &PositionX, &PositionY, &PositionZ, &VelocityX, &VelocityY, &VelocityZ, &GravityZ, &Age, &PreviousX, &PreviousY, &PreviousZ })
+	{
+		TArray<float>& Values = *Lanes;
+		Values[Index] = Values[Last];
+		Values[Last] = 0.0f;
+	}
+
+	Sweeps.RemoveAtSwap(Index, 1, false);
+	Ids.RemoveAtSwap(Index, 1, false);
+	Types.RemoveAtSwap(Index, 1, false);
+	Resting.RemoveAtSwap(Index, 1, false);
+	Throwers.RemoveAtSwap(Index, 1, false);
+	Instigators.RemoveAtSwap(Index, 1, false);
+}
+
+void FProjectileBuffers::Empty()
+{
+	for (TArray<float>* Lanes : { &PositionX, &PositionY, &PositionZ, &VelocityX, &VelocityY, &VelocityZ, &GravityZ, &Age, &PreviousX, &PreviousY, &PreviousZ })
+	{
+		Lanes->Empty();
+	}
+
+	Sweeps.Empty();
+	Ids.Empty();
+	Types.Empty();
+	Resting.Empty();
+	Throwers.Empty();
+	Instigators.Empty();
+	Num = 0;
+}
+
+SIZE_T FProjectileBuffers::GetAllocatedSize() const
+{
+	SIZE_T Size = 0;
+	for (const TArray<float>* Lanes : { &PositionX, &PositionY, &PositionZ, &VelocityX, &VelocityY, &VelocityZ, &GravityZ, &Age, &PreviousX, &PreviousY, &PreviousZ })
+	{
+		Size += Lanes->GetAllocatedSize();
+	}
+	return Size + Sweeps.GetAllocatedSize() + Ids.GetAllocatedSize() + Types.GetAllocatedSize() + Resting.GetAllocatedSize()
+		+ Throwers.GetAllocatedSize() + Instigators.GetAllocatedSize();
+}
+
+void FProjectileBuffers::SetPosition(int32 Index, const FVector& Position)
+{
+	PositionX[Index] = Position.X;
+	PositionY[Index] = Position.Y;
+	PositionZ[Index] = Position.Z;
+}
+
+void FProjectileBuffers::SetVelocity(int32 Index, const FVector& Velocity)
+{
+	VelocityX[Index] = Velocity.X;
+	VelocityY[Index] = Velocity.Y;
+	VelocityZ[Index] = Velocity.Z;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UProjectileManagerSubsystem
+
+UProjectileManagerSubsystem* UProjectileManagerSubsystem::FindBatched(const UWorld* World)
+{
+	UProjectileManagerSubsystem* Projectiles = World != nullptr ? World->GetSubsystem<UProjectileManagerSubsystem>() : nullptr;
+	return Projectiles != nullptr && Projectiles->IsBatched() ? Projectiles : nullptr;
+}
+
+bool UProjectileManagerSubsystem::IsBatched() const
+{
+	// Clients follow the server, a mismatch predicts AGranade proxies nothing replaces or waits for spawns that never come
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		return EventReplicator != nullptr && EventReplicator->IsBatched();
+	}
+	return CVarBatchedProjectiles.GetValueOnGameThread() != 0;
+}
+
+bool UProjectileManagerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UProjectileManagerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileManagerSubsystem, STATGROUP_Tickables);
+}
+
+bool UProjectileManagerSubsystem::IsTickable() const
+{
+	return Buffers.Num > 0 || bInstancesDirty || PendingSpawns.Num() > 0 || PendingDetonations.Num() > 0;
+}
+
+void UProjectileManagerSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (InWorld.GetNetMode() != NM_Client && InWorld.GetNetMode() != NM_Standalone)
+	{
+		// Clients get the replicator from the server, it registers itself in BeginPlay
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		if (AProjectileEventReplicator* Replicator = InWorld.SpawnActor<AProjectileEventReplicator>(SpawnParams))
+		{
+			Replicator->SetBatched(CVarBatchedProjectiles.GetValueOnGameThread() != 0);
+		}
+	}
+}
+
+void UProjectileManagerSubsystem::Deinitialize()
+{
+	Buffers.Empty();
+	Types.Empty();
+	PendingSpawns.Empty();
+	PendingDetonations.Empty();
+	InstanceHost = nullptr;
+	EventReplicator = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UProjectileManagerSubsystem::SetEventReplicator(AProjectileEventReplicator* InReplicator)
+{
+	EventReplicator = InReplicator;
+}
+
+int32 UProjectileManagerSubsystem::FindOrAddType(TSubclassOf<AGranade> Class)
+{
+	const int32 Existing = Types.IndexOfByPredicate([Class](const FProjectileType& Type) { return Type.Class == Class; });
+	if (Existing != INDEX_NONE)
+	{
+		return Existing;
+	}
+
+	const AGranade* DefaultGranade = Class->GetDefaultObject<AGranade>();
+	const UProjectileMovementComponent* DefaultMovement = DefaultGranade->GetProjectileMovement();
+
+	FProjectileType& Type = Types.AddDefaulted_GetRef();
+	Type.Class = Class;
+	Type.CollisionRadius = DefaultGranade->GetCollisionRadius();
+	// The class default object has no physics volume to ask, the world's gravity is what a live grenade gets
+	Type.GravityZ = GetWorld()->GetGravityZ() * DefaultMovement->ProjectileGravityScale;
+	Type.FuseTime = DefaultGranade->FuseTime;
+	Type.MaxLaunchFastForward = DefaultGranade->MaxLaunchFastForward;
+	Type.MeshScale = DefaultGranade->GetRootComponent()->GetRelativeScale3D();
+	DefaultGranade->FillExplosion(Type.Explosion);
+	return Types.Num() - 1;
+}
+
+uint32 UProjectileManagerSubsystem::Spawn(TSubclassOf<AGranade> Class, const FVector& Origin, const FVector& Velocity, float LaunchTime, AActor* Thrower, AController* InstigatedBy)
+{
+	UWorld* World = GetWorld();
+	if (!Class || World->GetNetMode() == NM_Client)
+	{
+		return 0;
+	}
+
+	const int32 TypeIndex = FindOrAddType(Class);
+	const float Now = AGranade::GetSyncedWorldTime(World);
+	const float Elapsed = FMath::Clamp(Now - LaunchTime, 0.0f, Types[TypeIndex].MaxLaunchFastForward);
+
+	const uint32 Id = NextId;
+	NextId = NextId == MAX_uint32 ? 1 : NextId + 1;
+	AddProjectile(TypeIndex, Id, Origin, Velocity, Elapsed, Thrower, InstigatedBy);
+
+	if (EventReplicator != nullptr)
+	{
+		FProjectileSpawnEvent& Event = PendingSpawns.AddDefaulted_GetRef();
+		Event.Id = Id;
+		Event.Class = Class;
+		Event.Origin = Origin;
+		Event.Velocity = Velocity;
+		Event.LaunchTime = Now - Elapsed;
+	}
+	return Id;
+}
+
+int32 UProjectileManagerSubsystem::AddProjectile(int32 TypeIndex, uint32 Id, const FVector& Origin, const FVector& Velocity, float Elapsed, AActor* Thrower, AController* InstigatedBy)
+{
+	LLM_SCOPE_BYTAG(MGNG_Projectiles);
+
+	const FProjectileType& Type = Types[TypeIndex];
+	const FVector Gravity(0.0f, 0.0f, Type.GravityZ);
+
+	// Same catch up as AGranade::ApplyNetState, so late clients start on the server's arc
+	const int32 Index = Buffers.Add();
+	Buffers.SetPosition(Index, Origin + Velocity * Elapsed + Gravity * (0.5f * Elapsed * Elapsed));
+	Buffers.SetVelocity(Index, Velocity + Gravity * Elapsed);
+	Buffers.PreviousX[Index] = Origin.X;
+	Buffers.PreviousY[Index] = Origin.Y;
+	Buffers.PreviousZ[Index] = Origin.Z;
+	Buffers.GravityZ[Index] = Type.GravityZ;
+	Buffers.Age[Index] = Elapsed;
+	Buffers.Ids[Index] = Id;
+	Buffers.Types[Index] = static_cast<uint16>(TypeIndex);
+	Buffers.Throwers[Index] = Thrower;
+	Buffers.Instigators[Index] = InstigatedBy;
+
+	bInstancesDirty = true;
+	return Index;
+}
+
+void UProjectileManagerSubsystem::HandleSpawnEvents(const TArray<FProjectileSpawnEvent>& Events)
+{
+	const float Now = AGranade::GetSyncedWorldTime(GetWorld());
+	for (const FProjectileSpawnEvent& Event : Events)
+	{
+		if (!Event.Class)
+		{
+			continue;
+		}
+
+		const int32 TypeIndex = FindOrAddType(Event.Class);
+		const float Elapsed = FMath::Clamp(Now - Event.LaunchTime, 0.0f, Types[TypeIndex].MaxLaunchFastForward);
+		AddProjectile(TypeIndex, Event.Id, Event.Origin, Event.Velocity, Elapsed, nullptr, nullptr);
+	}
+}
+
+void UProjectileManagerSubsystem::HandleDetonateEvents(const TArray<FProjectileDetonateEvent>& Events)
+{
+	for (const FProjectileDetonateEvent& Event : Events)
+	{
+		// Already gone when the client's own lifetime ran out first
+		const int32 Index = Buffers.Ids.IndexOfByKey(Event.Id);
+		if (Index != INDEX_NONE)
+		{
+			Detonate(Index, Event.Location);
+		}
+	}
+}
+
+void UProjectileManagerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectilesTick);
+	const double StartTime = FPlatformTime::Seconds();
+
+	ResolveSweeps();
+	ExpireProjectiles();
+	Integrate(DeltaTime);
+	IssueSweeps();
+	UpdateInstances();
+	FlushEvents();
+
+	SET_DWORD_STAT(STAT_LiveProjectiles, Buffers.Num);
+	LastTickMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+void UProjectileManagerSubsystem::ResolveSweeps()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectilesSweeps);
+
+	UWorld* World = GetWorld();
+	const bool bAuthority = World->GetNetMode() != NM_Client;
+	FTraceDatum Datum;
+	FOverlapDatum OverlapDatum;
+
+	// Backwards, detonating swaps the last projectile into the current slot
+	for (int32 Index = Buffers.Num - 1; Index >= 0; --Index)
+	{
+		FTraceHandle& Sweep = Buffers.Sweeps[Index];
+		if (!Sweep.IsValid())
+		{
+			continue;
+		}
+
+		if (Buffers.Resting[Index])
+		{
+			// Same as AGranade::OverlapBegin, a character walking into a resting grenade sets it off
+			const bool bReady = World->QueryOverlapData(Sweep, OverlapDatum);
+			Sweep.Invalidate();
+			if (bReady && OverlapDatum.OutOverlaps.ContainsByPredicate([](const FOverlapResult& Overlap) { return Cast<ACharacter>(Overlap.GetActor()) != nullptr; }))
+			{
+				Detonate(Index, Buffers.GetPosition(Index));
+			}
+			continue;
+		}
+
+		const bool bReady = World->QueryTraceData(Sweep, Datum);
+		Sweep.Invalidate();
+		if (!bReady || Datum.OutHits.Num() == 0 || !Datum.OutHits[0].bBlockingHit)
+		{
+			continue;
+		}
+
+		// Same rule as AGranade::OverlapBegin, only characters set it off on contact whatever the fuse,
+		// anything else leaves it resting until the fuse or MaxLifetime runs out
+		const FHitResult& Hit = Datum.OutHits[0];
+		const bool bHitCharacter = Cast<ACharacter>(Hit.GetActor()) != nullptr;
+		if (bAuthority && bHitCharacter)
+		{
+			Detonate(Index, Hit.Location);
+		}
+		else
+		{
+			Rest(Index, Hit.Location);
+		}
+	}
+}
+
+void UProjectileManagerSubsystem::ExpireProjectiles()
+{
+	const bool bAuthority = GetWorld()->GetNetMode() != NM_Client;
+	for (int32 Index = Buffers.Num - 1; Index >= 0; --Index)
+	{
+		const float Age = Buffers.Age[Index];
+		const float FuseTime = Types[Buffers.Types[Index]].FuseTime;
+		if (bAuthority && FuseTime > 0.0f && Age >= FuseTime)
+		{
+			Detonate(Index, Buffers.GetPosition(Index));
+		}
+		else if (Age >= MaxLifetime)
+		{
+			// Clients drop theirs quietly, the server's detonation may simply have been lost
+			if (bAuthority)
+			{
+				Detonate(Index, Buffers.GetPosition(Index));
+			}
+			else
+			{
+				Buffers.RemoveAtSwap(Index);
+				bInstancesDirty = true;
+			}
+		}
+	}
+}
+
+void UProjectileManagerSubsystem::Integrate(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectilesIntegrate);
+
+	// Padded lanes are zero and stay zero, so the loop never needs a scalar tail
+	const int32 NumLanes = Buffers.PositionX.Num();
+	FMemory::Memcpy(Buffers.PreviousX.GetData(), Buffers.PositionX.GetData(), NumLanes * sizeof(float));
+	FMemory::Memcpy(Buffers.PreviousY.GetData(), Buffers.PositionY.GetData(), NumLanes * sizeof(float));
+	FMemory::Memcpy(Buffers.PreviousZ.GetData(), Buffers.PositionZ.GetData(), NumLanes * sizeof(float));
+
+	float* RESTRICT PositionX = Buffers.PositionX.GetData();
+	float* RESTRICT PositionY = Buffers.PositionY.GetData();
+	float* RESTRICT PositionZ = Buffers.PositionZ.GetData();
+	float* RESTRICT VelocityX = Buffers.VelocityX.GetData();
+	float* RESTRICT VelocityY = Buffers.VelocityY.GetData();
+	float* RESTRICT VelocityZ = Buffers.VelocityZ.GetData();
+	const float* RESTRICT GravityZ = Buffers.GravityZ.GetData();
+	float* RESTRICT Age = Buffers.Age.GetData();
+
+	// Exact for constant gravity, so the arc doesn't depend on the frame rate and matches the clients'
+	const VectorRegister4Float Dt = VectorSetFloat1(DeltaTime);
+	const VectorRegister4Float HalfDtSquared = VectorSetFloat1(0.5f * DeltaTime * DeltaTime);
+	for (int32 Lane = 0; Lane < NumLanes; Lane += 4)
+	{
+		const VectorRegister4Float VX = VectorLoad(VelocityX + Lane);
+		const VectorRegister4Float VY = VectorLoad(VelocityY + Lane);
+		const VectorRegister4Float VZ = VectorLoad(VelocityZ + Lane);
+		const VectorRegister4Float GZ = VectorLoad(GravityZ + Lane);
+
+		VectorStore(VectorMultiplyAdd(VX, Dt, VectorLoad(PositionX + Lane)), PositionX + Lane);
+		VectorStore(VectorMultiplyAdd(VY, Dt, VectorLoad(PositionY + Lane)), PositionY + Lane);
+		VectorStore(VectorMultiplyAdd(GZ, HalfDtSquared, VectorMultiplyAdd(VZ, Dt, VectorLoad(PositionZ + Lane))), PositionZ + Lane);
+		VectorStore(VectorMultiplyAdd(GZ, Dt, VZ), VelocityZ + Lane);
+		VectorStore(VectorAdd(VectorLoad(Age + Lane), Dt), Age + Lane);
+	}
+}
+
+void UProjectileManagerSubsystem::IssueSweeps()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectilesSweeps);
+
+	UWorld* World = GetWorld();
+	const bool bAuthority = World->GetNetMode() != NM_Client;
+	FCollisionObjectQueryParams ObjectParams;
+	ObjectParams.AddObjectTypesToQuery(ECC_WorldStatic);
+	ObjectParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+	ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
+	ObjectParams.AddObjectTypesToQuery(ECC_PhysicsBody);
+	const FCollisionObjectQueryParams PawnParams(ECC_Pawn);
+
+	// The engine runs every async trace of the frame together on worker threads, results arrive next frame
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(BatchedProjectile), false);
+	const FCollisionQueryParams RestingParams(SCENE_QUERY_STAT(BatchedProjectileResting), false);
+	for (int32 Index = 0; Index < Buffers.Num; ++Index)
+	{
+		if (Buffers.Resting[Index])
+		{
+			// Nothing moves it any more, only the server checks whether a pawn walked into it
+			if (bAuthority)
+			{
+				const FCollisionShape Sphere = FCollisionShape::MakeSphere(Types[Buffers.Types[Index]].CollisionRadius);
+				Buffers.Sweeps[Index] = World->AsyncOverlapByObjectType(Buffers.GetPosition(Index), FQuat::Identity, PawnParams, Sphere, RestingParams);
+				INC_DWORD_STAT(STAT_MGNGSceneQueries);
+			}
+			continue;
+		}
+
+		QueryParams.ClearIgnoredActors();
+		if (const AActor* Thrower = Buffers.Throwers[Index].Get())
+		{
+			QueryParams.AddIgnoredActor(Thrower);
+		}
+
+		const FCollisionShape Sphere = FCollisionShape::MakeSphere(Types[Buffers.Types[Index]].CollisionRadius);
+		Buffers.Sweeps[Index] = World->AsyncSweepByObjectType(EAsyncTraceType::Single, Buffers.GetPrevious(Index), Buffers.GetPosition(Index),
+			FQuat::Identity, ObjectParams, Sphere, QueryParams);
+		INC_DWORD_STAT(STAT_MGNGSceneQueries);
+	}
+}
+
+void UProjectileManagerSubsystem::Rest(int32 Index, const FVector& Location)
+{
+	// Zero gravity keeps it in place through the integration
+	Buffers.SetPosition(Index, Location);
+	Buffers.SetVelocity(Index, FVector::ZeroVector);
+	Buffers.GravityZ[Index] = 0.0f;
+	Buffers.Resting[Index] = true;
+}
+
+void UProjectileManagerSubsystem::Detonate(int32 Index, const FVector& Location)
+{
+	UWorld* World = GetWorld();
+	const FProjectileType& Type = Types[Buffers.Types[Index]];
+
+	if (World->GetNetMode() != NM_Client)
+	{
+		FGameplayEventRecorder::Record(EGameplayEvent::Detonation, Buffers.Throwers[Index].Get(), Location, Type.Explosion.Radius, Buffers.Ids[Index]);
+		if (UExplosionResolverSubsystem* Resolver = World->GetSubsystem<UExplosionResolverSubsystem>())
+		{
+			// There is no grenade actor, the class default object stands in for it so damage is blamed on
+			// the same class as an AGranade's and the thrower isn't left out of the blast
+			FQueuedExplosion Explosion = Type.Explosion;
+			Explosion.Origin = Location;
+			Explosion.DamageCauser = Type.Class->GetDefaultObject<AGranade>();
+			Explosion.InstigatedBy = Buffers.Instigators[Index];
+			Resolver->QueueExplosion(MoveTemp(Explosion));
+		}
+
+		if (EventReplicator != nullptr)
+		{
+			FProjectileDetonateEvent& Event = PendingDetonations.AddDefaulted_GetRef();
+			Event.Id = Buffers.Ids[Index];
+			Event.Location = Location;
+		}
+	}
+
+	INC_DWORD_STAT(STAT_ProjectileDetonations);
+	AGranade::SpawnExplosionEffects(World, Type.Class->GetDefaultObject<AGranade>()->GetAssetData(), Location);
+
+	Buffers.RemoveAtSwap(Index);
+	bInstancesDirty = true;
+}
+
+bool UProjectileManagerSubsystem::CreateInstances(FProjectileType& Type)
+{
+	const AGranade* DefaultGranade = Type.Class->GetDefaultObject<AGranade>();
+	const UStaticMeshComponent* DefaultMesh = Cast<UStaticMeshComponent>(DefaultGranade->GetRootComponent());
+
+	// Same mesh as AGranade::ApplyLoadedAssets picks, nothing is drawn until it has streamed in
+	UStaticMesh* Mesh = DefaultGranade->GetDisplayMesh();
+	if (Mesh == nullptr)
+	{
+		return false;
+	}
+
+	UWorld* World = GetWorld();
+	if (InstanceHost == nullptr)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		InstanceHost = World->SpawnActor<AActor>(SpawnParams);
+
+		USceneComponent* Root = NewObject<USceneComponent>(InstanceHost, TEXT("Root"));
+		InstanceHost->SetRootComponent(Root);
+		Root->RegisterComponent();
+	}
+
+	UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>(InstanceHost);
+	Instances->SetMobility(EComponentMobility::Movable);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetStaticMesh(Mesh);
+	if (DefaultMesh != nullptr)
+	{
+		for (int32 MaterialIndex = 0; MaterialIndex < DefaultMesh->GetNumMaterials(); ++MaterialIndex)
+		{
+			Instances->SetMaterial(MaterialIndex, DefaultMesh->GetMaterial(MaterialIndex));
+		}
+	}
+	Instances->SetupAttachment(InstanceHost->GetRootComponent());
+	Instances->RegisterComponent();
+	InstanceHost->AddInstanceComponent(Instances);
+
+	Type.Instances = Instances;
+	return true;
+}
+
+void UProjectileManagerSubsystem::UpdateInstances()
+{
+	if (!bInstancesDirty && Buffers.Num == 0)
+	{
+		return;
+	}
+	bInstancesDirty = false;
+
+	LLM_SCOPE_BYTAG(MGNG_Projectiles);
+
+	if (GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ProjectilesInstances);
+
+	for (FProjectileType& Type : Types)
+	{
+		Type.InstanceTransforms.Reset();
+	}
+	for (int32 Index = 0; Index < Buffers.Num; ++Index)
+	{
+		FProjectileType& Type = Types[Buffers.Types[Index]];
+		Type.InstanceTransforms.Emplace(Buffers.GetVelocity(Index).ToOrientationQuat(), Buffers.GetPosition(Index), Type.MeshScale);
+	}
+
+	for (FProjectileType& Type : Types)
+	{
+		if (Type.Instances == nullptr && (Type.InstanceTransforms.Num() == 0 || !CreateInstances(Type)))
+		{
+			continue;
+		}
+
+		// Instances are anonymous, only their count has to follow the projectiles
+		const int32 NumWanted = Type.InstanceTransforms.Num();
+		const int32 NumCurrent = Type.Instances->GetInstanceCount();
+		if (NumWanted == 0)
+		{
+			Type.Instances->ClearInstances();
+			continue;
+		}
+		if (NumCurrent > NumWanted)
+		{
+			TArray<int32> Surplus;
+			for (int32 InstanceIndex = NumWanted; InstanceIndex < NumCurrent; ++InstanceIndex)
+			{
+				Surplus.Add(InstanceIndex);
+			}
+			Type.Instances->RemoveInstances(Surplus);
+		}
+		else if (NumCurrent < NumWanted)
+		{
+			TArray<FTransform> Missing(Type.InstanceTransforms.GetData() + NumCurrent, NumWanted - NumCurrent);
+			Type.Instances->AddInstances(Missing, false, true);
+		}
+		Type.Instances->BatchUpdateInstancesTransforms(0, Type.InstanceTransforms, true, true, true);
+	}
+}
+
+void UProjectileManagerSubsystem::FlushEvents()
+{
+	if (EventReplicator == nullptr)
+	{
+		PendingSpawns.Reset();
+		PendingDetonations.Reset();
+		return;
+	}
+
+	const int32 ChunkSize = FMath::Max(MaxEventsPerRPC, 1);
+	for (int32 First = 0; First < PendingSpawns.Num(); First += ChunkSize)
+	{
+		const int32 Count = FMath::Min(ChunkSize, PendingSpawns.Num() - First);
+		EventReplicator->MulticastSpawnProjectiles(TArray<FProjectileSpawnEvent>(PendingSpawns.GetData() + First, Count));
+	}
+	for (int32 First = 0; First < PendingDetonations.Num(); First += ChunkSize)
+	{
+		const int32 Count = FMath::Min(ChunkSize, PendingDetonations.Num() - First);
+		EventReplicator->MulticastDetonateProjectiles(TArray<FProjectileDetonateEvent>(PendingDetonations.GetData() + First, Count));
+	}
+
+	// Unreliable multicasts wait in the channel for the actor's next replication, which its low rate puts far off
+	if (PendingSpawns.Num() > 0 || PendingDetonations.Num() > 0)
+	{
+		EventReplicator->ForceNetUpdate();
+	}
+	PendingSpawns.Reset();
+	PendingDetonations.Reset();
+}
+
+void UProjectileManagerSubsystem::RunStress(int32 Count, const FVector& Center)
+{
+	TSubclassOf<AGranade> Class = StressProjectileClass.LoadSynchronous();
+	if (!Class || Count <= 0)
+	{
+		UE_LOG(LogMGNGDectectives, Display, TEXT("Projectile stress needs StressProjectileClass in DefaultGame.ini"));
+		return;
+	}
+
+	FRandomStream Random(0x50524A53);
+	const float Now = AGranade::GetSyncedWorldTime(GetWorld());
+	for (int32 Projectile = 0; Projectile < Count; ++Projectile)
+	{
+		// Upward cone so they stay in the air for a while before coming down around Center
+		const FVector Origin = Center + FVector(Random.FRandRange(-500.0f, 500.0f), Random.FRandRange(-500.0f, 500.0f), 200.0f);
+		const FVector Velocity = Random.VRandCone(FVector::UpVector, FMath::DegreesToRadians(45.0f)) * Random.FRandRange(800.0f, 1500.0f);
+		Spawn(Class, Origin, Velocity, Now, nullptr, nullptr);
+	}
+
+	UE_LOG(LogMGNGDectectives, Display, TEXT("Projectile stress: launched %d, %d live"), Count, Buffers.Num);
+}
+
+SIZE_T UProjectileManagerSubsystem::GetAllocatedSize() const
+{
+	SIZE_T Size = Buffers.GetAllocatedSize() + Types.GetAllocatedSize() + PendingSpawns.GetAllocatedSize() + PendingDetonations.GetAllocatedSize();
+	for (const FProjectileType& Type : Types)
+	{
+		Size += Type.InstanceTransforms.GetAllocatedSize();
+	}
+	return Size;
+}
+
+void UProjectileManagerSubsystem::LogStats() const
+{
+	UE_LOG(LogMGNGDectectives, Display, TEXT("Projectiles: %d live in %d types, last frame %.3f ms"), Buffers.Num, Types.Num(), LastTickMs);
+}
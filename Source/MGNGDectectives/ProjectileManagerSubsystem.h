@@ -0,0 +1,195 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ExplosionResolverSubsystem.h"
+#include "ProjectileEventReplicator.h"
+#include "WorldCollision.h"
+#include "ProjectileManagerSubsystem.generated.h"
+
+class AGranade;
+class UInstancedStaticMeshComponent;
+
+/** What every batched projectile of one grenade class shares, read once from its class default object */
+USTRUCT()
+struct FProjectileType
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TSubclassOf<AGranade> Class;
+
+	/** Draws every live projectile of this type, created once the mesh has streamed in */
+	UPROPERTY()
+	UInstancedStaticMeshComponent* Instances = nullptr;
+
+	float CollisionRadius = 0.0f;
+	float GravityZ = 0.0f;
+	float FuseTime = 0.0f;
+	float MaxLaunchFastForward = 0.0f;
+	FVector MeshScale = FVector::OneVector;
+
+	/** Radius, damage, impulse and ignored actors of the class, the origin and instigator are filled in per detonation */
+	FQueuedExplosion Explosion;
+
+	/** Reused every frame to update Instances */
+	TArray<FTransform> InstanceTransforms;
+};
+
+/**
+ * Live projectiles as structure-of-arrays, one entry per projectile at the same index in every array.
+ * The float arrays are padded to a multiple of four with zeroed lanes, so the integration always loads
+ * and stores whole vector registers. Removing swaps the last projectile into the hole.
+ */
+struct FProjectileBuffers
+{
+	// Touched by the integration every frame
+	TArray<float> PositionX;
+	TArray<float> PositionY;
+	TArray<float> PositionZ;
+	TArray<float> VelocityX;
+	TArray<float> VelocityY;
+	TArray<float> VelocityZ;
+	TArray<float> GravityZ;
+	TArray<float> Age;
+
+	// Where the frame's sweep starts, copied before integrating
+	TArray<float> PreviousX;
+	TArray<float> PreviousY;
+	TArray<float> PreviousZ;
+
+	// Touched by the sweeps and on impact
+	TArray<FTraceHandle> Sweeps;
+	TArray<uint32> Ids;
+	TArray<uint16> Types;
+	TArray<bool> Resting;
+	TArray<TWeakObjectPtr<AActor>> Throwers;
+	TArray<TWeakObjectPtr<AController>> Instigators;
+
+	int32 Num = 0;
+
+	/** Appends a zeroed projectile and returns its index */
+	int32 Add();
+	void RemoveAtSwap(int32 Index);
+	void Empty();
+
+	/** Heap memory held by the arrays, slack included */
+	SIZE_T GetAllocatedSize() const;
+
+	FORCEINLINE FVector GetPosition(int32 Index) const { return FVector(PositionX[Index], PositionY[Index], PositionZ[Index]); }
+	FORCEINLINE FVector GetVelocity(int32 Index) const { return FVector(VelocityX[Index], VelocityY[Index], VelocityZ[Index]); }
+	FORCEINLINE FVector GetPrevious(int32 Index) const { return FVector(PreviousX[Index], PreviousY[Index], PreviousZ[Index]); }
+	void SetPosition(int32 Index, const FVector& Position);
+	void SetVelocity(int32 Index, const FVector& Velocity);
+};
+
+/**
+ * Simulates thrown grenades without an actor each. State lives in FProjectileBuffers and is integrated
+ * in one vectorized pass per frame; the frame's collision sweeps are all issued as async traces and their
+ * results read at the start of the next frame, so an impact lands one frame late at the exact hit location.
+ * A projectile that came to rest queries for pawns instead, on the server only.
+ * A detonation goes through UExplosionResolverSubsystem and AGranade::SpawnExplosionEffects like an AGranade's.
+ * Every type is drawn by a single UInstancedStaticMeshComponent.
+ *
+ * The server owns the simulation and sends spawns and detonations to clients through AProjectileEventReplicator;
+ * clients run the same arcs cosmetically and only explode them when the server says so.
+ * Throws use it when the server's mgng.Projectiles.Batched is 1, clients follow the flag AProjectileEventReplicator
+ * replicates instead of their own. mgng.Projectiles.Stress fills the world for profiling.
+ */
+UCLASS(config=Game)
+class MGNGDECTECTIVES_API UProjectileManagerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** The world's manager when throws are batched, null otherwise */
+	static UProjectileManagerSubsystem* FindBatched(const UWorld* World);
+
+	/** The server's mgng.Projectiles.Batched, as replicated by the event replicator on clients */
+	bool IsBatched() const;
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override;
+
+	/**
+	 * Server only, launches a projectile of Class from Origin as if it had been thrown at LaunchTime.
+	 * Returns its id, 0 when nothing was spawned.
+	 */
+	uint32 Spawn(TSubclassOf<AGranade> Class, const FVector& Origin, const FVector& Velocity, float LaunchTime, AActor* Thrower, AController* InstigatedBy);
+
+	/** Called from AProjectileEventReplicator on clients */
+	void HandleSpawnEvents(const TArray<FProjectileSpawnEvent>& Events);
+	void HandleDetonateEvents(const TArray<FProjectileDetonateEvent>& Events);
+
+	void SetEventReplicator(AProjectileEventReplicator* InReplicator);
+
+	FORCEINLINE int32 GetNumProjectiles() const { return Buffers.Num; }
+	FORCEINLINE double GetLastTickMs() const { return LastTickMs; }
+
+	/** Heap memory of the buffers, per type data and pending events, the instance components not included */
+	SIZE_T GetAllocatedSize() const;
+
+	/** Launches Count projectiles of StressProjectileClass in random directions around Center */
+	void RunStress(int32 Count, const FVector& Center);
+
+	void LogStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Projectiles that neither hit anything nor went off by then are removed, in seconds */
+	UPROPERTY(Config)
+	float MaxLifetime = 10.0f;
+
+	/** Spawn or detonation events per multicast, keeps each bunch small */
+	UPROPERTY(Config)
+	int32 MaxEventsPerRPC = 64;
+
+	/** Launched by mgng.Projectiles.Stress */
+	UPROPERTY(Config)
+	TSoftClassPtr<AGranade> StressProjectileClass;
+
+private:
+	int32 FindOrAddType(TSubclassOf<AGranade> Class);
+	int32 AddProjectile(int32 TypeIndex, uint32 Id, const FVector& Origin, const FVector& Velocity, float Elapsed, AActor* Thrower, AController* InstigatedBy);
+
+	/** Reads last frame's sweeps and handles whatever they hit */
+	void ResolveSweeps();
+	void ExpireProjectiles();
+	void Integrate(float DeltaTime);
+	void IssueSweeps();
+	void UpdateInstances();
+	void FlushEvents();
+
+	/** Stops the projectile at Location until its fuse runs out, a character touches it or the server detonates it */
+	void Rest(int32 Index, const FVector& Location);
+
+	/** Explodes and removes the projectile, only the server applies damage */
+	void Detonate(int32 Index, const FVector& Location);
+
+	bool CreateInstances(FProjectileType& Type);
+
+	UPROPERTY()
+	TArray<FProjectileType> Types;
+
+	UPROPERTY()
+	AActor* InstanceHost = nullptr;
+
+	UPROPERTY()
+	AProjectileEventReplicator* EventReplicator = nullptr;
+
+	FProjectileBuffers Buffers;
+
+	TArray<FProjectileSpawnEvent> PendingSpawns;
+	TArray<FProjectileDetonateEvent> PendingDetonations;
+
+	uint32 NextId = 1;
+	bool bInstancesDirty = false;
+	double LastTickMs = 0.0;
+};
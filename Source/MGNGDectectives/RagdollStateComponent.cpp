@@ -0,0 +1,296 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RagdollStateComponent.h"
+
+#include "MGNGDectectives.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/Character.h"
+#include "Net/UnrealNetwork.h"
+#include "PhysicsEngine/BodyInstance.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ragdoll Follow"), STAT_RagdollFollow, STATGROUP_MGNGDectectives);
+
+void FRagdollSnapshot::Pack(const FTransform& Transform)
+{
+	const FRotator Rotation = Transform.Rotator();
+	Location = Transform.GetLocation();
+	Pitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+	Yaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+	Roll = FRotator::CompressAxisToShort(Rotation.Roll);
+}
+
+FTransform FRagdollSnapshot::Unpack() const
+{
+	const FRotator Rotation(FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), FRotator::DecompressAxisFromShort(Roll));
+	return FTransform(Rotation, Location);
+}
+
+URagdollStateComponent::URagdollStateComponent()
+{
+	// Only ticks between StartRagdoll and the body settling
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+
+	SetIsReplicatedByDefault(true);
+}
+
+void URagdollStateComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(URagdollStateComponent, bRagdoll);
+	DOREPLIFETIME(URagdollStateComponent, Snapshot);
+}
+
+void URagdollStateComponent::StartRagdoll()
+{
+	if (GetOwnerRole() != ROLE_Authority)
+	{
+		return;
+	}
+
+	StillTime = 0.0f;
+	Snapshot.bSettled = false;
+	// A fresh hit always simulates, even offscreen
+	bFrozen = false;
+	SetComponentTickEnabled(true);
+
+	if (bRagdoll)
+	{
+		// Hit again while lying down, the new impulse has to be followed
+		if (USkeletalMeshComponent* Mesh = GetOwnerMesh())
+		{
+			Mesh->WakeAllRigidBodies();
+		}
+		return;
+	}
+
+	bRagdoll = true;
+	EnableRagdollPhysics();
+	OnRagdollStarted.Broadcast();
+}
+
+void URagdollStateComponent::OnRep_Ragdoll()
+{
+	if (bRagdoll)
+	{
+		// Limbs flop locally, only the root bone follows the server
+		EnableRagdollPhysics();
+		SetComponentTickEnabled(!bFrozen);
+		OnRagdollStarted.Broadcast();
+		if (bFrozen)
+		{
+			if (USkeletalMeshComponent* Mesh = GetOwnerMesh())
+			{
+				Mesh->PutAllRigidBodiesToSleep();
+			}
+		}
+	}
+}
+
+void URagdollStateComponent::OnRep_Snapshot()
+{
+	USkeletalMeshComponent* Mesh = GetOwnerMesh();
+	if (Mesh == nullptr)
+	{
+		return;
+	}
+
+	// Start from wherever the root is shown right now so a late snapshot doesn't pop
+	if (!bHasInterpTarget)
+	{
+		InterpFrom = Mesh->GetSocketTransform(RootBoneName, RTS_World);
+	}
+	else if (InterpAlpha < 1.0f)
+	{
+		InterpFrom = FTransform(FQuat::Slerp(InterpFrom.GetRotation(), InterpTo.GetRotation(), InterpAlpha), FMath::Lerp(InterpFrom.GetLocation(), InterpTo.GetLocation(), InterpAlpha));
+	}
+	else
+	{
+		InterpFrom = InterpTo;
+	}
+	InterpTo = Snapshot.Unpack();
+	bHasInterpTarget = true;
+	InterpAlpha = 0.0f;
+
+	if (bRagdoll && !bFrozen)
+	{
+		SetComponentTickEnabled(true);
+	}
+}
+
+void URagdollStateComponent::SetFrozen(bool bInFrozen)
+{
+	// Only a simulation nobody else depends on may stop
+	const bool bCanFreeze = GetOwnerRole() != ROLE_Authority || GetNetMode() == NM_Standalone;
+	bInFrozen = bInFrozen && bCanFreeze;
+	if (bFrozen == bInFrozen)
+	{
+		return;
+	}
+	bFrozen = bInFrozen;
+
+	if (!bRagdoll)
+	{
+		return;
+	}
+
+	USkeletalMeshComponent* Mesh = GetOwnerMesh();
+	if (bFrozen)
+	{
+		SetComponentTickEnabled(false);
+		if (Mesh != nullptr)
+		{
+			Mesh->PutAllRigidBodiesToSleep();
+		}
+	}
+	else if (Snapshot.bSettled)
+	{
+		// Settled while frozen, jump straight to where the server left it
+		Settle();
+	}
+	else
+	{
+		if (Mesh != nullptr)
+		{
+			Mesh->WakeAllRigidBodies();
+		}
+		SetComponentTickEnabled(true);
+	}
+}
+
+void URagdollStateComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!bRagdoll)
+	{
+		SetComponentTickEnabled(false);
+		return;
+	}
+
+	MGNG_SCOPE_CYCLE_COUNTER(STAT_RagdollFollow);
+
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		TickAuthority(DeltaTime);
+	}
+	else
+	{
+		TickRemote(DeltaTime);
+	}
+}
+
+void URagdollStateComponent::TickAuthority(float DeltaTime)
+{
+	USkeletalMeshComponent* Mesh = GetOwnerMesh();
+	if (Mesh == nullptr)
+	{
+		return;
+	}
+
+	// One bone lookup per frame feeds the capsule, the snapshot and the settle check
+	const FTransform RootTransform = Mesh->GetSocketTransform(RootBoneName, RTS_World);
+	FollowRootBone(RootTransform);
+
+	TimeSinceSnapshot += DeltaTime;
+	if (TimeSinceSnapshot >= 1.0f / SnapshotRate)
+	{
+		TimeSinceSnapshot = 0.0f;
+		Snapshot.Pack(RootTransform);
+	}
+
+	const FBodyInstance* RootBody = Mesh->GetBodyInstance(RootBoneName);
+	const float Speed = RootBody != nullptr ? RootBody->GetUnrealWorldVelocity().Size() : 0.0f;
+	StillTime = Speed < SettleSpeed ? StillTime + DeltaTime : 0.0f;
+	if (StillTime >= SettleTime)
+	{
+		Snapshot.Pack(RootTransform);
+		Settle();
+	}
+}
+
+void URagdollStateComponent::TickRemote(float DeltaTime)
+{
+	USkeletalMeshComponent* Mesh = GetOwnerMesh();
+	if (Mesh == nullptr || InterpAlpha >= 1.0f)
+	{
+		if (Snapshot.bSettled)
+		{
+			Settle();
+		}
+		return;
+	}
+
+	InterpAlpha = FMath::Min(InterpAlpha + DeltaTime * SnapshotRate, 1.0f);
+	const FVector Location = FMath::Lerp(InterpFrom.GetLocation(), InterpTo.GetLocation(), InterpAlpha);
+	const FQuat Rotation = FQuat::Slerp(InterpFrom.GetRotation(), InterpTo.GetRotation(), InterpAlpha);
+	FollowRootBone(FTransform(Rotation, Location));
+
+	if (FBodyInstance* RootBody = Mesh->GetBodyInstance(RootBoneName))
+	{
+		const FVector Error = Location - RootBody->GetUnrealWorldTransform().GetLocation();
+		if (Error.SizeSquared() > FMath::Square(CorrectionDistance))
+		{
+			RootBody->SetBodyTransform(FTransform(Rotation, Location), ETeleportType::TeleportPhysics);
+		}
+		else
+		{
+			// Pull the local body onto the server's path over the next snapshot interval
+			RootBody->SetLinearVelocity(Error * SnapshotRate, false);
+		}
+	}
+}
+
+void URagdollStateComponent::FollowRootBone(const FTransform& RootTransform)
+{
+	const ACharacter* Character = Cast<ACharacter>(GetOwner());
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	const FVector RootLocation = RootTransform.GetLocation();
+	Character->GetCapsuleComponent()->SetWorldLocation(FVector(RootLocation.X, RootLocation.Y, RootLocation.Z + CapsuleHeightOffset));
+}
+
+void URagdollStateComponent::Settle()
+{
+	if (USkeletalMeshComponent* Mesh = GetOwnerMesh())
+	{
+		if (GetOwnerRole() != ROLE_Authority)
+		{
+			const FTransform Final = Snapshot.Unpack();
+			FollowRootBone(Final);
+			if (FBodyInstance* RootBody = Mesh->GetBodyInstance(RootBoneName))
+			{
+				RootBody->SetBodyTransform(Final, ETeleportType::TeleportPhysics);
+			}
+		}
+		Mesh->PutAllRigidBodiesToSleep();
+	}
+
+	Snapshot.bSettled = true;
+	StillTime = 0.0f;
+	SetComponentTickEnabled(false);
+}
+
+USkeletalMeshComponent* URagdollStateComponent::GetOwnerMesh() const
+{
+	const ACharacter* Character = Cast<ACharacter>(GetOwner());
+	return Character != nullptr ? Character->GetMesh() : nullptr;
+}
+
+void URagdollStateComponent::EnableRagdollPhysics()
+{
+	// Bodies and constraints the physics scene creates for the simulated bones
+	LLM_SCOPE_BYTAG(MGNG_Ragdolls);
+
+	if (USkeletalMeshComponent* Mesh = GetOwnerMesh())
+	{
+		Mesh->SetAllBodiesBelowSimulatePhysics(RootBoneName, true);
+	}
+}
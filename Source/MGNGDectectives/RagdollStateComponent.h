@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/NetSerialization.h"
+#include "RagdollStateComponent.generated.h"
+
+/** Root bone of a ragdoll quantized for replication, about 10 bytes per update */
+USTRUCT()
+struct FRagdollSnapshot
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize10 Location;
+
+	UPROPERTY()
+	uint16 Pitch = 0;
+
+	UPROPERTY()
+	uint16 Yaw = 0;
+
+	UPROPERTY()
+	uint16 Roll = 0;
+
+	UPROPERTY()
+	bool bSettled = false;
+
+	void Pack(const FTransform& Transform);
+	FTransform Unpack() const;
+};
+
+DECLARE_MULTICAST_DELEGATE(FOnRagdollStarted);
+
+/**
+ * Ragdoll for the owning character. The server simulates it and replicates the root bone at SnapshotRate,
+ * remote machines interpolate towards the snapshots. Once the body settles it is put to sleep and stops ticking.
+ */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class MGNGDECTECTIVES_API URagdollStateComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	URagdollStateComponent();
+
+	/** Switches the owner to ragdoll, or wakes it back up if it already is one. Authority only */
+	void StartRagdoll();
+
+	FORCEINLINE bool IsRagdoll() const { return bRagdoll; }
+	FORCEINLINE bool IsSettled() const { return Snapshot.bSettled; }
+
+	/**
+	 * Puts the bodies to sleep and stops following the snapshots while nobody sees them, catching up when thawed.
+	 * Ignored on a server with clients, whose simulation everybody else follows.
+	 */
+	void SetFrozen(bool bInFrozen);
+	FORCEINLINE bool IsFrozen() const { return bFrozen; }
+
+	/** Fired on every machine when the owner turns into a ragdoll */
+	FOnRagdollStarted OnRagdollStarted;
+
+	/** Bone the capsule follows, everything below it is simulated */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Ragdoll)
+	FName RootBoneName = TEXT("spy_bones");
+
+	/** Height of the capsule above the root bone */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Ragdoll)
+	float CapsuleHeightOffset = 90.0f;
+
+	/** Root bone snapshots sent per second while the body moves */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Ragdoll, meta=(ClampMin="1"))
+	float SnapshotRate = 10.0f;
+
+	/** Root bone speed under which the body counts as still */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Ragdoll)
+	float SettleSpeed = 5.0f;
+
+	/** Seconds the body has to stay still before it is put to sleep */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Ragdoll)
+	float SettleTime = 1.0f;
+
+	/** Remote root bones further than this from the snapshot are teleported instead of pulled */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Ragdoll)
+	float CorrectionDistance = 50.0f;
+
+protected:
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+private:
+	UFUNCTION()
+	void OnRep_Ragdoll();
+
+	UFUNCTION()
+	void OnRep_Snapshot();
+
+	class USkeletalMeshComponent* GetOwnerMesh() const;
+	void EnableRagdollPhysics();
+	void FollowRootBone(const FTransform& RootTransform);
+	void TickAuthority(float DeltaTime);
+	void TickRemote(float DeltaTime);
+	void Settle();
+
+	UPROPERTY(ReplicatedUsing=OnRep_Ragdoll)
+	bool bRagdoll = false;
+
+	UPROPERTY(ReplicatedUsing=OnRep_Snapshot)
+	FRagdollSnapshot Snapshot;
+
+	float TimeSinceSnapshot = 0.0f;
+	float StillTime = 0.0f;
+
+	// Remote interpolation between the last two snapshots
+	FTransform InterpFrom;
+	FTransform InterpTo;
+	float InterpAlpha = 1.0f;
+	bool bHasInterpTarget = false;
+
+	bool bFrozen = false;
+};